@@ -0,0 +1,233 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file bench_hex.c
+ * @brief Benchmark of the hex codec against the sprintf and sscanf per byte loops it replaced.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "fdm_hex.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_DATA_SIZE           (256)
+#define DEFAULT_MIN_TIME        (0.5)
+#define ARRAY_SIZE(a)           (sizeof(a) / sizeof((a)[0]))
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+// A device id, a typical opaque resource and a large one.
+static const unsigned int dataSizes[] = {16, 64, MAX_DATA_SIZE};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static void PrintUsage(const char *program)
+{
+    printf("Usage: %s [options]\n\n"
+            " -t : Minimum time in seconds spent on each measurement, default is %.1f\n"
+            " -h : Print help and exit\n\n",
+            program, DEFAULT_MIN_TIME);
+}
+
+static double GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static size_t EncodeWithSprintf(char *text, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        sprintf(&text[i * 3], "%02X ", data[i]);
+    }
+    return length * 3;
+}
+
+static int DecodeWithSscanf(uint8_t *data, size_t maxLength, const char *text)
+{
+    size_t length = strlen(text) / 3;
+
+    if (length > maxLength)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (sscanf(&text[i * 3], "%02hhX", &data[i]) != 1)
+        {
+            return -1;
+        }
+    }
+    return (int)length;
+}
+
+static void BenchmarkEncode(double minTime, unsigned int size)
+{
+    uint8_t data[MAX_DATA_SIZE];
+    char text[HEX_ENCODED_LENGTH(MAX_DATA_SIZE, ' ') + 1];
+    double rates[2];
+
+    for (int method = 0; method < 2; method++)
+    {
+        unsigned long count = 0;
+        double start = GetTime(), elapsed;
+
+        memset(data, 0xA5, sizeof(data));
+        do
+        {
+            if (method == 0)
+            {
+                Hex_Encode(text, data, size, ' ');
+            }
+            else
+            {
+                EncodeWithSprintf(text, data, size);
+            }
+            data[0] = text[1];
+            count++;
+            elapsed = GetTime() - start;
+        } while (elapsed < minTime);
+        rates[method] = count / elapsed;
+    }
+
+    printf("  Encode %3u bytes: Hex_Encode %10.0f ops/s, sprintf %10.0f ops/s, %5.1fx\n", size,
+        rates[0], rates[1], rates[0] / rates[1]);
+}
+
+static void BenchmarkDecode(double minTime, unsigned int size)
+{
+    uint8_t data[MAX_DATA_SIZE];
+    char text[HEX_ENCODED_LENGTH(MAX_DATA_SIZE, ' ') + 1];
+    double rates[2];
+
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = i * 37;
+    }
+    text[Hex_Encode(text, data, size, ' ')] = '\0';
+
+    for (int method = 0; method < 2; method++)
+    {
+        unsigned long count = 0;
+        double start = GetTime(), elapsed;
+        int length;
+
+        do
+        {
+            if (method == 0)
+            {
+                length = Hex_Decode(data, sizeof(data), text);
+            }
+            else
+            {
+                length = DecodeWithSscanf(data, sizeof(data), text);
+            }
+            if (length != (int)size)
+            {
+                printf("  Decode %3u bytes: FAILED\n", size);
+                return;
+            }
+            count++;
+            elapsed = GetTime() - start;
+        } while (elapsed < minTime);
+        rates[method] = count / elapsed;
+    }
+
+    printf("  Decode %3u bytes: Hex_Decode %10.0f ops/s, sscanf  %10.0f ops/s, %5.1fx\n", size,
+        rates[0], rates[1], rates[0] / rates[1]);
+}
+//! \}
+
+/**
+* @brief Entry point of application.
+*/
+int main(int argc, char **argv)
+{
+    double minTime = DEFAULT_MIN_TIME;
+    int opt;
+
+    opterr = 0;
+    while ((opt = getopt(argc, argv, "t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                minTime = strtod(optarg, NULL);
+                if (minTime <= 0)
+                {
+                    printf("Invalid time\n");
+                    PrintUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'h':
+                PrintUsage(argv[0]);
+                return 0;
+            default:
+                PrintUsage(argv[0]);
+                return -1;
+        }
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(dataSizes); i++)
+    {
+        BenchmarkEncode(minTime, dataSizes[i]);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(dataSizes); i++)
+    {
+        BenchmarkDecode(minTime, dataSizes[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,330 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file bench_hmac.c
+ * @brief Benchmark of the SHA256 and HMAC implementations and of the licensee hash. test_hmac checks
+ *        the same implementations against known answers.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "fdm_hmac.h"
+#include "fdm_licensee_hash.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define SHA256_BUFFER_SIZE      (64 * 1024)
+#define MAX_CHALLENGE_SIZE      (512)
+#define LICENSEE_KEY_SIZE       (64)
+#define MAX_CHAINS              (32)
+#define DEFAULT_MIN_TIME        (0.5)
+#define ARRAY_SIZE(a)           (sizeof(a) / sizeof((a)[0]))
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A structure to store command line arguments.
+ */
+typedef struct
+{
+    //! \{
+    double minTime;
+    int implementation;
+    //! \}
+} CmdOpts;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static const char *implementationNames[Sha256Implementation_Max] =
+{
+    [Sha256Implementation_Portable] = "portable",
+    [Sha256Implementation_ShaNi] = "sha-ni",
+    [Sha256Implementation_ArmCe] = "armv8-ce",
+    [Sha256Implementation_Library] = "library",
+};
+
+// Short messages around the one and two block padding boundaries, then long ones.
+static const unsigned int messageSizes[] = {32, 55, 56, 64, 96, 4096, SHA256_BUFFER_SIZE};
+static const unsigned int challengeSizes[] = {16, 64, 256, 512};
+static const unsigned int chainCounts[] = {1, 2, 3, 4, 8, 12, 16, MAX_CHAINS};
+static const unsigned int iterationCounts[] = {1, 10, 100, 1000, 10000, 100000};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static void PrintUsage(const char *program)
+{
+    printf("Usage: %s [options]\n\n"
+            " -t : Minimum time in seconds spent on each measurement, default is %.1f\n"
+            " -i : Only benchmark one implementation:",
+            program, DEFAULT_MIN_TIME);
+    for (int i = 0; i < Sha256Implementation_Max; i++)
+    {
+        printf(" %s", implementationNames[i]);
+    }
+    printf("\n"
+            " -h : Print help and exit\n\n");
+}
+
+static int ParseCommandArgs(int argc, char *argv[], CmdOpts *cmdOpts)
+{
+    int opt, i;
+    opterr = 0;
+
+    /* default values */
+    cmdOpts->minTime = DEFAULT_MIN_TIME;
+    cmdOpts->implementation = -1;
+
+    while (1)
+    {
+        opt = getopt(argc, argv, "t:i:h");
+        if (opt == -1)
+        {
+            break;
+        }
+
+        switch (opt)
+        {
+            case 't':
+                cmdOpts->minTime = strtod(optarg, NULL);
+                if (cmdOpts->minTime <= 0)
+                {
+                    printf("Invalid time\n");
+                    PrintUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'i':
+                for (i = 0; i < Sha256Implementation_Max; i++)
+                {
+                    if (strcmp(optarg, implementationNames[i]) == 0)
+                    {
+                        cmdOpts->implementation = i;
+                    }
+                }
+                if (cmdOpts->implementation == -1)
+                {
+                    printf("Unknown implementation %s\n", optarg);
+                    PrintUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'h':
+                PrintUsage(argv[0]);
+                return 0;
+            default:
+                PrintUsage(argv[0]);
+                return -1;
+        }
+    }
+    return 1;
+}
+
+static double GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void BenchmarkSha256(double minTime)
+{
+    static uint8_t data[SHA256_BUFFER_SIZE];
+    uint8_t hash[SHA256_HASH_LENGTH];
+
+    for (size_t i = 0; i < ARRAY_SIZE(messageSizes); i++)
+    {
+        unsigned long count = 0;
+        double start = GetTime(), elapsed;
+
+        do
+        {
+            Sha256_ComputeHash(hash, data, messageSizes[i]);
+            data[0] = hash[0];
+            count++;
+            elapsed = GetTime() - start;
+        } while (elapsed < minTime);
+
+        printf("  SHA256 %5u bytes:           %10.1f MB/s %10.0f ops/s\n", messageSizes[i],
+            count * (double)messageSizes[i] / elapsed / 1e6, count / elapsed);
+    }
+}
+
+static void BenchmarkHmac(double minTime, const HmacSha256Key *hmacKey)
+{
+    uint8_t data[MAX_CHALLENGE_SIZE] = {0};
+    uint8_t hash[SHA256_HASH_LENGTH];
+
+    for (size_t i = 0; i < ARRAY_SIZE(challengeSizes); i++)
+    {
+        unsigned long count = 0;
+        double start = GetTime(), elapsed;
+
+        do
+        {
+            HmacSha256_ComputeHashWithKey(hash, data, challengeSizes[i], hmacKey);
+            data[0] = hash[0];
+            count++;
+            elapsed = GetTime() - start;
+        } while (elapsed < minTime);
+
+        printf("  HMAC %3u bytes:              %10.0f ops/s\n", challengeSizes[i], count / elapsed);
+    }
+}
+
+static void BenchmarkLicenseeHash(double minTime, const HmacSha256Key *hmacKey)
+{
+    uint8_t challenge[MAX_CHALLENGE_SIZE] = {0};
+    uint8_t hash[SHA256_HASH_LENGTH];
+
+    for (size_t i = 0; i < ARRAY_SIZE(iterationCounts); i++)
+    {
+        printf("  Licensee hash %6u its:", iterationCounts[i]);
+        for (size_t j = 0; j < ARRAY_SIZE(challengeSizes); j++)
+        {
+            unsigned long count = 0;
+            double start = GetTime(), elapsed;
+
+            do
+            {
+                CalculateLicenseeHash(hash, challenge, challengeSizes[j], iterationCounts[i], hmacKey);
+                challenge[0] = hash[0];
+                count++;
+                elapsed = GetTime() - start;
+            } while (elapsed < minTime);
+
+            printf(" %3uB %9.3f ms", challengeSizes[j], elapsed * 1e3 / count);
+        }
+        printf("\n");
+    }
+}
+
+static void BenchmarkHashChains(double minTime, const HmacSha256Key *hmacKey)
+{
+    static uint8_t challenges[MAX_CHAINS][MAX_CHALLENGE_SIZE];
+    HmacSha256Chain chains[MAX_CHAINS];
+    unsigned int iterations = iterationCounts[3];
+    double singleRate = 0, rate;
+
+    for (size_t i = 0; i < MAX_CHAINS; i++)
+    {
+        chains[i].Key = hmacKey;
+        chains[i].Data = challenges[i];
+        chains[i].DataLen = challengeSizes[0];
+        chains[i].Iterations = iterations;
+    }
+
+    // Sweep the chain count across the lane width, partial and several full groups of lanes.
+    for (size_t i = 0; i < ARRAY_SIZE(chainCounts); i++)
+    {
+        unsigned long count = 0;
+        double start = GetTime(), elapsed;
+
+        do
+        {
+            HmacSha256_ComputeHashChains(chains, chainCounts[i]);
+            count++;
+            elapsed = GetTime() - start;
+        } while (elapsed < minTime);
+
+        rate = count * chainCounts[i] * (double)iterations / elapsed;
+        if (i == 0)
+        {
+            singleRate = rate;
+        }
+        printf("  %2u chains of %u its:        %10.0f HMAC/s %5.2fx\n", chainCounts[i], iterations,
+            rate, rate / singleRate);
+    }
+}
+//! \}
+
+/**
+* @brief Entry point of application.
+*/
+int main(int argc, char **argv)
+{
+    int ret;
+    CmdOpts cmdOpts;
+    uint8_t key[LICENSEE_KEY_SIZE];
+    HmacSha256Key hmacKey;
+    Sha256Implementation defaultImplementation = HmacSha256_GetImplementation();
+
+    ret = ParseCommandArgs(argc, argv, &cmdOpts);
+    if (ret <= 0)
+        return ret;
+
+    memset(key, 0x5a, sizeof(key));
+
+    for (int i = 0; i < Sha256Implementation_Max; i++)
+    {
+        if (cmdOpts.implementation != -1 && cmdOpts.implementation != i)
+        {
+            continue;
+        }
+        if (!HmacSha256_SetImplementation(i))
+        {
+            printf("%s: not supported\n\n", implementationNames[i]);
+            continue;
+        }
+
+        printf("%s%s:\n", implementationNames[i], i == (int)defaultImplementation ? " (default)" : "");
+        HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+        BenchmarkSha256(cmdOpts.minTime);
+        BenchmarkHmac(cmdOpts.minTime, &hmacKey);
+        BenchmarkHashChains(cmdOpts.minTime, &hmacKey);
+        BenchmarkLicenseeHash(cmdOpts.minTime, &hmacKey);
+        printf("\n");
+    }
+
+    HmacSha256_SetImplementation(defaultImplementation);
+    return 0;
+}
@@ -0,0 +1,207 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file bench_server_session.c
+ * @brief Benchmark of a server request on a session connected per call, as before the pool, against
+ *        one on a session taken from the pool. Needs the Awa LWM2M server, so it is run on the target.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "awa/server.h"
+#include "fdm_server_session.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define DEFAULT_NUM_REQUESTS    (200)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A way of getting and giving back a session.
+ */
+typedef struct
+{
+    //! \{
+    const char *name;
+    AwaServerSession *(*acquire)(void);
+    void (*release)(AwaServerSession **session);
+    //! \}
+} SessionMethod;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+int debugLevel = LOG_ERR;
+FILE *debugStream = NULL;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static void PrintUsage(const char *program)
+{
+    printf("Usage: %s [options]\n\n"
+            " -n : Number of requests timed for each method, default is %d\n"
+            " -h : Print help and exit\n\n",
+            program, DEFAULT_NUM_REQUESTS);
+}
+
+static double GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static AwaServerSession *EstablishSession(void)
+{
+    return Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+}
+
+static void ReturnSession(AwaServerSession **session)
+{
+    Server_ReturnSession(session, true);
+}
+
+static bool ListClients(AwaServerSession *session)
+{
+    AwaServerListClientsOperation *operation;
+    AwaError error;
+
+    if ((operation = AwaServerListClientsOperation_New(session)) == NULL)
+    {
+        return false;
+    }
+    error = AwaServerListClientsOperation_Perform(operation, IPC_TIMEOUT);
+    AwaServerListClientsOperation_Free(&operation);
+    return error == AwaError_Success;
+}
+
+static bool BenchmarkMethod(const SessionMethod *method, int numRequests)
+{
+    AwaServerSession *session;
+    double start = GetTime(), acquireTime = 0, elapsed, time;
+    int i;
+
+    for (i = 0; i < numRequests; i++)
+    {
+        time = GetTime();
+        if ((session = method->acquire()) == NULL)
+        {
+            printf("  %s: failed to get a session, is the Awa server running?\n", method->name);
+            return false;
+        }
+        acquireTime += GetTime() - time;
+
+        if (!ListClients(session))
+        {
+            printf("  %s: list clients failed\n", method->name);
+            method->release(&session);
+            return false;
+        }
+        method->release(&session);
+    }
+    elapsed = GetTime() - start;
+
+    printf("  %-24s %8.3f ms/request %8.3f ms getting the session %8.0f requests/s\n", method->name,
+        elapsed * 1e3 / numRequests, acquireTime * 1e3 / numRequests, numRequests / elapsed);
+    return true;
+}
+//! \}
+
+/**
+* @brief Entry point of application.
+*/
+int main(int argc, char **argv)
+{
+    const SessionMethod methods[] =
+    {
+        {"Establish/Release", EstablishSession, Server_ReleaseSession},
+        {"Acquire/Return (pool)", Server_AcquireSession, ReturnSession},
+    };
+    int numRequests = DEFAULT_NUM_REQUESTS;
+    bool isPassed = true;
+    int opt;
+
+    opterr = 0;
+    while ((opt = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                numRequests = atoi(optarg);
+                if (numRequests <= 0)
+                {
+                    printf("Invalid number of requests\n");
+                    PrintUsage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'h':
+                PrintUsage(argv[0]);
+                return 0;
+            default:
+                PrintUsage(argv[0]);
+                return -1;
+        }
+    }
+
+    printf("ListClients on the server at %s:%d, %d requests:\n", SERVER_ADDRESS, SERVER_PORT, numRequests);
+    for (size_t i = 0; i < ARRAY_SIZE(methods) && isPassed; i++)
+    {
+        isPassed = BenchmarkMethod(&methods[i], numRequests);
+    }
+
+    Server_CloseSessions();
+    return isPassed ? 0 : 1;
+}
@@ -38,15 +38,21 @@
  **************************************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 #include "awa/common.h"
 #include "awa/client.h"
+#include "awa/server.h"
 #include "device_manager.h"
 #include "fdm_register.h"
 #include "fdm_subscribe.h"
 #include "fdm_licensee_verification.h"
+#include "fdm_file_writer.h"
+#include "fdm_server_session.h"
 #include "fdm_common.h"
 #include "fdm_log.h"
 
@@ -58,10 +64,33 @@
 #define IPC_PORT                 (12345)
 #define IPC_ADDRESS              "127.0.0.1"
 #define SERVER_RESPONSE_TIMEOUT  (30)
-#define MAX_STRINGS              (15)
 #define FLOW_ACCESS_CFG          "/etc/lwm2m/flow_access.cfg"
+#define FLOW_ACCESS_INSTANCE_CFG "/etc/lwm2m/flow_access.%u.cfg"
+#define FLOW_ACCESS_INSTANCE_SNAPSHOT "/etc/lwm2m/flow_access.%u.snapshot"
+#define SELECTED_INSTANCE_CFG    "/etc/lwm2m/flow_access.selected"
+#define SELECTED_INSTANCE_SIZE   (16)
+#define FILE_PATH_SIZE           (64)
 //! \}
 
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * Gateway provisioning in progress, waiting for the FlowCloud server.
+ */
+struct GatewayProvisioning
+{
+    //! \{
+    unsigned int instance;
+    char *licenseeSecret;
+    FlowSubscriptions subscriptions;
+    Verification verificationData;
+    time_t deadline;
+    bool isDraining;
+    //! \}
+};
+
 /***************************************************************************************************
  * Globals
  **************************************************************************************************/
@@ -122,6 +151,20 @@ static const OBJECT_T deviceObject =
  */
 static AwaClientSession *session = NULL;
 
+/**
+ * Instance whose access details are mirrored to FLOW_ACCESS_CFG and FLOW_ACCESS_SNAPSHOT_PATH,
+ * kept in SELECTED_INSTANCE_CFG across restarts.
+ */
+static unsigned int activeInstance = OBJECT_INSTANCE_ID;
+
+/**
+ * DeviceID of the active instance, the parent of constrained devices provisioned without one.
+ * Resolved on the client session's thread and read from any provisioning thread.
+ */
+static uint8_t gatewayDeviceID[DEVICE_ID_SIZE];
+static bool isGatewayDeviceIDKnown = false;
+static pthread_mutex_t gatewayDeviceIDLock = PTHREAD_MUTEX_INITIALIZER;
+
 int debugLevel = LOG_INFO;
 FILE *debugStream = NULL;
 
@@ -151,6 +194,107 @@ void SetDebugLevel(unsigned int level)
     debugLevel = level;
 }
 
+/**
+ * @brief Read the DeviceID resource of a gateway FlowObject instance into the cached gateway
+ *        device ID. The cache is cleared if the instance has no valid DeviceID yet.
+ * @param[in] instance Flow object instance.
+ */
+static void ResolveGatewayDeviceID(unsigned int instance)
+{
+    char deviceIDPath[URL_PATH_SIZE];
+    AwaClientGetOperation *operation;
+    const AwaClientGetResponse *response;
+    const AwaOpaque *deviceID = NULL;
+    AwaError error;
+
+    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(deviceIDPath, instance, FlowObjectResourceId_DeviceId))
+        != AwaError_Success)
+    {
+        LOG(LOG_ERR, "Failed to generate path for DeviceID\nerror: %s", AwaError_ToString(error));
+        return;
+    }
+
+    operation = AwaClientGetOperation_New(session);
+    if (operation == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create get operation from session");
+        return;
+    }
+    if (AwaClientGetOperation_AddPath(operation, deviceIDPath) == AwaError_Success &&
+        AwaClientGetOperation_Perform(operation, IPC_TIMEOUT) == AwaError_Success &&
+        (response = AwaClientGetOperation_GetResponse(operation)) != NULL &&
+        AwaClientGetResponse_GetValueAsOpaquePointer(response, deviceIDPath, &deviceID) != AwaError_Success)
+    {
+        deviceID = NULL;
+    }
+
+    pthread_mutex_lock(&gatewayDeviceIDLock);
+    isGatewayDeviceIDKnown = deviceID != NULL && deviceID->Size == DEVICE_ID_SIZE;
+    if (isGatewayDeviceIDKnown)
+    {
+        memcpy(gatewayDeviceID, deviceID->Data, DEVICE_ID_SIZE);
+    }
+    pthread_mutex_unlock(&gatewayDeviceIDLock);
+
+    if (!isGatewayDeviceIDKnown)
+    {
+        LOG(LOG_INFO, "Gateway instance %u has no DeviceID yet", instance);
+    }
+    AwaClientGetOperation_Free(&operation);
+}
+
+bool GetGatewayDeviceID(uint8_t *deviceID, size_t size)
+{
+    bool result;
+
+    if (deviceID == NULL || size < DEVICE_ID_SIZE)
+    {
+        LOG(LOG_ERR, "Invalid params passed to %s()", __func__);
+        return false;
+    }
+
+    pthread_mutex_lock(&gatewayDeviceIDLock);
+    result = isGatewayDeviceIDKnown;
+    if (result)
+    {
+        memcpy(deviceID, gatewayDeviceID, DEVICE_ID_SIZE);
+    }
+    pthread_mutex_unlock(&gatewayDeviceIDLock);
+    return result;
+}
+
+/**
+ * @brief Restore the instance selected before a restart. An instance that is no longer provisioned
+ *        falls back to the default one, so that provisioning it updates the default files again.
+ */
+static void LoadSelectedInstance(void)
+{
+    FILE *file;
+    unsigned int instance;
+    bool isRead;
+
+    if ((file = fopen(SELECTED_INSTANCE_CFG, "r")) == NULL)
+    {
+        return;
+    }
+    isRead = fscanf(file, "%u", &instance) == 1;
+    fclose(file);
+
+    if (!isRead || instance >= MAX_FLOW_INSTANCES)
+    {
+        LOG(LOG_WARN, "Ignoring invalid "SELECTED_INSTANCE_CFG);
+        return;
+    }
+    if (instance != OBJECT_INSTANCE_ID && !IsGatewayDeviceInstanceProvisioned(instance))
+    {
+        LOG(LOG_WARN, "Selected instance %u isn't provisioned, using instance %u", instance,
+            OBJECT_INSTANCE_ID);
+        return;
+    }
+    LOG(LOG_INFO, "Instance %u is selected", instance);
+    activeInstance = instance;
+}
+
 bool EstablishSession(void)
 {
     AwaError error;
@@ -169,6 +313,8 @@ bool EstablishSession(void)
     {
         if ((error = AwaClientSession_Connect(session)) == AwaError_Success)
         {
+            LoadSelectedInstance();
+            ResolveGatewayDeviceID(activeInstance);
             result = true;
         }
         else
@@ -183,161 +329,300 @@ bool EstablishSession(void)
     return result;
 }
 
+/**
+ * @brief Hand a copy of content to the background writer.
+ * @param[in] path File to replace.
+ * @param[in] content Content to copy.
+ * @param[in] length Length of content.
+ * @return true for success otherwise false.
+ */
+static bool SaveCopy(const char *path, const char *content, size_t length)
+{
+    char *copy = malloc(length);
+
+    if (copy == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for %s", path);
+        return false;
+    }
+    memcpy(copy, content, length);
+    return FileWriter_SaveAsync(path, copy, length);
+}
+
 /**
  * @brief Save details which are required to access flow cloud or required by flow_button_gateway
  *        application. This will save value of those resources for which wantToSave member is set.
+ *        Every instance gets its own files, the active instance is also saved to the default ones.
+ * @param[in] instance Flow and flow access object instance to save.
  * @return true for success otherwise false.
  */
-static bool SaveFlowCloudAccessDetails()
+static bool SaveFlowCloudAccessDetails(unsigned int instance)
 {
-    char strings[MAX_STRINGS][MAX_STR_SIZE] = {{0}};
-    unsigned int i, resCount = 0;
+    size_t length, snapshotLength;
+    char *content, *snapshotContent;
+    char cfgPath[FILE_PATH_SIZE];
+    char snapshotPath[FILE_PATH_SIZE];
+    bool result = true;
+    StringBuilder text;
+    FlowAccessSnapshotBuilder snapshot;
     OBJECT_T objects[] =
     {
         flowObject,
         flowAccessObject,
         deviceObject
     };
-    LOG(LOG_INFO, "Saving flow cloud access details...");
+    AwaObjectInstanceID instanceIds[] =
+    {
+        instance,
+        instance,
+        OBJECT_INSTANCE_ID
+    };
+    LOG(LOG_INFO, "Saving flow cloud access details of instance %u...", instance);
 
-    if (!(resCount = GetResources(session, objects, ARRAY_SIZE(objects), strings)))
+    if (!GetResources(session, objects, instanceIds, ARRAY_SIZE(objects), &text, &snapshot))
     {
         LOG(LOG_ERR, "Failed to get objects resource values");
         return false;
     }
 
-    FILE *configFile = fopen(FLOW_ACCESS_CFG, "w");
-    if (configFile == NULL)
+    snprintf(cfgPath, sizeof(cfgPath), FLOW_ACCESS_INSTANCE_CFG, instance);
+    snprintf(snapshotPath, sizeof(snapshotPath), FLOW_ACCESS_INSTANCE_SNAPSHOT, instance);
+    snapshotContent = FlowAccessSnapshotBuilder_Finish(&snapshot, &snapshotLength);
+    content = StringBuilder_Release(&text, &length);
+
+    // Snapshots go first, so that readers polling them never see them older than the text files.
+    if (instance == activeInstance)
     {
-        LOG(LOG_ERR, "Failed to create or open "FLOW_ACCESS_CFG);
-        return false;
+        if (!SaveCopy(FLOW_ACCESS_SNAPSHOT_PATH, snapshotContent, snapshotLength))
+        {
+            LOG(LOG_ERR, "Failed to save "FLOW_ACCESS_SNAPSHOT_PATH);
+        }
+        result = SaveCopy(FLOW_ACCESS_CFG, content, length);
     }
-    for (i = 0; i < resCount; i++)
+
+    if (!FileWriter_SaveAsync(snapshotPath, snapshotContent, snapshotLength))
     {
-        fprintf(configFile, "%s\n", strings[i]);
+        LOG(LOG_ERR, "Failed to save %s", snapshotPath);
     }
-    if (fclose(configFile))
+    return FileWriter_SaveAsync(cfgPath, content, length) && result;
+}
+
+ProvisionStatus ProvisionGatewayDevice(const char *deviceName, const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret)
+{
+    return ProvisionGatewayDeviceInstance(OBJECT_INSTANCE_ID, deviceName, deviceType, licenseeID, fcap,
+        licenseeSecret);
+}
+
+ProvisionStatus ProvisionGatewayDeviceInstance(unsigned int instance, const char *deviceName,
+    const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret)
+{
+    GatewayProvisioning *provisioning;
+    ProvisionStatus status;
+
+    provisioning = StartGatewayProvisioning(instance, deviceName, deviceType, licenseeID, fcap,
+        licenseeSecret, &status);
+    while (provisioning != NULL && !PollGatewayProvisioning(provisioning, &status))
     {
-        LOG(LOG_ERR, "Failed to close "FLOW_ACCESS_CFG);
+        usleep(GATEWAY_PROVISIONING_POLL_INTERVAL * 1000);
     }
-    return true;
+    return status;
 }
 
-ProvisionStatus ProvisionGatewayDevice(const char *deviceName, const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret)
+/**
+ * @brief Get the current time in seconds from a clock that isn't affected by clock changes.
+ * @return Current time.
+ */
+static time_t GetMonotonicTime(void)
 {
-    FlowSubscriptions subscriptions = {0};
-    Verification verificationData;
-    unsigned int timeout = SERVER_RESPONSE_TIMEOUT;
-    unsigned int sleepTime = SLEEP_COUNT;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+GatewayProvisioning *StartGatewayProvisioning(unsigned int instance, const char *deviceName,
+    const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret,
+    ProvisionStatus *status)
+{
+    GatewayProvisioning *provisioning;
     OBJECT_T flowObjects[] =
     {
         flowObject,
         flowAccessObject,
     };
 
+    *status = PROVISION_FAIL;
+
     if (deviceName == NULL || deviceType == NULL || fcap == NULL || licenseeSecret == NULL)
     {
         LOG(LOG_ERR, "Null parameters passed to %s()", __func__);
-        return PROVISION_FAIL;
+        return NULL;
+    }
+
+    if (instance >= MAX_FLOW_INSTANCES)
+    {
+        LOG(LOG_ERR, "Instance %u is out of range, maximum is %u", instance, MAX_FLOW_INSTANCES - 1);
+        return NULL;
     }
 
     LOG(LOG_INFO, "Provisioning device with following details:\n"
-        "\n%-15s\t = %s\n%-15s\t = %s\n%-15s\t = %d\n%-15s\t = %s\n%-15s\t = %s", "Device Name",
-        deviceName, "Device Type", deviceType, "Licensee ID", licenseeID, "FCAP", fcap,
-        "Licensee Secret", licenseeSecret);
+        "\n%-15s\t = %u\n%-15s\t = %s\n%-15s\t = %s\n%-15s\t = %d\n%-15s\t = %s\n%-15s\t = %s",
+        "Instance", instance, "Device Name", deviceName, "Device Type", deviceType, "Licensee ID",
+        licenseeID, "FCAP", fcap, "Licensee Secret", licenseeSecret);
 
     if (!DefineObjectsAtClient(session, flowObjects, ARRAY_SIZE(flowObjects)))
     {
         LOG(LOG_ERR, "Failed to define Flow objects");
-        return PROVISION_FAIL;
+        return NULL;
     }
 
-    if(IsGatewayDeviceProvisioned())
+    if(IsGatewayDeviceInstanceProvisioned(instance))
     {
-        return ALREADY_PROVISIONED;
+        *status = ALREADY_PROVISIONED;
+        return NULL;
     }
 
-    if (!PopulateFlowObject(session, deviceName, deviceType, licenseeID, fcap))
+    if (!PopulateFlowObject(session, instance, deviceName, deviceType, licenseeID, fcap))
     {
         LOG(LOG_ERR, "Failed to populate flow object with device type, licensee id and fcap");
-        return PROVISION_FAIL;
+        return NULL;
+    }
+
+    if ((provisioning = calloc(1, sizeof(*provisioning))) == NULL ||
+        (provisioning->licenseeSecret = strdup(licenseeSecret)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for provisioning");
+        free(provisioning);
+        return NULL;
     }
 
-    memset(&verificationData, 0, sizeof(Verification));
-    verificationData.waitForServerResponse = true;
-    verificationData.hasChallenge = false;
-    verificationData.hasIterations = false;
-    verificationData.verifyLicensee = false;
-    verificationData.isProvisionSuccess = false;
+    provisioning->instance = instance;
+    provisioning->verificationData.instanceId = instance;
+    provisioning->verificationData.waitForServerResponse = true;
+    provisioning->verificationData.hasChallenge = false;
+    provisioning->verificationData.hasIterations = false;
+    provisioning->verificationData.verifyLicensee = false;
+    provisioning->verificationData.isProvisionSuccess = false;
 
-    if (!SubscribeToFlowObjects(session, &subscriptions, &verificationData))
+    if (!SubscribeToFlowObjects(session, &provisioning->subscriptions, &provisioning->verificationData))
     {
         LOG(LOG_ERR, "Failed to subscribe flow and flow access objects");
-        return PROVISION_FAIL;
+        free(provisioning->licenseeSecret);
+        free(provisioning);
+        return NULL;
     }
 
     LOG(LOG_INFO, "Waiting for responses from FlowCloud server...");
+    provisioning->deadline = GetMonotonicTime() + SERVER_RESPONSE_TIMEOUT;
+    return provisioning;
+}
 
-    while(verificationData.waitForServerResponse && --timeout)
+/**
+ * @brief Unsubscribe and free a gateway provisioning, keeping the licensee secret out of freed
+ *        memory.
+ * @param[in] provisioning Provisioning to free.
+ */
+static void FreeGatewayProvisioning(GatewayProvisioning *provisioning)
+{
+    UnSubscribeFromFlowObjects(session, &provisioning->subscriptions);
+    CancelFlowLicenseeVerification(&provisioning->verificationData);
+    if (provisioning->verificationData.challenge.Data != NULL)
     {
-        AwaClientSession_Process(session, IPC_TIMEOUT);
-        AwaClientSession_DispatchCallbacks(session);
+        free(provisioning->verificationData.challenge.Data);
+    }
+
+    if (provisioning->verificationData.licenseeHash.Data != NULL)
+    {
+        free(provisioning->verificationData.licenseeHash.Data);
+    }
+
+    memset(provisioning->licenseeSecret, 0, strlen(provisioning->licenseeSecret));
+    free(provisioning->licenseeSecret);
+    free(provisioning);
+}
+
+bool PollGatewayProvisioning(GatewayProvisioning *provisioning, ProvisionStatus *status)
+{
+    Verification *verificationData = &provisioning->verificationData;
+    time_t now;
 
-        if (verificationData.verifyLicensee)
+    AwaClientSession_Process(session, 0);
+    AwaClientSession_DispatchCallbacks(session);
+
+    if (verificationData->verifyLicensee)
+    {
+        // A failure to start won't go away by retrying every tick, so provisioning fails at once.
+        verificationData->verifyLicensee = false;
+        if (!StartFlowLicenseeVerification(verificationData, provisioning->licenseeSecret))
         {
-            if (PerformFlowLicenseeVerification(session, &verificationData, licenseeSecret))
-            {
-                verificationData.verifyLicensee = false;
-            }
+            LOG(LOG_ERR, "Failed to start licensee verification");
+            *status = PROVISION_FAIL;
+            FreeGatewayProvisioning(provisioning);
+            return true;
         }
-        sleep(1);
     }
-
-    if (!timeout)
+    if (!PollFlowLicenseeVerification(session, verificationData))
     {
-        LOG(LOG_ERR, "No response within timeout");
+        LOG(LOG_ERR, "Failed to set licensee hash");
     }
 
-    // FIXME: Temporary code until status resource is removed from FlowObject so we only get one
-    // change notification before canceling the subscription.
-    // Right now Message IDs aren't used in IPC, so it is possible to get messages out of order,
-    // causing the application to parse a response it is not expecting.
-    LOG(LOG_INFO, "Waiting for any residual notifications...");
-    while(sleepTime-- > 0)
+    now = GetMonotonicTime();
+    if (!provisioning->isDraining)
     {
-        AwaClientSession_Process(session, IPC_TIMEOUT);
-        AwaClientSession_DispatchCallbacks(session);
-        sleep(1);
-    }
+        if (verificationData->waitForServerResponse && now < provisioning->deadline)
+        {
+            return false;
+        }
+        if (verificationData->waitForServerResponse)
+        {
+            LOG(LOG_ERR, "No response within timeout");
+        }
 
-    // Clean up
-    UnSubscribeFromFlowObjects(session, &subscriptions);
-    if (verificationData.challenge.Data != NULL)
+        // FIXME: Temporary code until status resource is removed from FlowObject so we only get one
+        // change notification before canceling the subscription.
+        // Right now Message IDs aren't used in IPC, so it is possible to get messages out of order,
+        // causing the application to parse a response it is not expecting.
+        LOG(LOG_INFO, "Waiting for any residual notifications...");
+        provisioning->isDraining = true;
+        provisioning->deadline = now + SLEEP_COUNT;
+        return false;
+    }
+    if (now < provisioning->deadline)
     {
-        free(verificationData.challenge.Data);
+        return false;
     }
 
-    if (verificationData.licenseeHash.Data != NULL)
+    *status = verificationData->isProvisionSuccess ? PROVISION_OK : PROVISION_FAIL;
+    if (*status == PROVISION_OK && !SaveFlowCloudAccessDetails(provisioning->instance))
     {
-        free(verificationData.licenseeHash.Data);
+        LOG(LOG_ERR, "Failed to save flow cloud access details");
     }
-
-    if (!verificationData.isProvisionSuccess)
+    if (*status == PROVISION_OK && provisioning->instance == activeInstance)
     {
-        return PROVISION_FAIL;
+        ResolveGatewayDeviceID(activeInstance);
     }
+    FreeGatewayProvisioning(provisioning);
+    return true;
+}
 
-    if (!SaveFlowCloudAccessDetails())
+void CancelGatewayProvisioning(GatewayProvisioning *provisioning)
+{
+    if (provisioning != NULL)
     {
-        LOG(LOG_ERR, "Failed to save flow cloud access details");
+        LOG(LOG_INFO, "Cancelling provisioning of instance %u", provisioning->instance);
+        FreeGatewayProvisioning(provisioning);
     }
-    return PROVISION_OK;
 }
 
 bool IsGatewayDeviceProvisioned(void)
 {
-    LOG(LOG_INFO, "Checking whether Gateway device is provisioned");
-    if (DoesObjectExist(session, Lwm2mObjectId_FlowAccess, OBJECT_INSTANCE_ID))
+    return IsGatewayDeviceInstanceProvisioned(OBJECT_INSTANCE_ID);
+}
+
+bool IsGatewayDeviceInstanceProvisioned(unsigned int instance)
+{
+    LOG(LOG_INFO, "Checking whether Gateway device instance %u is provisioned", instance);
+    if (instance < MAX_FLOW_INSTANCES && DoesObjectExist(session, Lwm2mObjectId_FlowAccess, instance))
     {
         LOG(LOG_INFO, "Provisioned");
         return true;
@@ -349,10 +634,50 @@ bool IsGatewayDeviceProvisioned(void)
     }
 }
 
+bool SelectGatewayInstance(unsigned int instance)
+{
+    unsigned int previousInstance = activeInstance;
+    char selection[SELECTED_INSTANCE_SIZE];
+    int length;
+
+    LOG(LOG_INFO, "Selecting gateway device instance %u", instance);
+
+    if (!IsGatewayDeviceInstanceProvisioned(instance))
+    {
+        LOG(LOG_ERR, "Instance %u isn't provisioned", instance);
+        return false;
+    }
+
+    activeInstance = instance;
+    if (!SaveFlowCloudAccessDetails(instance))
+    {
+        LOG(LOG_ERR, "Failed to save flow cloud access details of instance %u", instance);
+        activeInstance = previousInstance;
+        return false;
+    }
+    length = snprintf(selection, sizeof(selection), "%u\n", instance);
+    if (!SaveCopy(SELECTED_INSTANCE_CFG, selection, length))
+    {
+        LOG(LOG_ERR, "Failed to save "SELECTED_INSTANCE_CFG", instance %u is selected until restart",
+            instance);
+    }
+    ResolveGatewayDeviceID(instance);
+    return true;
+}
+
+unsigned int GetSelectedGatewayInstance(void)
+{
+    return activeInstance;
+}
+
 void ReleaseSession()
 {
     LOG(LOG_INFO, "Disconnecting session with lwm2m client");
 
+    // Don't lose a save that is still in flight.
+    FileWriter_Flush();
+    Server_CloseSessions();
+
     if (session == NULL)
     {
         return;
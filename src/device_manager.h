@@ -37,12 +37,17 @@
 #define DEVICE_MANAGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <json.h>
 #include "fdm_common.h"
 
 //! \{
 #define MAX_STR_SIZE                (64)
 #define DEFAULT_PROVSIONING_TIMEOUT (30)
+#define GATEWAY_PROVISIONING_POLL_INTERVAL (100)
+#define DEFAULT_PROVISIONING_WINDOW (4)
+#define MAX_PROVISIONING_WINDOW     (16)
 //! \}
 
 /**
@@ -55,6 +60,27 @@ typedef enum
     ALREADY_PROVISIONED,
 }ProvisionStatus;
 
+/**
+ * A constrained device of a batch provisioning and its result.
+ */
+typedef struct
+{
+    //! \{
+    const char *clientID;
+    const char *fcap;
+    ProvisionStatus status;
+    // Milliseconds spent writing the provisioning information, -1 if not written
+    int writeTime;
+    // Milliseconds from the start of the batch until provisioned, -1 if not provisioned
+    int provisionTime;
+    //! \}
+} ConstrainedDevice;
+
+/**
+ * Gateway provisioning in progress.
+ */
+typedef struct GatewayProvisioning GatewayProvisioning;
+
 /**
  * @brief Provisioning details.
  */
@@ -100,12 +126,89 @@ bool EstablishSession();
 ProvisionStatus ProvisionGatewayDevice(const char *deviceName, const char *deviceType,
     int licenseeID, const char *fcap, const char *licenseeSecret);
 
+/**
+ * @brief Provision one instance of the gateway Flow objects, so that the gateway can hold the
+ *        access details of several licensees side by side.
+ * @param[in] instance Flow and flow access object instance, below MAX_FLOW_INSTANCES.
+ * @param[in] deviceName User assigned name of device.
+ * @param[in] deviceType FlowCloud registered device type.
+ * @param[in] licenseeID Licensee.
+ * @param[in] fcap FlowCloud Access Provisioning Code.
+ * @param[in] licenseeSecret Licensee Secret.
+ * @return 0 for PROVISION_OK
+           1 for PROVISION_FAIL
+           2 for ALREADY_PROVISIONED
+ */
+ProvisionStatus ProvisionGatewayDeviceInstance(unsigned int instance, const char *deviceName,
+    const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret);
+
+/**
+ * @brief Start provisioning one instance of the gateway Flow objects without waiting for the
+ *        FlowCloud server, so that an event loop can keep serving other requests meanwhile.
+ * @param[in] instance Flow and flow access object instance, below MAX_FLOW_INSTANCES.
+ * @param[in] deviceName User assigned name of device.
+ * @param[in] deviceType FlowCloud registered device type.
+ * @param[in] licenseeID Licensee.
+ * @param[in] fcap FlowCloud Access Provisioning Code.
+ * @param[in] licenseeSecret Licensee Secret.
+ * @param[out] status Result, if provisioning finished without waiting.
+ * @return Provisioning to pass to PollGatewayProvisioning every GATEWAY_PROVISIONING_POLL_INTERVAL
+ *         ms, or NULL if it already finished.
+ */
+GatewayProvisioning *StartGatewayProvisioning(unsigned int instance, const char *deviceName,
+    const char *deviceType, int licenseeID, const char *fcap, const char *licenseeSecret,
+    ProvisionStatus *status);
+
+/**
+ * @brief Process FlowCloud server responses of a gateway provisioning without blocking.
+ * @param[in] provisioning Provisioning started by StartGatewayProvisioning, freed once finished.
+ * @param[out] status Result, once finished.
+ * @return true if provisioning finished otherwise false.
+ */
+bool PollGatewayProvisioning(GatewayProvisioning *provisioning, ProvisionStatus *status);
+
+/**
+ * @brief Abandon and free a gateway provisioning, e.g. at shutdown.
+ * @param[in] provisioning Provisioning started by StartGatewayProvisioning, may be NULL.
+ */
+void CancelGatewayProvisioning(GatewayProvisioning *provisioning);
+
 /**
  * @brief Check whether gateway device is already provisioned or not.
  * @return true for success otherwise false.
  */
 bool IsGatewayDeviceProvisioned();
 
+/**
+ * @brief Check whether an instance of the gateway Flow objects is already provisioned or not.
+ * @param[in] instance Flow access object instance.
+ * @return true for success otherwise false.
+ */
+bool IsGatewayDeviceInstanceProvisioned(unsigned int instance);
+
+/**
+ * @brief Make a provisioned instance the one saved to the default flow access files, without
+ *        provisioning it again.
+ * @param[in] instance Flow access object instance.
+ * @return true for success otherwise false.
+ */
+bool SelectGatewayInstance(unsigned int instance);
+
+/**
+ * @brief Get the instance saved to the default flow access files.
+ * @return Selected instance.
+ */
+unsigned int GetSelectedGatewayInstance(void);
+
+/**
+ * @brief Get the DeviceID of the selected gateway instance, as read from its FlowObject when the
+ *        session was established or the instance was provisioned or selected.
+ * @param[out] deviceID Buffer for the DeviceID.
+ * @param[in] size Size of deviceID, at least DEVICE_ID_SIZE.
+ * @return true if the DeviceID is known, false if the gateway isn't provisioned yet.
+ */
+bool GetGatewayDeviceID(uint8_t *deviceID, size_t size);
+
 /**
  * @brief Disconnect session from the Awa LWM2M Core and shut down the session, free up any
  *        allocated memory.
@@ -115,8 +218,9 @@ void ReleaseSession();
 /**
  * @brief Get list of clients registered on Awa LWM2M server.
  * @param[out] respObj Json object to be filled with list of clients.
+ * @return false if no client list poll token was available in time, else true.
  */
-void GetClientList(json_object *respObj);
+bool GetClientList(json_object *respObj);
 
 /**
  * @brief Provision a Constrained Device that has connected to the Gateway with FlowCloud
@@ -124,8 +228,10 @@ void GetClientList(json_object *respObj);
  * @param[in] fcap FCAP code
  * @param[in] deviceType registered device type
  * @param[in] licenseeID Licensee ID.
- * @param[in] parentID Device ID of Gateway device.
- * @param[in] timeout Time to wait for provisioning to complete.
+ * @param[in] parentID Device ID of Gateway device as hex, or NULL for the DeviceID of the selected
+ *            gateway instance.
+ * @param[in] timeout Seconds the whole call may take, writing the provisioning information and
+ *            waiting for provisioning to complete.
  * @return 0 for PROVISION_OK
            1 for PROVISION_FAIL
            2 for ALREADY_PROVISIONED
@@ -133,11 +239,33 @@ void GetClientList(json_object *respObj);
 ProvisionStatus ProvisionConstrainedDevice(const char *clientID, const char *fcap,
     const char *deviceType, int licenseeID, const char *parentID, int timeout);
 
+/**
+ * @brief Provision many Constrained Devices sharing device type, licensee and parent with
+ *        FlowCloud. Up to window devices are written at the same time, then completion of all of
+ *        them is awaited together.
+ * @param[in,out] devices Client IDs and FCAP codes of the devices, their status and timing are
+ *                filled in.
+ * @param[in] numDevices Number of devices.
+ * @param[in] deviceType registered device type
+ * @param[in] licenseeID Licensee ID.
+ * @param[in] parentID Device ID of Gateway device as hex, or NULL for the DeviceID of the selected
+ *            gateway instance.
+ * @param[in] timeout Seconds the whole call may take, writing the provisioning information and
+ *            waiting for provisioning to complete.
+ * @param[in] window Number of devices written at the same time, up to MAX_PROVISIONING_WINDOW.
+ * @return true if the batch was processed, the status of each device tells its outcome, false if
+ *         the server couldn't be reached.
+ */
+bool ProvisionConstrainedDevices(ConstrainedDevice devices[], unsigned int numDevices, const char *deviceType,
+    int licenseeID, const char *parentID, int timeout, unsigned int window);
+
 /**
  * @brief Check if constrained device is provisioned or not
  * @param[in] clientID User assigned name of device
+ * @param[out] isBusy Set if no client list poll token was available in time, the device isn't
+ *             checked then.
  * @return true if device is present and provisioned, false otherwise
  */
-bool IsConstrainedDeviceProvisioned(const char* clientID);
+bool IsConstrainedDeviceProvisioned(const char* clientID, bool *isBusy);
 
 #endif  /* DEVICE_MANAGER_H */
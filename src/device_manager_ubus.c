@@ -41,10 +41,22 @@
 #include <libubox/blobmsg_json.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "device_manager.h"
+#include "fdm_auto_provision.h"
+#include "fdm_provision_journal.h"
+#include "fdm_rate_limit.h"
 #include "fdm_log.h"
 
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define CONSTRAINED_REQUEST_POLL_INTERVAL (200)
+//! \}
+
 /***************************************************************************************************
  * Enums
  **************************************************************************************************/
@@ -58,9 +70,15 @@ enum {
     ARG_LICENSEE_ID,
     ARG_FCAP,
     ARG_LICENSEE_SECRET,
+    ARG_INSTANCE,
     PROVISION_GATEWAY_DEVICE_MAX
 };
 
+enum {
+    ARG_GATEWAY_INSTANCE,
+    GATEWAY_INSTANCE_MAX
+};
+
 enum {
     ARG_CONSTRAINED_CLIENT_ID,
     ARG_CONSTRAINED_DEVICE_TYPE,
@@ -71,11 +89,38 @@ enum {
     PROVISION_CONSTRAINED_DEVICE_MAX
 };
 
+enum {
+    ARG_BATCH_CLIENTS,
+    ARG_BATCH_DEVICE_TYPE,
+    ARG_BATCH_LICENSEE_ID,
+    ARG_BATCH_FCAP,
+    ARG_BATCH_PARENT_ID,
+    ARG_BATCH_TIMEOUT,
+    ARG_BATCH_WINDOW,
+    PROVISION_CONSTRAINED_DEVICES_MAX
+};
+
+enum {
+    ARG_BATCH_CLIENT_ID,
+    ARG_BATCH_CLIENT_FCAP,
+    BATCH_CLIENT_MAX
+};
+
 enum {
     ARG_CLIENT_ID,
     IS_CONSTRAINED_DEVICE_PROVISIONED_MAX
 };
 
+enum {
+    ARG_WRITES_PER_MINUTE,
+    ARG_WRITE_BURST,
+    ARG_PARENT_WRITES_PER_MINUTE,
+    ARG_PARENT_WRITE_BURST,
+    ARG_POLLS_PER_MINUTE,
+    ARG_POLL_BURST,
+    RATE_LIMITS_MAX
+};
+
 /***************************************************************************************************
  * Typedefs
  **************************************************************************************************/
@@ -88,9 +133,49 @@ typedef struct
     //! \{
     const char *logFile;
     unsigned int debugLevel;
+    const char *rulesFile;
     //! \}
 } CmdOpts;
 
+/**
+ * A gateway provisioning whose ubus reply is deferred until the FlowCloud server has answered.
+ */
+typedef struct
+{
+    //! \{
+    GatewayProvisioning *provisioning;
+    struct ubus_context *ctx;
+    struct ubus_request_data request;
+    struct uloop_timeout timer;
+    //! \}
+} PendingProvisioning;
+
+/**
+ * A constrained provisioning request run on a worker thread, whose ubus reply is deferred until the
+ * worker is done. Strings point into the copy of the request message.
+ */
+typedef struct ConstrainedRequest
+{
+    //! \{
+    struct blob_attr *msg;
+    ConstrainedDevice *devices;
+    unsigned int numDevices;
+    const char *deviceType;
+    int licenseeID;
+    const char *parentID;
+    int timeout;
+    int window;
+    bool isBatch;
+    ProvisionStatus status;
+    bool isDone;
+    pthread_t thread;
+    struct ubus_context *ctx;
+    struct ubus_request_data request;
+    struct uloop_timeout timer;
+    struct ConstrainedRequest *next;
+    //! \}
+} ConstrainedRequest;
+
 /***************************************************************************************************
  * Globals
  **************************************************************************************************/
@@ -103,8 +188,27 @@ static const struct blobmsg_policy provisionGatewayDevicePolicy[PROVISION_GATEWA
     [ARG_LICENSEE_ID] = {.name = "licensee_id", .type = BLOBMSG_TYPE_INT32},
     [ARG_FCAP] = {.name = "fcap", .type = BLOBMSG_TYPE_STRING},
     [ARG_LICENSEE_SECRET] = {.name = "licensee_secret", .type = BLOBMSG_TYPE_STRING},
+    [ARG_INSTANCE] = {.name = "instance", .type = BLOBMSG_TYPE_INT32},
+};
+
+/** Gateway instance argument of is_gateway_device_provisioned and select_gateway_instance. */
+static const struct blobmsg_policy gatewayInstancePolicy[GATEWAY_INSTANCE_MAX] =
+{
+    [ARG_GATEWAY_INSTANCE] = {.name = "instance", .type = BLOBMSG_TYPE_INT32},
 };
 
+/** Gateway provisioning in progress, at most one at a time. */
+static PendingProvisioning pendingProvisioning;
+
+/** Constrained provisioning requests in progress, only touched on the ubus thread. */
+static ConstrainedRequest *constrainedRequests;
+
+/** Guards isDone of the constrained provisioning requests. */
+static pthread_mutex_t constrainedRequestLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Dispatches client registrations to auto provisioning. */
+static struct uloop_timeout autoProvisionTimer;
+
 /** Provision constrained device arguments and their type. */
 static const struct blobmsg_policy
     provisionConstrainedDevicePolicy[PROVISION_CONSTRAINED_DEVICE_MAX] =
@@ -117,6 +221,26 @@ static const struct blobmsg_policy
     [ARG_CONSTRAINED_TIMEOUT] = {.name = "timeout", .type = BLOBMSG_TYPE_INT32}
 };
 
+/** Provision constrained devices arguments and their type. */
+static const struct blobmsg_policy
+    provisionConstrainedDevicesPolicy[PROVISION_CONSTRAINED_DEVICES_MAX] =
+{
+    [ARG_BATCH_CLIENTS] = {.name = "clients", .type = BLOBMSG_TYPE_ARRAY},
+    [ARG_BATCH_DEVICE_TYPE] = {.name = "device_type", .type = BLOBMSG_TYPE_STRING},
+    [ARG_BATCH_LICENSEE_ID] = {.name = "licensee_id", .type = BLOBMSG_TYPE_INT32},
+    [ARG_BATCH_FCAP] = {.name = "fcap", .type = BLOBMSG_TYPE_STRING},
+    [ARG_BATCH_PARENT_ID] = {.name = "parent_id", .type = BLOBMSG_TYPE_STRING},
+    [ARG_BATCH_TIMEOUT] = {.name = "timeout", .type = BLOBMSG_TYPE_INT32},
+    [ARG_BATCH_WINDOW] = {.name = "window", .type = BLOBMSG_TYPE_INT32}
+};
+
+/** Client entry of provision constrained devices, when given as a table. */
+static const struct blobmsg_policy batchClientPolicy[BATCH_CLIENT_MAX] =
+{
+    [ARG_BATCH_CLIENT_ID] = {.name = "client_id", .type = BLOBMSG_TYPE_STRING},
+    [ARG_BATCH_CLIENT_FCAP] = {.name = "fcap", .type = BLOBMSG_TYPE_STRING},
+};
+
 /** IsConstrainedDeviceProvisioned arguments and their type. */
 static const struct blobmsg_policy
     isConstrainedDeviceProvisionedPolicy[IS_CONSTRAINED_DEVICE_PROVISIONED_MAX] =
@@ -124,6 +248,17 @@ static const struct blobmsg_policy
     [ARG_CLIENT_ID] = {.name = "client_id", .type = BLOBMSG_TYPE_STRING},
 };
 
+/** Rate limits arguments and their type, all optional. */
+static const struct blobmsg_policy rateLimitsPolicy[RATE_LIMITS_MAX] =
+{
+    [ARG_WRITES_PER_MINUTE] = {.name = "writes_per_minute", .type = BLOBMSG_TYPE_INT32},
+    [ARG_WRITE_BURST] = {.name = "write_burst", .type = BLOBMSG_TYPE_INT32},
+    [ARG_PARENT_WRITES_PER_MINUTE] = {.name = "parent_writes_per_minute", .type = BLOBMSG_TYPE_INT32},
+    [ARG_PARENT_WRITE_BURST] = {.name = "parent_write_burst", .type = BLOBMSG_TYPE_INT32},
+    [ARG_POLLS_PER_MINUTE] = {.name = "polls_per_minute", .type = BLOBMSG_TYPE_INT32},
+    [ARG_POLL_BURST] = {.name = "poll_burst", .type = BLOBMSG_TYPE_INT32},
+};
+
 /***************************************************************************************************
  * Methods
  **************************************************************************************************/
@@ -136,6 +271,8 @@ static void PrintUsage(const char *program)
             " -v : Debug level from 1 to 5\n"
             "      fatal(1), error(2), warning(3), info(4), debug(5)\n"
             "      default is info\n"
+            " -r : Auto provisioning rules file\n"
+            "      default is " AUTO_PROVISION_RULES_FILE "\n"
             " -h : Print help and exit\n\n",
             program);
 }
@@ -148,10 +285,11 @@ static int ParseCommandArgs(int argc, char *argv[], CmdOpts *cmdOpts)
     /* default values */
     cmdOpts->logFile = NULL;
     cmdOpts->debugLevel = LOG_INFO;
+    cmdOpts->rulesFile = AUTO_PROVISION_RULES_FILE;
 
     while (1)
     {
-        opt = getopt(argc, argv, "l:v:");
+        opt = getopt(argc, argv, "l:v:r:");
         if (opt == -1)
         {
             break;
@@ -175,6 +313,9 @@ static int ParseCommandArgs(int argc, char *argv[], CmdOpts *cmdOpts)
                     return -1;
                 }
                 break;
+            case 'r':
+                cmdOpts->rulesFile = optarg;
+                break;
             case 'h':
                 PrintUsage(argv[0]);
                 return 0;
@@ -186,11 +327,43 @@ static int ParseCommandArgs(int argc, char *argv[], CmdOpts *cmdOpts)
     return 1;
 }
 
+static void SendProvisionStatus(struct ubus_context *ctx, struct ubus_request_data *req, ProvisionStatus status)
+{
+    struct blob_buf b = {0};
+
+    blob_buf_init(&b, 0);
+    blobmsg_add_u32(&b, "provision_status", status);
+    ubus_send_reply(ctx, req, b.head);
+    blob_buf_free(&b);
+}
+
+static void ProcessAutoProvisioning(struct uloop_timeout *timer)
+{
+    AutoProvision_Process();
+    uloop_timeout_set(timer, AUTO_PROVISION_PROCESS_INTERVAL);
+}
+
+static void PollPendingProvisioning(struct uloop_timeout *timer)
+{
+    ProvisionStatus status;
+
+    if (!PollGatewayProvisioning(pendingProvisioning.provisioning, &status))
+    {
+        uloop_timeout_set(timer, GATEWAY_PROVISIONING_POLL_INTERVAL);
+        return;
+    }
+
+    pendingProvisioning.provisioning = NULL;
+    SendProvisionStatus(pendingProvisioning.ctx, &pendingProvisioning.request, status);
+    ubus_complete_deferred_request(pendingProvisioning.ctx, &pendingProvisioning.request, UBUS_STATUS_OK);
+}
+
 static int ProvisionGatewayDeviceHandler(struct ubus_context *ctx, struct ubus_object *obj,
     struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
     struct blob_attr *args[PROVISION_GATEWAY_DEVICE_MAX];
-    struct blob_buf b = {0};
+    unsigned int instance = 0;
+    ProvisionStatus status;
 
     blobmsg_parse(provisionGatewayDevicePolicy, PROVISION_GATEWAY_DEVICE_MAX, args, blob_data(msg), blob_len(msg));
     if (!args[ARG_DEVICE_NAME] || !args[ARG_DEVICE_TYPE] || !args[ARG_LICENSEE_ID] || !args[ARG_FCAP] || !args[ARG_LICENSEE_SECRET])
@@ -201,39 +374,85 @@ static int ProvisionGatewayDeviceHandler(struct ubus_context *ctx, struct ubus_o
     char *fcap = blobmsg_get_string(args[ARG_FCAP]);
     int licenseeID = blobmsg_get_u32(args[ARG_LICENSEE_ID]);
     char *licenseeSecret = blobmsg_get_string(args[ARG_LICENSEE_SECRET]);
+    if (args[ARG_INSTANCE])
+        instance = blobmsg_get_u32(args[ARG_INSTANCE]);
 
     if (!deviceName || !deviceType || !fcap || !licenseeSecret)
         return UBUS_STATUS_UNKNOWN_ERROR;
 
-    ProvisionStatus status = ProvisionGatewayDevice(deviceName, deviceType, licenseeID, fcap, licenseeSecret);
+    if (pendingProvisioning.provisioning != NULL)
+    {
+        LOG(LOG_ERR, "Gateway provisioning is already in progress");
+        SendProvisionStatus(ctx, req, PROVISION_FAIL);
+        return UBUS_STATUS_OK;
+    }
 
-    blob_buf_init(&b, 0);
-    blobmsg_add_u32(&b, "provision_status", status);
-    ubus_send_reply(ctx, req, b.head);
-    blob_buf_free(&b);
+    // Reply once the FlowCloud server has answered, serving other requests meanwhile.
+    pendingProvisioning.provisioning = StartGatewayProvisioning(instance, deviceName, deviceType,
+        licenseeID, fcap, licenseeSecret, &status);
+    if (pendingProvisioning.provisioning == NULL)
+    {
+        SendProvisionStatus(ctx, req, status);
+        return UBUS_STATUS_OK;
+    }
 
+    pendingProvisioning.ctx = ctx;
+    ubus_defer_request(ctx, req, &pendingProvisioning.request);
+    pendingProvisioning.timer.cb = PollPendingProvisioning;
+    uloop_timeout_set(&pendingProvisioning.timer, GATEWAY_PROVISIONING_POLL_INTERVAL);
     return UBUS_STATUS_OK;
 }
 
 static int IsGatewayDeviceProvisionedHandler(struct ubus_context *ctx, struct ubus_object *obj,
     struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
+    struct blob_attr *args[GATEWAY_INSTANCE_MAX];
     struct blob_buf b = {0};
+    unsigned int instance = 0;
+
+    blobmsg_parse(gatewayInstancePolicy, GATEWAY_INSTANCE_MAX, args, blob_data(msg), blob_len(msg));
+    if (args[ARG_GATEWAY_INSTANCE])
+        instance = blobmsg_get_u32(args[ARG_GATEWAY_INSTANCE]);
+
     blob_buf_init(&b, 0);
-    bool ret = IsGatewayDeviceProvisioned();
+    bool ret = IsGatewayDeviceInstanceProvisioned(instance);
     blobmsg_add_u8(&b, "provision_status", ret);
     ubus_send_reply(ctx, req, b.head);
     blob_buf_free(&b);
     return UBUS_STATUS_OK;
 }
 
-static int GetClientListHandler(struct ubus_context *ctx, struct ubus_object *obj,
+static int SelectGatewayInstanceHandler(struct ubus_context *ctx, struct ubus_object *obj,
     struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
+    struct blob_attr *args[GATEWAY_INSTANCE_MAX];
     struct blob_buf b = {0};
+
+    blobmsg_parse(gatewayInstancePolicy, GATEWAY_INSTANCE_MAX, args, blob_data(msg), blob_len(msg));
+    if (!args[ARG_GATEWAY_INSTANCE])
+        return UBUS_STATUS_INVALID_ARGUMENT;
+
+    bool ret = SelectGatewayInstance(blobmsg_get_u32(args[ARG_GATEWAY_INSTANCE]));
+
     blob_buf_init(&b, 0);
+    blobmsg_add_u8(&b, "select_status", ret);
+    blobmsg_add_u32(&b, "instance", GetSelectedGatewayInstance());
+    ubus_send_reply(ctx, req, b.head);
+    blob_buf_free(&b);
+    return UBUS_STATUS_OK;
+}
+
+static int GetClientListHandler(struct ubus_context *ctx, struct ubus_object *obj,
+    struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+    struct blob_buf b = {0};
     json_object *respObj = json_object_new_object();
-    GetClientList(respObj);
+    if (!GetClientList(respObj))
+    {
+        json_object_put(respObj);
+        return UBUS_STATUS_TIMEOUT;
+    }
+    blob_buf_init(&b, 0);
     blobmsg_add_json_from_string(&b, json_object_get_string(respObj));
     ubus_send_reply(ctx, req, b.head);
     blob_buf_free(&b);
@@ -242,40 +461,342 @@ static int GetClientListHandler(struct ubus_context *ctx, struct ubus_object *ob
 }
 
 
+static void FreeConstrainedRequest(ConstrainedRequest *request)
+{
+    free(request->devices);
+    free(request->msg);
+    free(request);
+}
+
+/**
+ * @brief Copy a constrained provisioning request message, so that it outlives the handler.
+ * @return Request with its devices still to be filled in, or NULL if out of memory.
+ */
+static ConstrainedRequest *NewConstrainedRequest(struct blob_attr *msg, unsigned int numDevices)
+{
+    ConstrainedRequest *request = calloc(1, sizeof(*request));
+
+    if (request == NULL || (request->msg = blob_memdup(msg)) == NULL ||
+        (request->devices = calloc(numDevices, sizeof(ConstrainedDevice))) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate constrained provisioning request");
+        if (request != NULL)
+        {
+            FreeConstrainedRequest(request);
+        }
+        return NULL;
+    }
+    request->numDevices = numDevices;
+    request->timeout = DEFAULT_PROVSIONING_TIMEOUT;
+    request->window = DEFAULT_PROVISIONING_WINDOW;
+    return request;
+}
+
+static void *ConstrainedProvisioningWorker(void *arg)
+{
+    ConstrainedRequest *request = arg;
+
+    if (request->isBatch)
+    {
+        LOG(LOG_INFO, "Provision %u constrained devices, %d at a time", request->numDevices, request->window);
+        ProvisionConstrainedDevices(request->devices, request->numDevices, request->deviceType,
+            request->licenseeID, request->parentID, request->timeout, request->window);
+    }
+    else
+    {
+        request->status = ProvisionConstrainedDevice(request->devices[0].clientID, request->devices[0].fcap,
+            request->deviceType, request->licenseeID, request->parentID, request->timeout);
+    }
+
+    pthread_mutex_lock(&constrainedRequestLock);
+    request->isDone = true;
+    pthread_mutex_unlock(&constrainedRequestLock);
+    return NULL;
+}
+
+static void SendConstrainedResults(struct ubus_context *ctx, struct ubus_request_data *req,
+    const ConstrainedRequest *request)
+{
+    struct blob_buf b = {0};
+    void *results, *result;
+    unsigned int i;
+
+    blob_buf_init(&b, 0);
+    if (!request->isBatch)
+    {
+        blobmsg_add_u32(&b, "status", request->status);
+    }
+    else
+    {
+        results = blobmsg_open_array(&b, "results");
+        for (i = 0; i < request->numDevices; i++)
+        {
+            const ConstrainedDevice *device = &request->devices[i];
+
+            result = blobmsg_open_table(&b, NULL);
+            blobmsg_add_string(&b, "client_id", device->clientID);
+            blobmsg_add_u32(&b, "status", device->status);
+            if (device->writeTime >= 0)
+                blobmsg_add_u32(&b, "write_time", device->writeTime);
+            if (device->provisionTime >= 0)
+                blobmsg_add_u32(&b, "provision_time", device->provisionTime);
+            blobmsg_close_table(&b, result);
+        }
+        blobmsg_close_array(&b, results);
+    }
+    ubus_send_reply(ctx, req, b.head);
+    blob_buf_free(&b);
+}
+
+static void PollConstrainedRequest(struct uloop_timeout *timer)
+{
+    ConstrainedRequest *request = container_of(timer, ConstrainedRequest, timer);
+    ConstrainedRequest **link;
+    bool isDone;
+
+    pthread_mutex_lock(&constrainedRequestLock);
+    isDone = request->isDone;
+    pthread_mutex_unlock(&constrainedRequestLock);
+    if (!isDone)
+    {
+        uloop_timeout_set(timer, CONSTRAINED_REQUEST_POLL_INTERVAL);
+        return;
+    }
+
+    pthread_join(request->thread, NULL);
+    SendConstrainedResults(request->ctx, &request->request, request);
+    ubus_complete_deferred_request(request->ctx, &request->request, UBUS_STATUS_OK);
+
+    for (link = &constrainedRequests; *link != request; link = &(*link)->next)
+    {
+    }
+    *link = request->next;
+    FreeConstrainedRequest(request);
+}
+
+/**
+ * @brief Provision on a worker thread and reply from PollConstrainedRequest once it's done, so that
+ *        ubus and the timers of the loop are served meanwhile.
+ * @param[in] ctx ubus context.
+ * @param[in] req Request to defer.
+ * @param[in] request Parsed request, owned from here on.
+ */
+static void StartConstrainedRequest(struct ubus_context *ctx, struct ubus_request_data *req,
+    ConstrainedRequest *request)
+{
+    if (pthread_create(&request->thread, NULL, ConstrainedProvisioningWorker, request) != 0)
+    {
+        LOG(LOG_WARN, "Failed to start constrained provisioning worker, provisioning here");
+        ConstrainedProvisioningWorker(request);
+        SendConstrainedResults(ctx, req, request);
+        FreeConstrainedRequest(request);
+        return;
+    }
+
+    request->ctx = ctx;
+    ubus_defer_request(ctx, req, &request->request);
+    request->timer.cb = PollConstrainedRequest;
+    uloop_timeout_set(&request->timer, CONSTRAINED_REQUEST_POLL_INTERVAL);
+    request->next = constrainedRequests;
+    constrainedRequests = request;
+}
+
+/**
+ * @brief Wait for the constrained provisioning requests still running, without replying to them.
+ */
+static void StopConstrainedRequests(void)
+{
+    ConstrainedRequest *request;
+
+    while ((request = constrainedRequests) != NULL)
+    {
+        LOG(LOG_INFO, "Waiting for constrained provisioning of %u devices to finish", request->numDevices);
+        uloop_timeout_cancel(&request->timer);
+        pthread_join(request->thread, NULL);
+        constrainedRequests = request->next;
+        FreeConstrainedRequest(request);
+    }
+}
+
 static int ProvisionConstrainedDeviceHandler(struct ubus_context *ctx, struct ubus_object *obj,
     struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
     struct blob_attr *args[PROVISION_CONSTRAINED_DEVICE_MAX];
-    struct blob_buf b = {0};
-    int timeout;
+    ConstrainedRequest *request;
+
+    if ((request = NewConstrainedRequest(msg, 1)) == NULL)
+        return UBUS_STATUS_UNKNOWN_ERROR;
 
-    blobmsg_parse(provisionConstrainedDevicePolicy, PROVISION_CONSTRAINED_DEVICE_MAX, args, blob_data(msg), blob_len(msg));
+    blobmsg_parse(provisionConstrainedDevicePolicy, PROVISION_CONSTRAINED_DEVICE_MAX, args,
+        blob_data(request->msg), blob_len(request->msg));
     if (!args[ARG_CONSTRAINED_DEVICE_TYPE] || !args[ARG_CONSTRAINED_LICENSEE_ID] ||
-        !args[ARG_CONSTRAINED_CLIENT_ID] || !args[ARG_CONSTRAINED_FCAP] ||
-        !args[ARG_CONSTRAINED_PARENT_ID])
+        !args[ARG_CONSTRAINED_CLIENT_ID] || !args[ARG_CONSTRAINED_FCAP])
+    {
+        FreeConstrainedRequest(request);
         return UBUS_STATUS_INVALID_ARGUMENT;
+    }
 
-    char *deviceType = blobmsg_get_string(args[ARG_CONSTRAINED_DEVICE_TYPE]);
-    int licenseeID = blobmsg_get_u32(args[ARG_CONSTRAINED_LICENSEE_ID]);
-    char *clientID = blobmsg_get_string(args[ARG_CONSTRAINED_CLIENT_ID]);
-    char *fcap = blobmsg_get_string(args[ARG_CONSTRAINED_FCAP]);
-    char *parentID = blobmsg_get_string(args[ARG_CONSTRAINED_PARENT_ID]);
+    request->deviceType = blobmsg_get_string(args[ARG_CONSTRAINED_DEVICE_TYPE]);
+    request->licenseeID = blobmsg_get_u32(args[ARG_CONSTRAINED_LICENSEE_ID]);
+    request->devices[0].clientID = blobmsg_get_string(args[ARG_CONSTRAINED_CLIENT_ID]);
+    request->devices[0].fcap = blobmsg_get_string(args[ARG_CONSTRAINED_FCAP]);
+    if (args[ARG_CONSTRAINED_PARENT_ID])
+        request->parentID = blobmsg_get_string(args[ARG_CONSTRAINED_PARENT_ID]);
+    if (args[ARG_CONSTRAINED_TIMEOUT])
+        request->timeout = blobmsg_get_u32(args[ARG_CONSTRAINED_TIMEOUT]);
 
-    if (!args[ARG_CONSTRAINED_TIMEOUT])
-        timeout = DEFAULT_PROVSIONING_TIMEOUT;
+    if (!request->deviceType || !request->devices[0].clientID || !request->devices[0].fcap)
+    {
+        FreeConstrainedRequest(request);
+        return UBUS_STATUS_UNKNOWN_ERROR;
+    }
+
+    StartConstrainedRequest(ctx, req, request);
+    return UBUS_STATUS_OK;
+}
+
+/**
+ * @brief Fill a batch device from an entry of the clients array, either a client ID or a table with
+ *        client_id and its own fcap.
+ * @return true if the entry is valid, else false.
+ */
+static bool ParseBatchClient(struct blob_attr *entry, const char *fcap, ConstrainedDevice *device)
+{
+    struct blob_attr *args[BATCH_CLIENT_MAX];
+
+    if (blobmsg_type(entry) == BLOBMSG_TYPE_STRING)
+    {
+        device->clientID = blobmsg_get_string(entry);
+        device->fcap = fcap;
+    }
+    else if (blobmsg_type(entry) == BLOBMSG_TYPE_TABLE)
+    {
+        blobmsg_parse(batchClientPolicy, BATCH_CLIENT_MAX, args, blobmsg_data(entry), blobmsg_data_len(entry));
+        device->clientID = args[ARG_BATCH_CLIENT_ID] ? blobmsg_get_string(args[ARG_BATCH_CLIENT_ID]) : NULL;
+        device->fcap = args[ARG_BATCH_CLIENT_FCAP] ? blobmsg_get_string(args[ARG_BATCH_CLIENT_FCAP]) : fcap;
+    }
     else
-        timeout = blobmsg_get_u32(args[ARG_CONSTRAINED_TIMEOUT]);
+    {
+        return false;
+    }
+    return device->clientID != NULL && device->fcap != NULL;
+}
 
-    if (!deviceType || !clientID || !fcap || !parentID)
+static int ProvisionConstrainedDevicesHandler(struct ubus_context *ctx, struct ubus_object *obj,
+    struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+    struct blob_attr *args[PROVISION_CONSTRAINED_DEVICES_MAX];
+    struct blob_attr *entry;
+    ConstrainedRequest *request;
+    unsigned int numDevices = 0, i;
+    const char *fcap = NULL;
+    int rem;
+
+    blobmsg_parse(provisionConstrainedDevicesPolicy, PROVISION_CONSTRAINED_DEVICES_MAX, args, blob_data(msg), blob_len(msg));
+    if (!args[ARG_BATCH_CLIENTS] || !args[ARG_BATCH_DEVICE_TYPE] || !args[ARG_BATCH_LICENSEE_ID])
+        return UBUS_STATUS_INVALID_ARGUMENT;
+
+    blobmsg_for_each_attr(entry, args[ARG_BATCH_CLIENTS], rem)
+    {
+        numDevices++;
+    }
+    if (numDevices == 0)
+        return UBUS_STATUS_INVALID_ARGUMENT;
+
+    // Parse again from the copy, which the worker keeps using after this handler returns.
+    if ((request = NewConstrainedRequest(msg, numDevices)) == NULL)
+        return UBUS_STATUS_UNKNOWN_ERROR;
+    blobmsg_parse(provisionConstrainedDevicesPolicy, PROVISION_CONSTRAINED_DEVICES_MAX, args,
+        blob_data(request->msg), blob_len(request->msg));
+
+    request->isBatch = true;
+    request->deviceType = blobmsg_get_string(args[ARG_BATCH_DEVICE_TYPE]);
+    request->licenseeID = blobmsg_get_u32(args[ARG_BATCH_LICENSEE_ID]);
+    if (args[ARG_BATCH_PARENT_ID])
+        request->parentID = blobmsg_get_string(args[ARG_BATCH_PARENT_ID]);
+    if (args[ARG_BATCH_FCAP])
+        fcap = blobmsg_get_string(args[ARG_BATCH_FCAP]);
+    if (args[ARG_BATCH_TIMEOUT])
+        request->timeout = blobmsg_get_u32(args[ARG_BATCH_TIMEOUT]);
+    if (args[ARG_BATCH_WINDOW])
+        request->window = blobmsg_get_u32(args[ARG_BATCH_WINDOW]);
+
+    if (!request->deviceType)
+    {
+        FreeConstrainedRequest(request);
         return UBUS_STATUS_UNKNOWN_ERROR;
+    }
 
-    ProvisionStatus status = ProvisionConstrainedDevice(clientID, fcap, deviceType, licenseeID, parentID, timeout);
+    i = 0;
+    blobmsg_for_each_attr(entry, args[ARG_BATCH_CLIENTS], rem)
+    {
+        if (!ParseBatchClient(entry, fcap, &request->devices[i++]))
+        {
+            FreeConstrainedRequest(request);
+            return UBUS_STATUS_INVALID_ARGUMENT;
+        }
+    }
+
+    StartConstrainedRequest(ctx, req, request);
+    return UBUS_STATUS_OK;
+}
+
+static void AddRateLimitStats(struct blob_buf *b, const char *name, const RateLimitStats *stats)
+{
+    void *table = blobmsg_open_table(b, name);
+
+    blobmsg_add_u32(b, "queue_depth", stats->queueDepth);
+    blobmsg_add_u64(b, "acquired", stats->numAcquired);
+    blobmsg_add_u64(b, "timed_out", stats->numTimedOut);
+    blobmsg_add_u64(b, "total_wait_ms", stats->totalWaitMs);
+    blobmsg_add_u64(b, "max_wait_ms", stats->maxWaitMs);
+    blobmsg_close_table(b, table);
+}
+
+static int RateLimitsHandler(struct ubus_context *ctx, struct ubus_object *obj,
+    struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+    struct blob_attr *args[RATE_LIMITS_MAX];
+    struct blob_buf b = {0};
+    RateLimitConfig config;
+    RateLimitStats writeStats, pollStats;
+    unsigned int *values[RATE_LIMITS_MAX] =
+    {
+        [ARG_WRITES_PER_MINUTE] = &config.writesPerMinute,
+        [ARG_WRITE_BURST] = &config.writeBurst,
+        [ARG_PARENT_WRITES_PER_MINUTE] = &config.parentWritesPerMinute,
+        [ARG_PARENT_WRITE_BURST] = &config.parentWriteBurst,
+        [ARG_POLLS_PER_MINUTE] = &config.pollsPerMinute,
+        [ARG_POLL_BURST] = &config.pollBurst,
+    };
+    bool isChanged = false;
+    int i;
+
+    blobmsg_parse(rateLimitsPolicy, RATE_LIMITS_MAX, args, blob_data(msg), blob_len(msg));
+    RateLimit_GetConfig(&config);
+    for (i = 0; i < RATE_LIMITS_MAX; i++)
+    {
+        if (args[i])
+        {
+            *values[i] = blobmsg_get_u32(args[i]);
+            isChanged = true;
+        }
+    }
+    if (isChanged)
+    {
+        RateLimit_Configure(&config);
+    }
+    RateLimit_GetStats(&writeStats, &pollStats);
 
     blob_buf_init(&b, 0);
-    blobmsg_add_u32(&b, "status", status);
+    for (i = 0; i < RATE_LIMITS_MAX; i++)
+    {
+        blobmsg_add_u32(&b, rateLimitsPolicy[i].name, *values[i]);
+    }
+    AddRateLimitStats(&b, "writes", &writeStats);
+    AddRateLimitStats(&b, "polls", &pollStats);
     ubus_send_reply(ctx, req, b.head);
     blob_buf_free(&b);
-
     return UBUS_STATUS_OK;
 }
 
@@ -292,7 +813,12 @@ static int IsConstrainedDeviceProvisionedHandler(struct ubus_context *ctx, struc
     if (!clientID)
         return UBUS_STATUS_UNKNOWN_ERROR;
 
-    bool ret = IsConstrainedDeviceProvisioned(clientID);
+    bool isBusy = false;
+    bool ret = IsConstrainedDeviceProvisioned(clientID, &isBusy);
+    if (isBusy)
+    {
+        return UBUS_STATUS_TIMEOUT;
+    }
 
     blob_buf_init(&b, 0);
     blobmsg_add_u8(&b, "provision_status", ret);
@@ -317,8 +843,11 @@ int main(int argc, char **argv)
     {
         UBUS_METHOD("provision_gateway_device", ProvisionGatewayDeviceHandler, provisionGatewayDevicePolicy),
         UBUS_METHOD("provision_constrained_device", ProvisionConstrainedDeviceHandler, provisionConstrainedDevicePolicy),
+        UBUS_METHOD("provision_constrained_devices", ProvisionConstrainedDevicesHandler, provisionConstrainedDevicesPolicy),
         UBUS_METHOD("is_constrained_device_provisioned", IsConstrainedDeviceProvisionedHandler, isConstrainedDeviceProvisionedPolicy),
-        UBUS_METHOD_NOARG("is_gateway_device_provisioned", IsGatewayDeviceProvisionedHandler),
+        UBUS_METHOD("is_gateway_device_provisioned", IsGatewayDeviceProvisionedHandler, gatewayInstancePolicy),
+        UBUS_METHOD("select_gateway_instance", SelectGatewayInstanceHandler, gatewayInstancePolicy),
+        UBUS_METHOD("rate_limits", RateLimitsHandler, rateLimitsPolicy),
         UBUS_METHOD_NOARG("get_client_list", GetClientListHandler)
     };
     struct ubus_object_type flowDeviceManagerObjectType = UBUS_OBJECT_TYPE("device_manager", flowDeviceManagerMethods);
@@ -354,8 +883,25 @@ int main(int argc, char **argv)
         return -1;
     }
     ubus_add_uloop(ctx);
+
+    if (!ProvisionJournal_Start(PROVISION_JOURNAL_FILE))
+    {
+        LOG(LOG_WARN, "Failed constrained provisionings won't be retried");
+    }
+    if (!AutoProvision_Start(cmdOpts.rulesFile))
+    {
+        LOG(LOG_WARN, "Auto provisioning disabled");
+    }
+    autoProvisionTimer.cb = ProcessAutoProvisioning;
+    uloop_timeout_set(&autoProvisionTimer, AUTO_PROVISION_PROCESS_INTERVAL);
     uloop_run();
 
+    uloop_timeout_cancel(&autoProvisionTimer);
+    AutoProvision_Stop();
+    StopConstrainedRequests();
+    ProvisionJournal_Stop();
+    uloop_timeout_cancel(&pendingProvisioning.timer);
+    CancelGatewayProvisioning(pendingProvisioning.provisioning);
     ReleaseSession();
     if (logFile)
         fclose(logFile);
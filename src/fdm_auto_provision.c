@@ -0,0 +1,549 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_auto_provision.c
+ * @brief Provisions constrained devices automatically, by rules, when they register.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "awa/common.h"
+#include "awa/server.h"
+#include "device_manager.h"
+#include "fdm_auto_provision.h"
+#include "fdm_auto_provision_rules.h"
+#include "fdm_provision_constrained.h"
+#include "fdm_server_session.h"
+#include "fdm_common.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define AUTO_PROVISION_QUEUE_SIZE   (64)
+#define MAX_START_JITTER            (10000)
+#define DEVICE_READ_TIMEOUT         (10000)
+#define MANUFACTURER_PATH           "/3/0/0"
+#define MODEL_NUMBER_PATH           "/3/0/1"
+//! \}
+
+#if AUTO_PROVISION_MAX_WINDOW != MAX_PROVISIONING_WINDOW
+#error "The auto provisioning window must be clamped to the provisioning window"
+#endif
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A client waiting to be provisioned, not before its jittered start time.
+ */
+typedef struct
+{
+    //! \{
+    char *clientID;
+    int64_t notBefore;
+    //! \}
+} QueuedClient;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static AutoProvisionRules ruleSet = {.timeout = DEFAULT_PROVSIONING_TIMEOUT, .window = DEFAULT_PROVISIONING_WINDOW};
+static char flowAccessInstancePath[URL_PATH_SIZE];
+
+static AwaServerSession *eventSession = NULL;
+static QueuedClient queue[AUTO_PROVISION_QUEUE_SIZE];
+static unsigned int queueLength = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueChanged;
+static pthread_t worker;
+static bool isRunning = false;
+static unsigned int jitterSeed;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static int64_t GetMonotonicTimeMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+//! \}
+
+/**
+ * @brief Read the manufacturer and model number of a client from its Device object.
+ * @param[in] session Holds server session.
+ * @param[in] clientID Client ID.
+ * @param[out] manufacturer Manufacturer, empty if not read.
+ * @param[out] modelNumber Model number, empty if not read.
+ */
+static void ReadDeviceFields(const AwaServerSession *session, const char *clientID,
+    char manufacturer[MAX_STR_SIZE], char modelNumber[MAX_STR_SIZE])
+{
+    AwaServerReadOperation *operation;
+    const AwaServerReadResponse *response;
+    const char *value;
+    AwaError error;
+
+    manufacturer[0] = '\0';
+    modelNumber[0] = '\0';
+
+    operation = AwaServerReadOperation_New(session);
+    if (operation == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create read operation");
+        return;
+    }
+
+    if ((error = AwaServerReadOperation_AddPath(operation, clientID, MANUFACTURER_PATH)) == AwaError_Success &&
+        (error = AwaServerReadOperation_AddPath(operation, clientID, MODEL_NUMBER_PATH)) == AwaError_Success &&
+        (error = AwaServerReadOperation_Perform(operation, DEVICE_READ_TIMEOUT)) == AwaError_Success)
+    {
+        response = AwaServerReadOperation_GetResponse(operation, clientID);
+        if (response != NULL &&
+            AwaServerReadResponse_GetValueAsCStringPointer(response, MANUFACTURER_PATH, &value) == AwaError_Success)
+        {
+            snprintf(manufacturer, MAX_STR_SIZE, "%s", value);
+        }
+        if (response != NULL &&
+            AwaServerReadResponse_GetValueAsCStringPointer(response, MODEL_NUMBER_PATH, &value) == AwaError_Success)
+        {
+            snprintf(modelNumber, MAX_STR_SIZE, "%s", value);
+        }
+    }
+    else
+    {
+        LOG(LOG_ERR, "Failed to read device object of %s\nerror: %s", clientID, AwaError_ToString(error));
+    }
+    AwaServerReadOperation_Free(&operation);
+}
+
+/**
+ * @brief Find the first rule matching a client, reading its Device object only if a rule needs it.
+ * @param[in] session Holds server session, may be NULL if it couldn't be established.
+ * @param[in] clientID Client ID.
+ * @return matching rule, or NULL.
+ */
+static const AutoProvisionRule *FindRule(const AwaServerSession *session, const char *clientID)
+{
+    char manufacturer[MAX_STR_SIZE], modelNumber[MAX_STR_SIZE];
+    bool isDeviceRead = false;
+    unsigned int i;
+
+    for (i = 0; i < ruleSet.numRules; i++)
+    {
+        const AutoProvisionRule *rule = &ruleSet.rules[i];
+
+        if (!AutoProvisionRules_IsClientIDMatching(rule, clientID))
+        {
+            continue;
+        }
+        if (rule->manufacturer != NULL || rule->modelNumber != NULL)
+        {
+            if (session == NULL)
+            {
+                continue;
+            }
+            if (!isDeviceRead)
+            {
+                ReadDeviceFields(session, clientID, manufacturer, modelNumber);
+                isDeviceRead = true;
+            }
+            if ((rule->manufacturer != NULL && strcmp(rule->manufacturer, manufacturer) != 0) ||
+                (rule->modelNumber != NULL && strcmp(rule->modelNumber, modelNumber) != 0))
+            {
+                continue;
+            }
+        }
+        return rule;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Provision clients taken from the queue, in one batch per rule.
+ * @param[in] clientIDs Client IDs.
+ * @param[in] numClients Number of clients.
+ */
+static void ProvisionClients(char *clientIDs[], unsigned int numClients)
+{
+    const AutoProvisionRule *clientRules[AUTO_PROVISION_QUEUE_SIZE];
+    ConstrainedDevice devices[AUTO_PROVISION_QUEUE_SIZE];
+    AwaServerSession *session;
+    unsigned int i, j, numDevices;
+
+    session = Server_AcquireSession();
+    for (i = 0; i < numClients; i++)
+    {
+        clientRules[i] = FindRule(session, clientIDs[i]);
+        if (clientRules[i] == NULL)
+        {
+            LOG(LOG_INFO, "No auto provisioning rule matches %s", clientIDs[i]);
+        }
+    }
+    Server_ReturnSession(&session, true);
+
+    for (i = 0; i < numClients; i++)
+    {
+        if (clientRules[i] == NULL)
+        {
+            continue;
+        }
+
+        numDevices = 0;
+        for (j = i; j < numClients; j++)
+        {
+            if (clientRules[j] == clientRules[i])
+            {
+                devices[numDevices].clientID = clientIDs[j];
+                devices[numDevices].fcap = clientRules[i]->fcap;
+                numDevices++;
+                if (j != i)
+                {
+                    clientRules[j] = NULL;
+                }
+            }
+        }
+
+        LOG(LOG_INFO, "Auto provisioning %u device(s) as %s", numDevices, clientRules[i]->deviceType);
+        ProvisionConstrainedDevices(devices, numDevices, clientRules[i]->deviceType, clientRules[i]->licenseeID,
+            ruleSet.parentID, ruleSet.timeout, ruleSet.window);
+        for (j = 0; j < numDevices; j++)
+        {
+            LOG(LOG_INFO, "Auto provisioning of %s: status = %d", devices[j].clientID, devices[j].status);
+        }
+    }
+}
+
+/**
+ * @brief Take clients from the queue once their start time has come, at most a window at a time,
+ *        and provision them.
+ * @param[in] arg Unused.
+ * @return NULL.
+ */
+static void *AutoProvisionWorker(void *arg)
+{
+    char *clientIDs[AUTO_PROVISION_QUEUE_SIZE];
+    unsigned int i, numClients;
+    int64_t now, nextStart;
+    struct timespec wakeUp;
+
+    (void)arg;
+    pthread_mutex_lock(&queueLock);
+    while (isRunning)
+    {
+        now = GetMonotonicTimeMs();
+        nextStart = INT64_MAX;
+        numClients = 0;
+        for (i = 0; i < queueLength; )
+        {
+            if (queue[i].notBefore <= now && numClients < ruleSet.window)
+            {
+                clientIDs[numClients++] = queue[i].clientID;
+                queue[i] = queue[--queueLength];
+                continue;
+            }
+            if (queue[i].notBefore < nextStart)
+            {
+                nextStart = queue[i].notBefore;
+            }
+            i++;
+        }
+
+        if (numClients != 0)
+        {
+            pthread_mutex_unlock(&queueLock);
+            ProvisionClients(clientIDs, numClients);
+            for (i = 0; i < numClients; i++)
+            {
+                free(clientIDs[i]);
+            }
+            pthread_mutex_lock(&queueLock);
+        }
+        else if (queueLength == 0)
+        {
+            pthread_cond_wait(&queueChanged, &queueLock);
+        }
+        else
+        {
+            wakeUp.tv_sec = nextStart / 1000;
+            wakeUp.tv_nsec = (nextStart % 1000) * 1000000;
+            pthread_cond_timedwait(&queueChanged, &queueLock, &wakeUp);
+        }
+    }
+    pthread_mutex_unlock(&queueLock);
+    return NULL;
+}
+
+/**
+ * @brief Queue a client for provisioning with a jittered start time, so that clients registering
+ *        together are spread out.
+ * @param[in] clientID Client ID.
+ */
+static void QueueClient(const char *clientID)
+{
+    unsigned int i;
+    char *queuedID;
+
+    pthread_mutex_lock(&queueLock);
+    for (i = 0; i < queueLength; i++)
+    {
+        if (strcmp(queue[i].clientID, clientID) == 0)
+        {
+            pthread_mutex_unlock(&queueLock);
+            return;
+        }
+    }
+
+    if (queueLength == AUTO_PROVISION_QUEUE_SIZE)
+    {
+        LOG(LOG_WARN, "Auto provisioning queue full, not provisioning %s", clientID);
+    }
+    else if ((queuedID = strdup(clientID)) != NULL)
+    {
+        LOG(LOG_DBG, "Queuing %s for auto provisioning", clientID);
+        queue[queueLength].clientID = queuedID;
+        queue[queueLength].notBefore = GetMonotonicTimeMs() + rand_r(&jitterSeed) % MAX_START_JITTER;
+        queueLength++;
+        pthread_cond_signal(&queueChanged);
+    }
+    pthread_mutex_unlock(&queueLock);
+}
+
+/**
+ * @brief Queue a client that registered, unless it is provisioned already or no rule can match it.
+ * @param[in] clientID Client ID.
+ * @param[in] objectIterator Registered objects of the client.
+ */
+static void CheckRegisteredClient(const char *clientID, AwaRegisteredEntityIterator *objectIterator)
+{
+    unsigned int i;
+
+    while (AwaRegisteredEntityIterator_Next(objectIterator))
+    {
+        if (strcmp(AwaRegisteredEntityIterator_GetPath(objectIterator), flowAccessInstancePath) == 0)
+        {
+            return;
+        }
+    }
+
+    for (i = 0; i < ruleSet.numRules; i++)
+    {
+        if (AutoProvisionRules_IsClientIDMatching(&ruleSet.rules[i], clientID))
+        {
+            QueueClient(clientID);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Check clients that have just registered.
+ * @param[in] event Registration event.
+ * @param[in] context Unused.
+ */
+static void ClientRegisterCallback(const AwaServerClientRegisterEvent *event, void *context)
+{
+    AwaClientIterator *clientIterator;
+    AwaRegisteredEntityIterator *objectIterator;
+
+    clientIterator = AwaServerClientRegisterEvent_NewClientIterator(event);
+    if (clientIterator == NULL)
+    {
+        return;
+    }
+    while (AwaClientIterator_Next(clientIterator))
+    {
+        const char *clientID = AwaClientIterator_GetClientID(clientIterator);
+
+        objectIterator = AwaServerClientRegisterEvent_NewRegisteredEntityIterator(event, clientID);
+        if (objectIterator != NULL)
+        {
+            CheckRegisteredClient(clientID, objectIterator);
+            AwaRegisteredEntityIterator_Free(&objectIterator);
+        }
+    }
+    AwaClientIterator_Free(&clientIterator);
+}
+
+/**
+ * @brief Check the clients that registered before auto provisioning started.
+ * @param[in] session Holds server session.
+ */
+static void CheckRegisteredClients(const AwaServerSession *session)
+{
+    AwaServerListClientsOperation *operation;
+    AwaClientIterator *clientIterator;
+    AwaRegisteredEntityIterator *objectIterator;
+    AwaError error;
+
+    operation = AwaServerListClientsOperation_New(session);
+    if (operation == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create new ListClientsOperation");
+        return;
+    }
+
+    error = AwaServerListClientsOperation_Perform(operation, IPC_TIMEOUT);
+    if (error == AwaError_Success && (clientIterator = AwaServerListClientsOperation_NewClientIterator(operation)) != NULL)
+    {
+        while (AwaClientIterator_Next(clientIterator))
+        {
+            const char *clientID = AwaClientIterator_GetClientID(clientIterator);
+            const AwaServerListClientsResponse *response = AwaServerListClientsOperation_GetResponse(operation, clientID);
+
+            objectIterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(response);
+            if (objectIterator != NULL)
+            {
+                CheckRegisteredClient(clientID, objectIterator);
+                AwaRegisteredEntityIterator_Free(&objectIterator);
+            }
+        }
+        AwaClientIterator_Free(&clientIterator);
+    }
+    else
+    {
+        LOG(LOG_ERR, "Failed to list registered clients\nerror: %s", AwaError_ToString(error));
+    }
+    AwaServerListClientsOperation_Free(&operation);
+}
+
+bool AutoProvision_Start(const char *rulesFile)
+{
+    pthread_condattr_t conditionAttributes;
+
+    if (rulesFile == NULL || access(rulesFile, F_OK) != 0)
+    {
+        LOG(LOG_INFO, "No auto provisioning rules, auto provisioning disabled");
+        return true;
+    }
+    if (!AutoProvisionRules_Load(&ruleSet, rulesFile))
+    {
+        return false;
+    }
+    if (AwaAPI_MakeObjectInstancePath(flowAccessInstancePath, URL_PATH_SIZE, Lwm2mObjectId_FlowAccess,
+        OBJECT_INSTANCE_ID) != AwaError_Success)
+    {
+        LOG(LOG_ERR, "Couldn't generate flow access instance path");
+        AutoProvisionRules_Free(&ruleSet);
+        return false;
+    }
+
+    // Registrations are received on a session of their own, kept out of the pool.
+    eventSession = Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+    if (eventSession == NULL)
+    {
+        AutoProvisionRules_Free(&ruleSet);
+        return false;
+    }
+    AwaServerSession_SetClientRegisterEventCallback(eventSession, ClientRegisterCallback, NULL);
+
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&queueChanged, &conditionAttributes);
+    pthread_condattr_destroy(&conditionAttributes);
+    jitterSeed = (unsigned int)GetMonotonicTimeMs();
+
+    isRunning = true;
+    if (pthread_create(&worker, NULL, AutoProvisionWorker, NULL) != 0)
+    {
+        LOG(LOG_ERR, "Failed to start auto provisioning thread");
+        isRunning = false;
+        pthread_cond_destroy(&queueChanged);
+        Server_ReleaseSession(&eventSession);
+        AutoProvisionRules_Free(&ruleSet);
+        return false;
+    }
+
+    LOG(LOG_INFO, "Auto provisioning with %u rule(s)", ruleSet.numRules);
+    CheckRegisteredClients(eventSession);
+    return true;
+}
+
+void AutoProvision_Process(void)
+{
+    if (eventSession == NULL)
+    {
+        return;
+    }
+    if (AwaServerSession_Process(eventSession, 0) == AwaError_Success)
+    {
+        AwaServerSession_DispatchCallbacks(eventSession);
+    }
+}
+
+void AutoProvision_Stop(void)
+{
+    unsigned int i;
+
+    if (eventSession == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&queueLock);
+    isRunning = false;
+    pthread_cond_signal(&queueChanged);
+    pthread_mutex_unlock(&queueLock);
+    pthread_join(worker, NULL);
+    pthread_cond_destroy(&queueChanged);
+
+    for (i = 0; i < queueLength; i++)
+    {
+        free(queue[i].clientID);
+    }
+    queueLength = 0;
+
+    AwaServerSession_SetClientRegisterEventCallback(eventSession, NULL, NULL);
+    Server_ReleaseSession(&eventSession);
+    eventSession = NULL;
+    AutoProvisionRules_Free(&ruleSet);
+}
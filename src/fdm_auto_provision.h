@@ -0,0 +1,74 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_auto_provision.h
+ * @brief Header file for exposing automatic provisioning of constrained devices by rules.
+ */
+
+#ifndef FDM_AUTO_PROVISION_H
+#define FDM_AUTO_PROVISION_H
+
+#include <stdbool.h>
+
+//! \{
+#define AUTO_PROVISION_RULES_FILE       "/etc/lwm2m/auto_provision.cfg"
+#define AUTO_PROVISION_PROCESS_INTERVAL (200)
+//! \}
+
+/**
+ * @brief Load the auto provisioning rules and start applying them to unprovisioned clients, both
+ *        those already registered and those registering from now on. A rules file that doesn't
+ *        exist leaves auto provisioning disabled.
+ *
+ *        The rules file holds a JSON object with optional "parent_id", "timeout" and "window" as
+ *        for provision_constrained_devices, and "rules", an array of rules tried in order. A rule
+ *        gives "fcap", "device_type" and "licensee_id" for the clients it matches, and any of
+ *        "client_id_prefix", "client_id_regex" (POSIX extended), "manufacturer" and "model_number"
+ *        (Device object resources 0 and 1) to match clients on, all of which must match.
+ * @param[in] rulesFile Path of the rules file.
+ * @return true if auto provisioning is started or disabled, false if the rules are invalid.
+ */
+bool AutoProvision_Start(const char *rulesFile);
+
+/**
+ * @brief Handle client registrations received since the last call, queuing clients for
+ *        provisioning. To be called every AUTO_PROVISION_PROCESS_INTERVAL milliseconds from the
+ *        event loop.
+ */
+void AutoProvision_Process(void);
+
+/**
+ * @brief Stop auto provisioning, waiting for a provisioning in progress, and free the rules.
+ */
+void AutoProvision_Stop(void);
+
+#endif  /* FDM_AUTO_PROVISION_H */
@@ -0,0 +1,205 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file fdm_auto_provision_rules.c
+ * @brief Loads and matches the rules of automatic provisioning of constrained devices.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <regex.h>
+#include <json.h>
+#include "fdm_auto_provision_rules.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static char *GetRuleString(json_object *object, const char *key)
+{
+    json_object *value;
+
+    if (!json_object_object_get_ex(object, key, &value) || !json_object_is_type(value, json_type_string))
+    {
+        return NULL;
+    }
+    return strdup(json_object_get_string(value));
+}
+//! \}
+
+/**
+ * @brief Parse one rule of the rules file.
+ * @param[in] object JSON rule.
+ * @param[out] rule Rule to fill.
+ * @return true if the rule is valid, else false.
+ */
+static bool ParseRule(json_object *object, AutoProvisionRule *rule)
+{
+    json_object *value;
+    char *regex;
+    bool result = true;
+
+    rule->clientIDPrefix = GetRuleString(object, "client_id_prefix");
+    rule->manufacturer = GetRuleString(object, "manufacturer");
+    rule->modelNumber = GetRuleString(object, "model_number");
+    rule->fcap = GetRuleString(object, "fcap");
+    rule->deviceType = GetRuleString(object, "device_type");
+
+    if (rule->fcap == NULL || rule->deviceType == NULL ||
+        !json_object_object_get_ex(object, "licensee_id", &value))
+    {
+        LOG(LOG_ERR, "Auto provisioning rule needs fcap, device_type and licensee_id");
+        result = false;
+    }
+    else
+    {
+        rule->licenseeID = json_object_get_int(value);
+    }
+
+    regex = GetRuleString(object, "client_id_regex");
+    if (regex != NULL)
+    {
+        if (regcomp(&rule->clientIDRegex, regex, REG_EXTENDED | REG_NOSUB) == 0)
+        {
+            rule->hasClientIDRegex = true;
+        }
+        else
+        {
+            LOG(LOG_ERR, "Invalid client_id_regex %s", regex);
+            result = false;
+        }
+        free(regex);
+    }
+    return result;
+}
+
+bool AutoProvisionRules_Load(AutoProvisionRules *ruleSet, const char *rulesFile)
+{
+    json_object *config, *rulesArray, *value;
+    unsigned int i;
+    int number;
+    bool result = true;
+
+    config = json_object_from_file(rulesFile);
+    if (config == NULL || !json_object_object_get_ex(config, "rules", &rulesArray) ||
+        !json_object_is_type(rulesArray, json_type_array))
+    {
+        LOG(LOG_ERR, "Couldn't read auto provisioning rules from %s", rulesFile);
+        json_object_put(config);
+        return false;
+    }
+
+    // Without a parent_id the DeviceID of the gateway is used.
+    ruleSet->parentID = GetRuleString(config, "parent_id");
+    if (json_object_object_get_ex(config, "timeout", &value))
+    {
+        if ((number = json_object_get_int(value)) > 0)
+        {
+            ruleSet->timeout = number;
+        }
+        else
+        {
+            LOG(LOG_WARN, "Ignoring auto provisioning timeout %d, keeping %d", number, ruleSet->timeout);
+        }
+    }
+    // A window of 0 would never take a client from the queue.
+    if (json_object_object_get_ex(config, "window", &value))
+    {
+        number = json_object_get_int(value);
+        ruleSet->window = number < 1 ? 1 : number > AUTO_PROVISION_MAX_WINDOW ? AUTO_PROVISION_MAX_WINDOW : number;
+        if (ruleSet->window != (unsigned int)number)
+        {
+            LOG(LOG_WARN, "Auto provisioning window %d clamped to %u", number, ruleSet->window);
+        }
+    }
+
+    ruleSet->rules = calloc(json_object_array_length(rulesArray), sizeof(AutoProvisionRule));
+    if (ruleSet->rules == NULL && json_object_array_length(rulesArray) != 0)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for auto provisioning rules");
+        result = false;
+    }
+    for (i = 0; result && i < (unsigned int)json_object_array_length(rulesArray); i++)
+    {
+        // Counted before parsing, so that a half parsed rule is freed too.
+        ruleSet->numRules++;
+        result = ParseRule(json_object_array_get_idx(rulesArray, i), &ruleSet->rules[i]);
+    }
+
+    json_object_put(config);
+    if (!result)
+    {
+        AutoProvisionRules_Free(ruleSet);
+    }
+    return result;
+}
+
+void AutoProvisionRules_Free(AutoProvisionRules *ruleSet)
+{
+    unsigned int i;
+
+    for (i = 0; i < ruleSet->numRules; i++)
+    {
+        free(ruleSet->rules[i].clientIDPrefix);
+        if (ruleSet->rules[i].hasClientIDRegex)
+        {
+            regfree(&ruleSet->rules[i].clientIDRegex);
+        }
+        free(ruleSet->rules[i].manufacturer);
+        free(ruleSet->rules[i].modelNumber);
+        free(ruleSet->rules[i].fcap);
+        free(ruleSet->rules[i].deviceType);
+    }
+    free(ruleSet->rules);
+    ruleSet->rules = NULL;
+    ruleSet->numRules = 0;
+    free(ruleSet->parentID);
+    ruleSet->parentID = NULL;
+}
+
+bool AutoProvisionRules_IsClientIDMatching(const AutoProvisionRule *rule, const char *clientID)
+{
+    if (rule->clientIDPrefix != NULL && strncmp(clientID, rule->clientIDPrefix, strlen(rule->clientIDPrefix)) != 0)
+    {
+        return false;
+    }
+    return !rule->hasClientIDRegex || regexec(&rule->clientIDRegex, clientID, 0, NULL, 0) == 0;
+}
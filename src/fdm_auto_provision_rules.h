@@ -0,0 +1,103 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file fdm_auto_provision_rules.h
+ * @brief Header file for exposing the rules of automatic provisioning of constrained devices.
+ */
+
+#ifndef FDM_AUTO_PROVISION_RULES_H
+#define FDM_AUTO_PROVISION_RULES_H
+
+#include <stdbool.h>
+#include <regex.h>
+
+//! \{
+#define AUTO_PROVISION_MAX_WINDOW (16)
+//! \}
+
+/**
+ * A rule mapping matching clients to their provisioning details. Unset criteria match any client.
+ */
+typedef struct
+{
+    //! \{
+    char *clientIDPrefix;
+    regex_t clientIDRegex;
+    bool hasClientIDRegex;
+    char *manufacturer;
+    char *modelNumber;
+    char *fcap;
+    char *deviceType;
+    int licenseeID;
+    //! \}
+} AutoProvisionRule;
+
+/**
+ * The rules of a rules file, tried in order, and the provisioning options shared by all of them.
+ */
+typedef struct
+{
+    //! \{
+    AutoProvisionRule *rules;
+    unsigned int numRules;
+    char *parentID;
+    int timeout;
+    unsigned int window;
+    //! \}
+} AutoProvisionRules;
+
+/**
+ * @brief Load a rules file, as described for AutoProvision_Start. A window outside 1 to
+ *        AUTO_PROVISION_MAX_WINDOW is clamped into it, a timeout that isn't positive is ignored.
+ * @param[in,out] ruleSet Rules to fill, with the timeout and window to keep if the file doesn't
+ *                give them.
+ * @param[in] rulesFile Path of the rules file.
+ * @return true if the rules are loaded, false if the file is missing or invalid, leaving no rules.
+ */
+bool AutoProvisionRules_Load(AutoProvisionRules *ruleSet, const char *rulesFile);
+
+/**
+ * @brief Free the rules, keeping the timeout and window.
+ * @param[in,out] ruleSet Rules.
+ */
+void AutoProvisionRules_Free(AutoProvisionRules *ruleSet);
+
+/**
+ * @brief Check a client ID against the criteria of a rule that don't need the device to be read.
+ * @param[in] rule Rule.
+ * @param[in] clientID Client ID.
+ * @return true if the client ID matches, else false.
+ */
+bool AutoProvisionRules_IsClientIDMatching(const AutoProvisionRule *rule, const char *clientID);
+
+#endif  /* FDM_AUTO_PROVISION_RULES_H */
@@ -0,0 +1,132 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_base64.c
+ * @brief Provides table-driven base64 decoding.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include "fdm_base64.h"
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+// Character value plus one, so that every other character maps to 0.
+static const uint8_t base64Values[256] =
+{
+    ['A'] = 1, ['B'] = 2, ['C'] = 3, ['D'] = 4, ['E'] = 5, ['F'] = 6, ['G'] = 7, ['H'] = 8,
+    ['I'] = 9, ['J'] = 10, ['K'] = 11, ['L'] = 12, ['M'] = 13, ['N'] = 14, ['O'] = 15, ['P'] = 16,
+    ['Q'] = 17, ['R'] = 18, ['S'] = 19, ['T'] = 20, ['U'] = 21, ['V'] = 22, ['W'] = 23, ['X'] = 24,
+    ['Y'] = 25, ['Z'] = 26, ['a'] = 27, ['b'] = 28, ['c'] = 29, ['d'] = 30, ['e'] = 31, ['f'] = 32,
+    ['g'] = 33, ['h'] = 34, ['i'] = 35, ['j'] = 36, ['k'] = 37, ['l'] = 38, ['m'] = 39, ['n'] = 40,
+    ['o'] = 41, ['p'] = 42, ['q'] = 43, ['r'] = 44, ['s'] = 45, ['t'] = 46, ['u'] = 47, ['v'] = 48,
+    ['w'] = 49, ['x'] = 50, ['y'] = 51, ['z'] = 52, ['0'] = 53, ['1'] = 54, ['2'] = 55, ['3'] = 56,
+    ['4'] = 57, ['5'] = 58, ['6'] = 59, ['7'] = 60, ['8'] = 61, ['9'] = 62, ['+'] = 63, ['/'] = 64
+};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+int Base64_Decode(uint8_t *data, size_t maxLength, const char *text, size_t length)
+{
+    const unsigned char *in = (const unsigned char *)text;
+    size_t decodedLength, i, out = 0;
+    uint32_t a, b, c, d;
+
+    if (data == NULL || text == NULL)
+    {
+        return -1;
+    }
+
+    // Padding only ever completes the last quantum.
+    if (length % 4 == 0 && length > 0 && in[length - 1] == '=')
+    {
+        length -= in[length - 2] == '=' ? 2 : 1;
+    }
+    if (length % 4 == 1)
+    {
+        return -1;
+    }
+
+    decodedLength = length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+    if (decodedLength > maxLength)
+    {
+        return -1;
+    }
+
+    // Whole quanta, four characters to three bytes.
+    for (i = 0; i + 4 <= length; i += 4)
+    {
+        a = base64Values[in[i]];
+        b = base64Values[in[i + 1]];
+        c = base64Values[in[i + 2]];
+        d = base64Values[in[i + 3]];
+        if (!a || !b || !c || !d)
+        {
+            return -1;
+        }
+        a = ((a - 1) << 18) | ((b - 1) << 12) | ((c - 1) << 6) | (d - 1);
+        data[out++] = a >> 16;
+        data[out++] = a >> 8;
+        data[out++] = a;
+    }
+
+    // The last two or three characters, whose unused bits must be zero.
+    if (i < length)
+    {
+        a = base64Values[in[i]];
+        b = base64Values[in[i + 1]];
+        c = length - i == 3 ? base64Values[in[i + 2]] : 1;
+        if (!a || !b || !c)
+        {
+            return -1;
+        }
+        a = ((a - 1) << 18) | ((b - 1) << 12) | ((c - 1) << 6);
+        if (a & (length - i == 3 ? 0xff : 0xffff))
+        {
+            return -1;
+        }
+        data[out++] = a >> 16;
+        if (length - i == 3)
+        {
+            data[out++] = a >> 8;
+        }
+    }
+    return (int)out;
+}
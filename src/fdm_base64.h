@@ -0,0 +1,66 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_base64.h
+ * @brief Header file for exposing the base64 decoder used for licensee secrets.
+ */
+
+#ifndef FDM_BASE64_H
+#define FDM_BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest number of bytes Base64_Decode can produce from length characters. */
+#define BASE64_DECODED_LENGTH(length) (((length) + 3) / 4 * 3)
+
+/**
+ * @brief Decode standard (RFC 4648) base64. The text is validated strictly: only the base64
+ *        alphabet is accepted, padding may only end the text and unused bits of the last
+ *        character must be zero. Padding may be left out.
+ * @param[out] data Buffer for the decoded bytes.
+ * @param[in] maxLength Size of data.
+ * @param[in] text Text to decode.
+ * @param[in] length Number of characters in text.
+ * @return Number of bytes decoded, or -1 if the text is not valid base64 or does not fit.
+ */
+int Base64_Decode(uint8_t *data, size_t maxLength, const char *text, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* FDM_BASE64_H */
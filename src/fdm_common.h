@@ -44,6 +44,8 @@
 #define IPC_TIMEOUT         (1000)
 #define SLEEP_COUNT         (2)
 #define OBJECT_INSTANCE_ID  (0)
+#define MAX_FLOW_INSTANCES  (8)
+#define MAX_REGISTERED_OBJECTS (32)
 #define DEVICE_ID_SIZE      (16)
 #define ARRAY_SIZE(arr)     (sizeof(arr)/sizeof(arr[0]))
 
@@ -51,18 +53,17 @@
 #define SERVER_PORT                 54321
 
 
-#define MAKE_RESOURCE_PATH(path, objectId, resourceId) \
-    AwaAPI_MakeResourcePath(path, URL_PATH_SIZE, objectId, OBJECT_INSTANCE_ID, resourceId)
+#define MAKE_RESOURCE_PATH(path, objectId, instanceId, resourceId) \
+    AwaAPI_MakeResourcePath(path, URL_PATH_SIZE, objectId, instanceId, resourceId)
 
-#define MAKE_FLOW_OBJECT_RESOURCE_PATH(path, resourceId) \
-    MAKE_RESOURCE_PATH(path, Lwm2mObjectId_FlowObject, resourceId)
+#define MAKE_FLOW_OBJECT_RESOURCE_PATH(path, instanceId, resourceId) \
+    MAKE_RESOURCE_PATH(path, Lwm2mObjectId_FlowObject, instanceId, resourceId)
 
-#define MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(path, resourceId) \
-    MAKE_RESOURCE_PATH(path, Lwm2mObjectId_FlowAccess, resourceId)
+#define MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(path, instanceId, resourceId) \
+    MAKE_RESOURCE_PATH(path, Lwm2mObjectId_FlowAccess, instanceId, resourceId)
 
-#define MAKE_FLOW_OBJECT_INSTANCE_PATH(path) \
-    AwaAPI_MakeObjectInstancePath(path, URL_PATH_SIZE, Lwm2mObjectId_FlowObject, \
-        OBJECT_INSTANCE_ID)
+#define MAKE_FLOW_OBJECT_INSTANCE_PATH(path, instanceId) \
+    AwaAPI_MakeObjectInstancePath(path, URL_PATH_SIZE, Lwm2mObjectId_FlowObject, instanceId)
 
 #define MAKE_FLOW_ACCESS_OBJECT_PATH(path) \
     AwaAPI_MakeObjectPath(path, URL_PATH_SIZE, Lwm2mObjectId_FlowAccess)
@@ -149,6 +150,7 @@ typedef struct
     //! \{
     AwaClientChangeSubscription *flowObjectChange;
     AwaClientChangeSubscription *flowAccessObjectChange;
+    AwaObjectInstanceID instanceId;
     //! \}
 } FlowSubscriptions;
 
@@ -158,13 +160,16 @@ typedef struct
 typedef struct
 {
     //! \{
+    AwaObjectInstanceID instanceId;
     AwaOpaque challenge;
     AwaInteger iterations;
     AwaOpaque licenseeHash;
+    struct LicenseeHashJob *hashJob;
     bool hasChallenge;
     bool hasIterations;
     bool waitForServerResponse;
     bool verifyLicensee;
+    bool isVerificationRequested;
     bool isProvisionSuccess;
     //! \}
 } Verification;
@@ -182,4 +187,25 @@ typedef struct {
     //! \}
 } DeviceStatus;
 
+/**
+ * An object registered by a client and its instances, bit n of instances is set if instance n is
+ * registered. Only instances 0 to 63 are tracked.
+ */
+typedef struct {
+    //! \{
+    AwaObjectID objectID;
+    uint64_t instances;
+    //! \}
+} RegisteredObject;
+
+/**
+ * Objects registered by a client, gathered in one pass over its registered paths.
+ */
+typedef struct {
+    //! \{
+    RegisteredObject objects[MAX_REGISTERED_OBJECTS];
+    unsigned int numObjects;
+    //! \}
+} RegisteredObjects;
+
 #endif  /* FDM_COMMON_H */
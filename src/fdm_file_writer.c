@@ -0,0 +1,393 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_file_writer.c
+ * @brief Saves files atomically (temporary file, fsync and rename) on a background thread.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "fdm_file_writer.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define TEMP_FILE_SUFFIX    ".tmp"
+#define COMPARE_CHUNK_SIZE  (256)
+#define FILE_MODE           (0666)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A queued file save.
+ */
+typedef struct SaveJob
+{
+    //! \{
+    struct SaveJob *next;
+    char *path;
+    char *content;
+    size_t length;
+    //! \}
+} SaveJob;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueChanged = PTHREAD_COND_INITIALIZER;
+static SaveJob *queueHead = NULL;
+static SaveJob *queueTail = NULL;
+static bool isWriterStarted = false;
+static bool isWriterBusy = false;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+/**
+ * @brief Check whether a file already holds exactly the given content.
+ * @param[in] path Path of the file.
+ * @param[in] content Content to compare with.
+ * @param[in] length Length of content.
+ * @return true if the file content is identical, else false.
+ */
+static bool HasSameContent(const char *path, const char *content, size_t length)
+{
+    struct stat fileStat;
+    char chunk[COMPARE_CHUNK_SIZE];
+    size_t offset = 0;
+    ssize_t readLength;
+    bool result = true;
+    int fd;
+
+    if (stat(path, &fileStat) != 0 || (size_t)fileStat.st_size != length)
+    {
+        return false;
+    }
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        return false;
+    }
+
+    while (result && offset < length)
+    {
+        readLength = read(fd, chunk, sizeof(chunk));
+        if (readLength < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (readLength <= 0 || (size_t)readLength > length - offset ||
+            memcmp(chunk, content + offset, readLength) != 0)
+        {
+            result = false;
+            break;
+        }
+        offset += readLength;
+    }
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Write a whole buffer to a file descriptor, normally with a single write call.
+ * @param[in] fd File descriptor.
+ * @param[in] content Content to write.
+ * @param[in] length Length of content.
+ * @return true if everything was written, else false.
+ */
+static bool WriteAll(int fd, const char *content, size_t length)
+{
+    ssize_t written;
+
+    while (length > 0)
+    {
+        written = write(fd, content, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        content += written;
+        length -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Sync the directory holding a file so that a rename within it is durable.
+ * @param[in] path Path of a file in the directory.
+ */
+static void SyncParentDirectory(const char *path)
+{
+    char *pathCopy = strdup(path);
+    int fd;
+
+    if (pathCopy == NULL)
+    {
+        return;
+    }
+
+    if ((fd = open(dirname(pathCopy), O_RDONLY)) >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    free(pathCopy);
+}
+
+/**
+ * @brief Replace a file with new content through a synced temporary file and a rename, so readers
+ *        and a power cut only ever see the old or the new file.
+ * @param[in] job Save to perform.
+ * @return true for success otherwise false.
+ */
+static bool ReplaceFile(const SaveJob *job)
+{
+    char *tempPath;
+    bool result = false;
+    int fd;
+
+    if (HasSameContent(job->path, job->content, job->length))
+    {
+        LOG(LOG_DBG, "%s is up to date, skipping write", job->path);
+        return true;
+    }
+
+    tempPath = malloc(strlen(job->path) + sizeof(TEMP_FILE_SUFFIX));
+    if (tempPath == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for temporary path of %s", job->path);
+        return false;
+    }
+    sprintf(tempPath, "%s" TEMP_FILE_SUFFIX, job->path);
+
+    if ((fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE)) < 0)
+    {
+        LOG(LOG_ERR, "Failed to create or open %s\nerror: %s", tempPath, strerror(errno));
+        free(tempPath);
+        return false;
+    }
+
+    if (!WriteAll(fd, job->content, job->length))
+    {
+        LOG(LOG_ERR, "Failed to write %s\nerror: %s", tempPath, strerror(errno));
+    }
+    else if (fsync(fd) != 0)
+    {
+        LOG(LOG_ERR, "Failed to sync %s\nerror: %s", tempPath, strerror(errno));
+    }
+    else
+    {
+        result = true;
+    }
+
+    if (close(fd) != 0)
+    {
+        LOG(LOG_ERR, "Failed to close %s", tempPath);
+        result = false;
+    }
+
+    if (result)
+    {
+        if (rename(tempPath, job->path) == 0)
+        {
+            SyncParentDirectory(job->path);
+            LOG(LOG_DBG, "Saved %s", job->path);
+        }
+        else
+        {
+            LOG(LOG_ERR, "Failed to rename %s to %s\nerror: %s", tempPath, job->path, strerror(errno));
+            result = false;
+        }
+    }
+
+    if (!result)
+    {
+        unlink(tempPath);
+    }
+    free(tempPath);
+    return result;
+}
+
+/**
+ * @brief Release a save job and everything it owns.
+ * @param[in] job Save job.
+ */
+static void FreeJob(SaveJob *job)
+{
+    free(job->path);
+    free(job->content);
+    free(job);
+}
+
+/**
+ * @brief Background thread draining the save queue.
+ * @param[in] arg Unused.
+ * @return Never returns.
+ */
+static void *WriterThread(void *arg)
+{
+    SaveJob *job;
+
+    (void)arg;
+    pthread_mutex_lock(&queueLock);
+    while (true)
+    {
+        while (queueHead == NULL)
+        {
+            pthread_cond_wait(&queueChanged, &queueLock);
+        }
+
+        job = queueHead;
+        queueHead = job->next;
+        if (queueHead == NULL)
+        {
+            queueTail = NULL;
+        }
+        isWriterBusy = true;
+        pthread_mutex_unlock(&queueLock);
+
+        ReplaceFile(job);
+        FreeJob(job);
+
+        pthread_mutex_lock(&queueLock);
+        isWriterBusy = false;
+        pthread_cond_broadcast(&queueChanged);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the background writer thread if it is not running yet. Must be called with the
+ *        queue lock held.
+ * @return true if the writer is running, else false.
+ */
+static bool StartWriter(void)
+{
+    pthread_t thread;
+
+    if (isWriterStarted)
+    {
+        return true;
+    }
+
+    if (pthread_create(&thread, NULL, WriterThread, NULL) != 0)
+    {
+        LOG(LOG_ERR, "Failed to start file writer thread");
+        return false;
+    }
+    pthread_detach(thread);
+    isWriterStarted = true;
+    return true;
+}
+
+bool FileWriter_SaveAsync(const char *path, char *content, size_t length)
+{
+    SaveJob *job;
+
+    if (path == NULL || content == NULL)
+    {
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        free(content);
+        return false;
+    }
+
+    job = malloc(sizeof(SaveJob));
+    if (job == NULL || (job->path = strdup(path)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for saving %s", path);
+        free(job);
+        free(content);
+        return false;
+    }
+    job->next = NULL;
+    job->content = content;
+    job->length = length;
+
+    pthread_mutex_lock(&queueLock);
+    if (!StartWriter())
+    {
+        // No background thread, so fall back to saving on the caller's thread.
+        pthread_mutex_unlock(&queueLock);
+        bool result = ReplaceFile(job);
+        FreeJob(job);
+        return result;
+    }
+
+    if (queueTail != NULL)
+    {
+        queueTail->next = job;
+    }
+    else
+    {
+        queueHead = job;
+    }
+    queueTail = job;
+    pthread_cond_broadcast(&queueChanged);
+    pthread_mutex_unlock(&queueLock);
+    return true;
+}
+
+void FileWriter_Flush(void)
+{
+    pthread_mutex_lock(&queueLock);
+    while (queueHead != NULL || isWriterBusy)
+    {
+        pthread_cond_wait(&queueChanged, &queueLock);
+    }
+    pthread_mutex_unlock(&queueLock);
+}
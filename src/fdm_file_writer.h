@@ -0,0 +1,59 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_file_writer.h
+ * @brief Header file for exposing atomic, asynchronous file save operations.
+ */
+
+#ifndef FDM_FILE_WRITER_H
+#define FDM_FILE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Queue a file to be replaced atomically with the given content. The content is written to
+ *        a temporary file with a single write, synced and renamed over the target by a background
+ *        thread, so the caller does not wait on flash. Nothing is written if the target already
+ *        holds identical content.
+ * @param[in] path Path of the file to replace.
+ * @param[in] content Heap allocated file content, ownership is passed to the writer.
+ * @param[in] length Length of content in bytes.
+ * @return true if the save was queued otherwise false, in which case content is freed.
+ */
+bool FileWriter_SaveAsync(const char *path, char *content, size_t length);
+
+/**
+ * @brief Block until every queued save has been written out.
+ */
+void FileWriter_Flush(void);
+
+#endif  /* FDM_FILE_WRITER_H */
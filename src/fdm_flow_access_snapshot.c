@@ -0,0 +1,354 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_flow_access_snapshot.c
+ * @brief Builds and reads the binary snapshot of saved flow access details.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fdm_flow_access_snapshot.h"
+#include "fdm_common.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define SNAPSHOT_ALIGNMENT      (8)
+#define SNAPSHOT_HEADER_SIZE    (sizeof(FlowAccessSnapshotHeader) + \
+                                 FlowAccessField_Max * sizeof(FlowAccessSnapshotEntry))
+#define SNAPSHOT_INITIAL_SIZE   (512)
+#define ALIGN_UP(value)         (((value) + SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(SNAPSHOT_ALIGNMENT - 1))
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * Maps an lwm2m resource to its snapshot field.
+ */
+typedef struct
+{
+    //! \{
+    unsigned int objectId;
+    unsigned int resourceId;
+    FlowAccessField field;
+    //! \}
+} SnapshotFieldMapping;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static const SnapshotFieldMapping fieldMappings[] =
+{
+    { Lwm2mObjectId_FlowObject, FlowObjectResourceId_DeviceId, FlowAccessField_DeviceId },
+    { Lwm2mObjectId_FlowObject, FlowObjectResourceId_DeviceType, FlowAccessField_DeviceType },
+    { Lwm2mObjectId_FlowObject, FlowObjectResourceId_Fcap, FlowAccessField_Fcap },
+    { Lwm2mObjectId_FlowObject, FlowObjectResourceId_LicenseeId, FlowAccessField_LicenseeId },
+    { Lwm2mObjectId_FlowAccess, FlowAccessResourceId_Url, FlowAccessField_Url },
+    { Lwm2mObjectId_FlowAccess, FlowAccessResourceId_CustomerKey, FlowAccessField_CustomerKey },
+    { Lwm2mObjectId_FlowAccess, FlowAccessResourceId_CustomerSecret, FlowAccessField_CustomerSecret },
+    { Lwm2mObjectId_FlowAccess, FlowAccessResourceId_RememberMeToken, FlowAccessField_RememberMeToken },
+    { Lwm2mObjectId_FlowAccess, FlowAccessResourceId_RememberMeTokenExpiry, FlowAccessField_RememberMeTokenExpiry },
+    { Lwm2mObjectId_DeviceObject, DeviceObjectResourceId_SerialNumber, FlowAccessField_SerialNumber },
+    { Lwm2mObjectId_DeviceObject, DeviceObjectResourceId_SoftwareVersion, FlowAccessField_SoftwareVersion }
+};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+bool FlowAccessSnapshot_Open(FlowAccessSnapshot *snapshot, const char *path)
+{
+    const FlowAccessSnapshotHeader *header;
+    const FlowAccessSnapshotEntry *entry;
+    struct stat fileStat;
+    void *mapping;
+    unsigned int i;
+    int fd;
+
+    if (snapshot == NULL || path == NULL)
+    {
+        return false;
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+    {
+        return false;
+    }
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(FlowAccessSnapshotHeader))
+    {
+        close(fd);
+        return false;
+    }
+    mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // Validate once here, so that the getters can index the mapping directly. The mapping is page
+    // aligned and the writer aligns integers, so they can be loaded in place.
+    header = mapping;
+    if (header->magic != FLOW_ACCESS_SNAPSHOT_MAGIC || header->version != FLOW_ACCESS_SNAPSHOT_VERSION ||
+        header->size != (size_t)fileStat.st_size ||
+        sizeof(*header) + header->numFields * sizeof(FlowAccessSnapshotEntry) > header->size)
+    {
+        munmap(mapping, fileStat.st_size);
+        return false;
+    }
+    for (i = 0; i < header->numFields; i++)
+    {
+        entry = &header->fields[i];
+        if (entry->type != FlowAccessFieldType_None &&
+            (entry->offset > header->size || entry->length > header->size - entry->offset ||
+            (entry->type == FlowAccessFieldType_String && (entry->length == header->size - entry->offset ||
+            ((const char *)header)[entry->offset + entry->length] != '\0')) ||
+            (entry->type == FlowAccessFieldType_Integer && entry->offset % SNAPSHOT_ALIGNMENT != 0)))
+        {
+            munmap(mapping, fileStat.st_size);
+            return false;
+        }
+    }
+
+    snapshot->header = header;
+    snapshot->size = fileStat.st_size;
+    snapshot->path = path;
+    snapshot->device = fileStat.st_dev;
+    snapshot->inode = fileStat.st_ino;
+    return true;
+}
+
+void FlowAccessSnapshot_Close(FlowAccessSnapshot *snapshot)
+{
+    if (snapshot == NULL || snapshot->header == NULL)
+    {
+        return;
+    }
+    munmap((void *)snapshot->header, snapshot->size);
+    snapshot->header = NULL;
+}
+
+bool FlowAccessSnapshot_HasChanged(const FlowAccessSnapshot *snapshot)
+{
+    struct stat fileStat;
+
+    if (snapshot == NULL || snapshot->header == NULL || stat(snapshot->path, &fileStat) != 0)
+    {
+        return true;
+    }
+    // The file is always replaced by a rename, so a new inode means new content.
+    return fileStat.st_ino != snapshot->inode || fileStat.st_dev != snapshot->device;
+}
+
+/**
+ * @brief Look up a field entry of the expected type.
+ * @param[in] snapshot Open snapshot.
+ * @param[in] field Field to look up.
+ * @param[in] type Expected type.
+ * @return Field entry or NULL if the field is absent or of another type.
+ */
+static const FlowAccessSnapshotEntry *GetEntry(const FlowAccessSnapshot *snapshot, FlowAccessField field,
+    FlowAccessFieldType type)
+{
+    const FlowAccessSnapshotEntry *entry;
+
+    if (snapshot == NULL || snapshot->header == NULL || (unsigned int)field >= snapshot->header->numFields)
+    {
+        return NULL;
+    }
+    entry = &snapshot->header->fields[field];
+    return (entry->type == type) ? entry : NULL;
+}
+
+const char *FlowAccessSnapshot_GetString(const FlowAccessSnapshot *snapshot, FlowAccessField field)
+{
+    const FlowAccessSnapshotEntry *entry = GetEntry(snapshot, field, FlowAccessFieldType_String);
+    return entry ? (const char *)snapshot->header + entry->offset : NULL;
+}
+
+bool FlowAccessSnapshot_GetInteger(const FlowAccessSnapshot *snapshot, FlowAccessField field, int64_t *value)
+{
+    const FlowAccessSnapshotEntry *entry = GetEntry(snapshot, field, FlowAccessFieldType_Integer);
+
+    if (entry == NULL || value == NULL || entry->length != sizeof(int64_t))
+    {
+        return false;
+    }
+    *value = *(const int64_t *)((const char *)snapshot->header + entry->offset);
+    return true;
+}
+
+const uint8_t *FlowAccessSnapshot_GetOpaque(const FlowAccessSnapshot *snapshot, FlowAccessField field, size_t *length)
+{
+    const FlowAccessSnapshotEntry *entry = GetEntry(snapshot, field, FlowAccessFieldType_Opaque);
+
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+    if (length != NULL)
+    {
+        *length = entry->length;
+    }
+    return (const uint8_t *)snapshot->header + entry->offset;
+}
+
+void FlowAccessSnapshotBuilder_InitMeasure(FlowAccessSnapshotBuilder *builder)
+{
+    builder->buffer = NULL;
+    builder->capacity = 0;
+    builder->length = ALIGN_UP(SNAPSHOT_HEADER_SIZE);
+    builder->isMeasuring = true;
+}
+
+bool FlowAccessSnapshotBuilder_Init(FlowAccessSnapshotBuilder *builder, size_t capacity)
+{
+    if (builder == NULL)
+    {
+        return false;
+    }
+
+    builder->length = ALIGN_UP(SNAPSHOT_HEADER_SIZE);
+    builder->capacity = (capacity > builder->length) ? capacity : SNAPSHOT_INITIAL_SIZE;
+    builder->isMeasuring = false;
+    builder->buffer = calloc(1, builder->capacity);
+    if (builder->buffer == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for flow access snapshot");
+        return false;
+    }
+    return true;
+}
+
+bool FlowAccessSnapshotBuilder_AddResource(FlowAccessSnapshotBuilder *builder, unsigned int objectId,
+    unsigned int resourceId, FlowAccessFieldType type, const void *data, size_t length)
+{
+    FlowAccessSnapshotHeader *header;
+    size_t required, capacity;
+    unsigned int i;
+    char *buffer;
+
+    if (builder == NULL || (builder->buffer == NULL && !builder->isMeasuring) || data == NULL)
+    {
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        return false;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fieldMappings); i++)
+    {
+        if (fieldMappings[i].objectId == objectId && fieldMappings[i].resourceId == resourceId)
+        {
+            break;
+        }
+    }
+    if (i == ARRAY_SIZE(fieldMappings))
+    {
+        return true;
+    }
+
+    // Strings keep their terminator, so readers can use them in place.
+    required = ALIGN_UP(builder->length + length + (type == FlowAccessFieldType_String ? 1 : 0));
+    if (builder->isMeasuring)
+    {
+        builder->length = required;
+        return true;
+    }
+    if (required > builder->capacity)
+    {
+        for (capacity = builder->capacity; capacity < required; capacity *= 2);
+        if ((buffer = realloc(builder->buffer, capacity)) == NULL)
+        {
+            LOG(LOG_ERR, "Failed to grow flow access snapshot");
+            return false;
+        }
+        memset(buffer + builder->capacity, 0, capacity - builder->capacity);
+        builder->buffer = buffer;
+        builder->capacity = capacity;
+    }
+
+    header = (FlowAccessSnapshotHeader *)builder->buffer;
+    header->fields[fieldMappings[i].field].offset = builder->length;
+    header->fields[fieldMappings[i].field].length = length;
+    header->fields[fieldMappings[i].field].type = type;
+    memcpy(builder->buffer + builder->length, data, length);
+    builder->length = required;
+    return true;
+}
+
+char *FlowAccessSnapshotBuilder_Finish(FlowAccessSnapshotBuilder *builder, size_t *length)
+{
+    FlowAccessSnapshotHeader *header;
+    char *buffer;
+
+    if (builder == NULL || builder->buffer == NULL || length == NULL)
+    {
+        return NULL;
+    }
+
+    header = (FlowAccessSnapshotHeader *)builder->buffer;
+    header->magic = FLOW_ACCESS_SNAPSHOT_MAGIC;
+    header->version = FLOW_ACCESS_SNAPSHOT_VERSION;
+    header->numFields = FlowAccessField_Max;
+    header->size = builder->length;
+
+    buffer = builder->buffer;
+    *length = builder->length;
+    builder->buffer = NULL;
+    return buffer;
+}
+
+void FlowAccessSnapshotBuilder_Free(FlowAccessSnapshotBuilder *builder)
+{
+    if (builder != NULL)
+    {
+        free(builder->buffer);
+        builder->buffer = NULL;
+    }
+}
@@ -0,0 +1,237 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_flow_access_snapshot.h
+ * @brief Header file for exposing the binary snapshot of saved flow access details. The snapshot
+ *        is written next to flow_access.cfg and can be mapped read-only by other applications on
+ *        the gateway, which then read fields in place without parsing the text file.
+ */
+
+#ifndef FDM_FLOW_ACCESS_SNAPSHOT_H
+#define FDM_FLOW_ACCESS_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! \{
+#define FLOW_ACCESS_SNAPSHOT_PATH     "/etc/lwm2m/flow_access.snapshot"
+#define FLOW_ACCESS_SNAPSHOT_MAGIC    (0x53414446)
+#define FLOW_ACCESS_SNAPSHOT_VERSION  (1)
+//! \}
+
+/**
+ * Fields stored in the snapshot. New fields are only ever appended.
+ */
+typedef enum
+{
+    FlowAccessField_DeviceId,
+    FlowAccessField_DeviceType,
+    FlowAccessField_Fcap,
+    FlowAccessField_LicenseeId,
+    FlowAccessField_Url,
+    FlowAccessField_CustomerKey,
+    FlowAccessField_CustomerSecret,
+    FlowAccessField_RememberMeToken,
+    FlowAccessField_RememberMeTokenExpiry,
+    FlowAccessField_SerialNumber,
+    FlowAccessField_SoftwareVersion,
+    FlowAccessField_Max
+} FlowAccessField;
+
+/**
+ * Type of a snapshot field value.
+ */
+typedef enum
+{
+    FlowAccessFieldType_None,
+    FlowAccessFieldType_String,
+    FlowAccessFieldType_Integer,
+    FlowAccessFieldType_Opaque
+} FlowAccessFieldType;
+
+/**
+ * Location of a field value within the snapshot. Strings are stored NUL terminated (the length
+ * excludes the terminator) and integers as 8-byte aligned native int64_t.
+ */
+typedef struct
+{
+    //! \{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t type;
+    //! \}
+} FlowAccessSnapshotEntry;
+
+/**
+ * Snapshot file header, followed by numFields entries and the field values. All values are in
+ * native byte order.
+ */
+typedef struct
+{
+    //! \{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t numFields;
+    uint32_t size;
+    uint32_t reserved;
+    FlowAccessSnapshotEntry fields[];
+    //! \}
+} FlowAccessSnapshotHeader;
+
+/**
+ * A read-only mapping of a snapshot file.
+ */
+typedef struct
+{
+    //! \{
+    const FlowAccessSnapshotHeader *header;
+    size_t size;
+    const char *path;
+    dev_t device;
+    ino_t inode;
+    //! \}
+} FlowAccessSnapshot;
+
+/**
+ * Snapshot under construction.
+ */
+typedef struct
+{
+    //! \{
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    bool isMeasuring;
+    //! \}
+} FlowAccessSnapshotBuilder;
+
+/**
+ * @brief Map a snapshot file read-only and validate its header.
+ * @param[out] snapshot Snapshot to fill.
+ * @param[in] path Path of the snapshot, normally FLOW_ACCESS_SNAPSHOT_PATH. It must stay valid
+ *            while the snapshot is open.
+ * @return true for success otherwise false.
+ */
+bool FlowAccessSnapshot_Open(FlowAccessSnapshot *snapshot, const char *path);
+
+/**
+ * @brief Unmap a snapshot opened with FlowAccessSnapshot_Open.
+ * @param[in] snapshot Snapshot to close.
+ */
+void FlowAccessSnapshot_Close(FlowAccessSnapshot *snapshot);
+
+/**
+ * @brief Check whether the snapshot file has been replaced since it was opened. This is a single
+ *        stat call, so it is cheap enough to poll.
+ * @param[in] snapshot Open snapshot.
+ * @return true if the file was replaced or removed, else false.
+ */
+bool FlowAccessSnapshot_HasChanged(const FlowAccessSnapshot *snapshot);
+
+/**
+ * @brief Get a string field.
+ * @param[in] snapshot Open snapshot.
+ * @param[in] field Field to get.
+ * @return NUL terminated value pointing into the mapping, or NULL if the field is not a saved string.
+ */
+const char *FlowAccessSnapshot_GetString(const FlowAccessSnapshot *snapshot, FlowAccessField field);
+
+/**
+ * @brief Get an integer or time field.
+ * @param[in] snapshot Open snapshot.
+ * @param[in] field Field to get.
+ * @param[out] value Field value.
+ * @return true if the field is a saved integer, else false.
+ */
+bool FlowAccessSnapshot_GetInteger(const FlowAccessSnapshot *snapshot, FlowAccessField field, int64_t *value);
+
+/**
+ * @brief Get an opaque field.
+ * @param[in] snapshot Open snapshot.
+ * @param[in] field Field to get.
+ * @param[out] length Length of the value in bytes.
+ * @return Value pointing into the mapping, or NULL if the field is not a saved opaque.
+ */
+const uint8_t *FlowAccessSnapshot_GetOpaque(const FlowAccessSnapshot *snapshot, FlowAccessField field, size_t *length);
+
+/**
+ * @brief Start a builder that only measures the size of the snapshot.
+ * @param[out] builder Builder to initialise.
+ */
+void FlowAccessSnapshotBuilder_InitMeasure(FlowAccessSnapshotBuilder *builder);
+
+/**
+ * @brief Start building a snapshot.
+ * @param[out] builder Builder to initialise.
+ * @param[in] capacity Expected snapshot size, as measured by a measuring builder, or 0 if unknown.
+ * @return true for success otherwise false.
+ */
+bool FlowAccessSnapshotBuilder_Init(FlowAccessSnapshotBuilder *builder, size_t capacity);
+
+/**
+ * @brief Add the value of an lwm2m resource to the snapshot. Resources without a snapshot field
+ *        are ignored.
+ * @param[in] builder Builder.
+ * @param[in] objectId Object the resource belongs to.
+ * @param[in] resourceId Resource id.
+ * @param[in] type Type of the value.
+ * @param[in] data Value, an int64_t for integers.
+ * @param[in] length Length of the value in bytes, excluding any string terminator.
+ * @return true for success otherwise false.
+ */
+bool FlowAccessSnapshotBuilder_AddResource(FlowAccessSnapshotBuilder *builder, unsigned int objectId,
+    unsigned int resourceId, FlowAccessFieldType type, const void *data, size_t length);
+
+/**
+ * @brief Finish the snapshot and hand over its buffer.
+ * @param[in] builder Builder.
+ * @param[out] length Length of the snapshot.
+ * @return Heap allocated snapshot owned by the caller.
+ */
+char *FlowAccessSnapshotBuilder_Finish(FlowAccessSnapshotBuilder *builder, size_t *length);
+
+/**
+ * @brief Release a builder that was not finished.
+ * @param[in] builder Builder.
+ */
+void FlowAccessSnapshotBuilder_Free(FlowAccessSnapshotBuilder *builder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* FDM_FLOW_ACCESS_SNAPSHOT_H */
@@ -43,6 +43,7 @@
 #include "fdm_log.h"
 #include "fdm_common.h"
 #include "fdm_provision_constrained.h"
+#include "fdm_rate_limit.h"
 
 /***************************************************************************************************
  * Macros
@@ -57,7 +58,83 @@
  **************************************************************************************************/
 
 //! \{
-static void ListClients(const AwaServerSession *session, json_object *respObj)
+static json_object *FindObjectJson(json_object *objectsObj, AwaObjectID objectID)
+{
+    json_object *objectObj, *objectIdObj;
+    int i;
+
+    for (i = json_object_array_length(objectsObj) - 1; i >= 0; i--)
+    {
+        objectObj = json_object_array_get_idx(objectsObj, i);
+        if (json_object_object_get_ex(objectObj, "object_id", &objectIdObj) &&
+            json_object_get_int(objectIdObj) == objectID)
+        {
+            return objectObj;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Add the objects and instances registered by a client to its JSON, in one pass over its
+ *        registered paths. Unlike RegisteredObjects there is no limit on objects or instances.
+ * @param[in] response Response of the client from a list clients operation.
+ * @param[in,out] clientObj JSON of the client.
+ * @return true if the client has registered the FlowAccess object instance, else false.
+ */
+static bool AddRegisteredObjects(const AwaServerListClientsResponse *response, json_object *clientObj)
+{
+    AwaRegisteredEntityIterator *objectIterator;
+    AwaObjectID objectID, lastObjectID = AWA_INVALID_ID;
+    AwaObjectInstanceID objectInstanceID;
+    json_object *objectsObj, *objectObj = NULL, *instancesObj = NULL;
+    bool isProvisioned = false;
+
+    objectIterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(response);
+    if (objectIterator == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create registered entity iterator");
+        return false;
+    }
+
+    objectsObj = json_object_new_array();
+    while (AwaRegisteredEntityIterator_Next(objectIterator))
+    {
+        if (!ParseRegisteredPath(AwaRegisteredEntityIterator_GetPath(objectIterator), &objectID, &objectInstanceID))
+        {
+            continue;
+        }
+
+        // Instances of an object are registered next to each other, so only look it up on a change.
+        if (objectObj == NULL || objectID != lastObjectID)
+        {
+            if ((objectObj = FindObjectJson(objectsObj, objectID)) == NULL)
+            {
+                objectObj = json_object_new_object();
+                json_object_object_add(objectObj, "object_id", json_object_new_int(objectID));
+                json_object_object_add(objectObj, "instances", json_object_new_array());
+                json_object_array_add(objectsObj, objectObj);
+            }
+            json_object_object_get_ex(objectObj, "instances", &instancesObj);
+            lastObjectID = objectID;
+        }
+
+        if (objectInstanceID != AWA_INVALID_ID)
+        {
+            json_object_array_add(instancesObj, json_object_new_int(objectInstanceID));
+            if (objectID == Lwm2mObjectId_FlowAccess && objectInstanceID == OBJECT_INSTANCE_ID)
+            {
+                isProvisioned = true;
+            }
+        }
+    }
+    AwaRegisteredEntityIterator_Free(&objectIterator);
+
+    json_object_object_add(clientObj, "objects", objectsObj);
+    return isProvisioned;
+}
+
+static bool ListClients(const AwaServerSession *session, json_object *respObj)
 {
     AwaError error;
     json_object *listObj = json_object_new_array();
@@ -66,7 +143,7 @@ static void ListClients(const AwaServerSession *session, json_object *respObj)
     {
         LOG(LOG_ERR, "Failed to create new ListClientsOperation");
         json_object_put(listObj);
-        return;
+        return false;
     }
     error = AwaServerListClientsOperation_Perform(operation, LIST_CLIENTS_OPERATION_TIMEOUT);
     if (error == AwaError_Success)
@@ -78,9 +155,10 @@ static void ListClients(const AwaServerSession *session, json_object *respObj)
             {
                 const char *clientID = AwaClientIterator_GetClientID(clientIterator);
                 const AwaServerListClientsResponse *response = AwaServerListClientsOperation_GetResponse(operation, clientID);
-                json_bool provisionStatus = IsFlowAccessInstanceRegistered(session, response) ? 1 : 0;
+                json_bool provisionStatus;
                 json_object *clientObj = json_object_new_object();
                 json_object_object_add(clientObj, "clientId", json_object_new_string(clientID));
+                provisionStatus = AddRegisteredObjects(response, clientObj) ? 1 : 0;
                 json_object_object_add(clientObj, "is_device_provisioned", json_object_new_boolean(provisionStatus));
                 json_object_array_add(listObj, clientObj);
 
@@ -103,16 +181,25 @@ static void ListClients(const AwaServerSession *session, json_object *respObj)
     }
 
     json_object_object_add(respObj, "clients", listObj);
+    return error == AwaError_Success;
 }
 //! \}
 
-void GetClientList(json_object *respObj)
+bool GetClientList(json_object *respObj)
 {
     AwaServerSession *session = NULL;
-    session = Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+
+    // Paced with the provisioning polls, so that its queue depth and waits show up in rate_limits.
+    if (!RateLimit_AcquirePoll(RATE_LIMIT_QUERY_TIMEOUT))
+    {
+        LOG(LOG_ERR, "No client list poll token within %d ms", RATE_LIMIT_QUERY_TIMEOUT);
+        return false;
+    }
+    session = Server_AcquireSession();
     if (session != NULL)
     {
-        ListClients(session, respObj);
-        Server_ReleaseSession(&session);
+        bool isHealthy = ListClients(session, respObj);
+        Server_ReturnSession(&session, isHealthy);
     }
+    return true;
 }
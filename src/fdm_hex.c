@@ -0,0 +1,123 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_hex.c
+ * @brief Provides table-driven hex encoding and decoding.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include "fdm_hex.h"
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static const char hexDigits[16] = "0123456789ABCDEF";
+
+// Digit value plus one, so that every other character maps to 0.
+static const uint8_t hexValues[256] =
+{
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16
+};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+size_t Hex_Encode(char *text, const uint8_t *data, size_t length, char separator)
+{
+    char *start = text;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        *text++ = hexDigits[data[i] >> 4];
+        *text++ = hexDigits[data[i] & 0x0F];
+        if (separator)
+        {
+            *text++ = separator;
+        }
+    }
+    return text - start;
+}
+
+/**
+ * @brief Check for a character allowed between bytes.
+ * @param[in] c Character.
+ * @return true if c is a separator, else false.
+ */
+static inline bool IsSeparator(unsigned char c)
+{
+    return c == ' ' || c == ':' || c == '\t';
+}
+
+int Hex_Decode(uint8_t *data, size_t maxLength, const char *text)
+{
+    const unsigned char *in = (const unsigned char *)text;
+    size_t length = 0;
+    uint8_t high, low;
+
+    if (data == NULL || text == NULL)
+    {
+        return -1;
+    }
+
+    while (true)
+    {
+        while (IsSeparator(*in))
+        {
+            in++;
+        }
+        if (*in == '\0')
+        {
+            break;
+        }
+
+        high = hexValues[in[0]];
+        low = high ? hexValues[in[1]] : 0;
+        if (!low || length == maxLength)
+        {
+            return -1;
+        }
+        data[length++] = ((high - 1) << 4) | (low - 1);
+        in += 2;
+    }
+    return (int)length;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_hex.h
+ * @brief Header file for exposing the hex codec used for opaque values such as device ids.
+ */
+
+#ifndef FDM_HEX_H
+#define FDM_HEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of characters Hex_Encode writes for length bytes. */
+#define HEX_ENCODED_LENGTH(length, separator) ((length) * ((separator) ? 3 : 2))
+
+/**
+ * @brief Encode bytes as upper case hex, each byte optionally followed by a separator, e.g.
+ *        "08 5A 24 " as saved in flow_access.cfg. No terminator is written.
+ * @param[out] text Buffer of at least HEX_ENCODED_LENGTH(length, separator) characters.
+ * @param[in] data Bytes to encode.
+ * @param[in] length Number of bytes.
+ * @param[in] separator Character written after each byte, or '\0' for compact output.
+ * @return Number of characters written.
+ */
+size_t Hex_Encode(char *text, const uint8_t *data, size_t length, char separator);
+
+/**
+ * @brief Decode hex text into bytes. Digits may be in either case and bytes may be compact
+ *        ("085A24"), or separated by spaces ("08 5A 24 ") or colons ("08:5A:24").
+ * @param[out] data Buffer for the decoded bytes.
+ * @param[in] maxLength Size of data.
+ * @param[in] text NUL terminated text to decode.
+ * @return Number of bytes decoded, or -1 if the text is not valid hex or does not fit.
+ */
+int Hex_Decode(uint8_t *data, size_t maxLength, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* FDM_HEX_H */
@@ -40,18 +40,18 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include "fdm_hmac.h"
+#include "fdm_sha256_accel.h"
 
 /***************************************************************************************************
  * Macros
  **************************************************************************************************/
 
 //! @cond Doxygen Suppress
-#define SHA256_HASH_LENGTH 32
 #define MAX_KEY_LENGTH     64
-#define MAX_BUFFER_LENGTH  1024
-
-// DBL_INT_ADD treats two unsigned ints a and b as one 64-bit integer and adds c to it
-#define DBL_INT_ADD(a,b,c) if (a > 0xffffffff - (c)) ++b; a += c;
+#define HMAC_LANES         8
+// Bit length of a pad block followed by a hash, as hashed by each step of a chain
+#define HMAC_CHAIN_BIT_LENGTH  ((SHA256_BLOCK_SIZE + SHA256_HASH_LENGTH) * 8)
 #define ROTLEFT(a,b)  (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
 
@@ -70,24 +70,51 @@
     (b)[(i) + 3] = (uint8_t) ( (n)       );     \
 }
 
+#ifdef SHA256_UNROLLED
+// One round, with the working variables renamed by the caller instead of shifted.
+#define SHA256_ROUND(a,b,c,d,e,f,g,h,i,w)                   \
+{                                                           \
+    t1 = (h) + EP1(e) + CH(e,f,g) + sha256RoundConstants[i] + (w); \
+    (d) += t1;                                              \
+    (h) = t1 + EP0(a) + MAJ(a,b,c);                         \
+}
+
+// Next schedule word, computed in place in the 16 word ring.
+#define SHA256_SCHEDULE(i)                                  \
+    (m[(i) & 15] += SIG1(m[((i) - 2) & 15]) + m[((i) - 7) & 15] + SIG0(m[((i) - 15) & 15]))
+
+#define SHA256_EIGHT_ROUNDS(i, W)                           \
+{                                                           \
+    SHA256_ROUND(a, b, c, d, e, f, g, h, (i) + 0, W((i) + 0));  \
+    SHA256_ROUND(h, a, b, c, d, e, f, g, (i) + 1, W((i) + 1));  \
+    SHA256_ROUND(g, h, a, b, c, d, e, f, (i) + 2, W((i) + 2));  \
+    SHA256_ROUND(f, g, h, a, b, c, d, e, (i) + 3, W((i) + 3));  \
+    SHA256_ROUND(e, f, g, h, a, b, c, d, (i) + 4, W((i) + 4));  \
+    SHA256_ROUND(d, e, f, g, h, a, b, c, (i) + 5, W((i) + 5));  \
+    SHA256_ROUND(c, d, e, f, g, h, a, b, (i) + 6, W((i) + 6));  \
+    SHA256_ROUND(b, c, d, e, f, g, h, a, (i) + 7, W((i) + 7));  \
+}
+
+#define SHA256_MESSAGE(i)  m[(i) & 15]
+#endif
+
 
 /***************************************************************************************************
  * Typedefs
  **************************************************************************************************/
 
-typedef struct
-{
-    uint8_t  Data[64];
-    uint32_t DataLen;
-    uint32_t BitLen[2];
-    uint32_t State[8];
-} Sha256ContextType;
+/**
+ * One 32 bit word of every lane. Built with AVX2 this is a single register, with SSE2 a pair,
+ * elsewhere whatever the target's vector unit, or plain scalar code, makes of it.
+ */
+typedef uint32_t HmacLanes __attribute__((vector_size(HMAC_LANES * sizeof(uint32_t))));
+
 
 /***************************************************************************************************
  * Globals
  **************************************************************************************************/
 
-static const uint32_t k[64] =
+const uint32_t sha256RoundConstants[64] =
 {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
     0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
@@ -103,7 +130,69 @@ static const uint32_t k[64] =
  * Methods
  **************************************************************************************************/
 
-static void Sha256_Transform(Sha256ContextType *context, uint8_t * data)
+#ifdef SHA256_UNROLLED
+/**
+ * @brief Load a big endian 32 bit word with one, possibly unaligned, read.
+ */
+static inline uint32_t Sha256_LoadWord(const uint8_t *data)
+{
+    uint32_t word;
+
+    memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#elif !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+    word = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+#endif
+    return word;
+}
+
+/**
+ * @brief Unrolled transform for small cache cores. The message schedule lives in a 16 word ring
+ *        and the working variables are renamed per round, so it needs few registers and no large
+ *        stack frame.
+ */
+static void Sha256_Transform(uint32_t state[8], const uint8_t *data)
+{
+    uint32_t a,b,c,d,e,f,g,h,i,t1,m[16];
+
+    for (i = 0; i < 16; i++)
+    {
+        m[i] = Sha256_LoadWord(data + i * 4);
+    }
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    SHA256_EIGHT_ROUNDS(0, SHA256_MESSAGE);
+    SHA256_EIGHT_ROUNDS(8, SHA256_MESSAGE);
+
+    for (i = 16; i < 64; i += 16)
+    {
+        SHA256_EIGHT_ROUNDS(i, SHA256_SCHEDULE);
+        SHA256_EIGHT_ROUNDS(i + 8, SHA256_SCHEDULE);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+#else
+/**
+ * @brief Reference transform, expanding the whole message schedule up front.
+ */
+static void Sha256_Transform(uint32_t state[8], const uint8_t *data)
 {
     uint32_t a,b,c,d,e,f,g,h,i,j,t1,t2,m[64];
 
@@ -117,18 +206,18 @@ static void Sha256_Transform(Sha256ContextType *context, uint8_t * data)
         m[i] = SIG1(m[i-2]) + m[i-7] + SIG0(m[i-15]) + m[i-16];
     }
 
-    a = context->State[0];
-    b = context->State[1];
-    c = context->State[2];
-    d = context->State[3];
-    e = context->State[4];
-    f = context->State[5];
-    g = context->State[6];
-    h = context->State[7];
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
 
     for (i = 0; i < 64; i++)
     {
-        t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+        t1 = h + EP1(e) + CH(e,f,g) + sha256RoundConstants[i] + m[i];
         t2 = EP0(a) + MAJ(a,b,c);
         h = g;
         g = f;
@@ -140,21 +229,68 @@ static void Sha256_Transform(Sha256ContextType *context, uint8_t * data)
         a = t1 + t2;
     }
 
-    context->State[0] += a;
-    context->State[1] += b;
-    context->State[2] += c;
-    context->State[3] += d;
-    context->State[4] += e;
-    context->State[5] += f;
-    context->State[6] += g;
-    context->State[7] += h;
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+#endif
+
+/**
+ * @brief Compress whole blocks with the portable transform.
+ */
+static void Sha256_ProcessBlocksPortable(uint32_t state[8], const uint8_t *data, size_t numBlocks)
+{
+    while (numBlocks--)
+    {
+        Sha256_Transform(state, data);
+        data += SHA256_BLOCK_SIZE;
+    }
+}
+
+/**
+ * Available compression functions, indexed by Sha256Implementation.
+ */
+static const Sha256ProcessBlocksFunction sha256Implementations[Sha256Implementation_Max] =
+{
+    [Sha256Implementation_Portable] = Sha256_ProcessBlocksPortable,
+#ifdef SHA256_HAVE_SHA_NI
+    [Sha256Implementation_ShaNi] = Sha256_ProcessBlocksShaNi,
+#endif
+#ifdef SHA256_HAVE_ARM_CE
+    [Sha256Implementation_ArmCe] = Sha256_ProcessBlocksArmCe,
+#endif
+#ifdef SHA256_HAVE_LIBRARY
+    [Sha256Implementation_Library] = Sha256_ProcessBlocksLibrary,
+#endif
+};
+
+static Sha256Implementation sha256Implementation = Sha256Implementation_Portable;
+static Sha256ProcessBlocksFunction Sha256_ProcessBlocks = Sha256_ProcessBlocksPortable;
+
+/**
+ * @brief Pick the crypto library's compression function if built with one, otherwise the fastest
+ *        one the CPU supports, once at startup.
+ */
+__attribute__((constructor)) static void Sha256_SelectImplementation(void)
+{
+    if (HmacSha256_SetImplementation(Sha256Implementation_Library) ||
+        HmacSha256_SetImplementation(Sha256Implementation_ShaNi) ||
+        HmacSha256_SetImplementation(Sha256Implementation_ArmCe))
+    {
+        return;
+    }
+    HmacSha256_SetImplementation(Sha256Implementation_Portable);
 }
 
 static void Sha256_Init(Sha256ContextType *context)
 {
     context->DataLen   = 0;
-    context->BitLen[0] = 0;
-    context->BitLen[1] = 0;
+    context->BitLen    = 0;
     context->State[0]  = 0x6a09e667;
     context->State[1]  = 0xbb67ae85;
     context->State[2]  = 0x3c6ef372;
@@ -165,21 +301,45 @@ static void Sha256_Init(Sha256ContextType *context)
     context->State[7]  = 0x5be0cd19;
 }
 
-static void Sha256_Update(Sha256ContextType *context, const uint8_t *data, uint32_t dataLen)
+static void Sha256_Update(Sha256ContextType *context, const uint8_t *data, size_t dataLen)
 {
-    uint32_t i;
+    size_t length;
+
+    context->BitLen += (uint64_t)dataLen * 8;
 
-    for (i = 0; i < dataLen; i++)
+    // Top up a partly filled block first.
+    if (context->DataLen > 0)
     {
-        context->Data[context->DataLen] = data[i];
-        context->DataLen++;
-        if (context->DataLen == 64)
+        length = SHA256_BLOCK_SIZE - context->DataLen;
+        if (length > dataLen)
+        {
+            length = dataLen;
+        }
+        memcpy(context->Data + context->DataLen, data, length);
+        context->DataLen += length;
+        data += length;
+        dataLen -= length;
+
+        if (context->DataLen < SHA256_BLOCK_SIZE)
         {
-            Sha256_Transform(context,context->Data);
-            DBL_INT_ADD(context->BitLen[0], context->BitLen[1], 512);
-            context->DataLen = 0;
+            return;
         }
+        Sha256_ProcessBlocks(context->State, context->Data, 1);
+        context->DataLen = 0;
     }
+
+    // Whole blocks are hashed straight from the input.
+    if (dataLen >= SHA256_BLOCK_SIZE)
+    {
+        length = dataLen / SHA256_BLOCK_SIZE;
+        Sha256_ProcessBlocks(context->State, data, length);
+        data += length * SHA256_BLOCK_SIZE;
+        dataLen -= length * SHA256_BLOCK_SIZE;
+    }
+
+    // Keep the tail for the next update or the final block.
+    memcpy(context->Data, data, dataLen);
+    context->DataLen = dataLen;
 }
 
 static void Sha256_Final(Sha256ContextType *context, uint8_t hash[])
@@ -201,15 +361,14 @@ static void Sha256_Final(Sha256ContextType *context, uint8_t hash[])
         while (i < 64)
             context->Data[i++] = 0x00;
 
-        Sha256_Transform(context,context->Data);
+        Sha256_ProcessBlocks(context->State, context->Data, 1);
         memset(context->Data, 0, 56);
     }
 
     // Append to the padding the total message's length in bits and transform.
-    DBL_INT_ADD(context->BitLen[0], context->BitLen[1], context->DataLen * 8);
-    PUT_UINT32(context->BitLen[0], context->Data, 60);
-    PUT_UINT32(context->BitLen[1], context->Data, 56);
-    Sha256_Transform(context, context->Data);
+    PUT_UINT32((uint32_t)(context->BitLen >> 32), context->Data, 56);
+    PUT_UINT32((uint32_t)context->BitLen, context->Data, 60);
+    Sha256_ProcessBlocks(context->State, context->Data, 1);
 
     // Copy result into output buffer
     PUT_UINT32(context->State[0], hash,  0);
@@ -223,13 +382,7 @@ static void Sha256_Final(Sha256ContextType *context, uint8_t hash[])
 }
 //! @endcond
 
-/**
- * @brief Compute a Hash of the data provided using SHA256 and write the result into a buffer
- * @param[out] hash   - buffer to store resulting hash
- * @param[in] data    - pointer to data to hash
- * @param[in] dataLen - length of data in buffer
- */
-static void Sha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, int dataLen)
+void Sha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, size_t dataLen)
 {
     Sha256ContextType context;
     Sha256_Init(&context);
@@ -238,21 +391,22 @@ static void Sha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *
 }
 
 /**
- * @brief Compute a Hmac using SHA256 of the data provided and write the result into a buffer
- * @param[out] hash   - buffer to store resulting hash
- * @param[in] data    - pointer to data to hash
- * @param[in] dataLen - length of data in buffer
- * @param[in] key     - pointer to key
- * @param[in] keyLen  - length of key
+ * @brief Start a SHA256 hash from a midstate saved after one 64 byte block.
+ * @param[out] context - context to initialise
+ * @param[in] state    - saved midstate
  */
-void HmacSha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, int dataLen,
-    const uint8_t *key, int keyLen)
+static void Sha256_InitFromState(Sha256ContextType *context, const uint32_t state[8])
+{
+    context->DataLen   = 0;
+    context->BitLen    = SHA256_BLOCK_SIZE * 8;
+    memcpy(context->State, state, sizeof(context->State));
+}
+
+void HmacSha256_SetKey(HmacSha256Key *hmacKey, const uint8_t *key, int keyLen)
 {
-    uint8_t innerKeyPad[MAX_KEY_LENGTH];
-    uint8_t outerKeyPad[MAX_KEY_LENGTH];
+    Sha256ContextType context;
+    uint8_t keyPad[MAX_KEY_LENGTH];
     uint8_t keyHash[SHA256_HASH_LENGTH];
-    uint8_t innerHash[SHA256_HASH_LENGTH];
-    uint8_t buffer[MAX_BUFFER_LENGTH];
     unsigned int i;
 
     // if key is longer than 64 bytes use the hash of the key as the key.
@@ -263,29 +417,344 @@ void HmacSha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *dat
         keyLen = SHA256_HASH_LENGTH;
     }
 
-    // copy key to pad values, we will then XOR this with 0x36 and 0x5c respectively
-    memset(innerKeyPad, 0, sizeof(innerKeyPad));
-    memset(outerKeyPad, 0, sizeof(outerKeyPad));
-    memcpy(innerKeyPad, key, keyLen);
-    memcpy(outerKeyPad, key, keyLen);
+    // compress the inner pad block, key XOR 0x36, once
+    memset(keyPad, 0, sizeof(keyPad));
+    memcpy(keyPad, key, keyLen);
+    for (i = 0; i < MAX_KEY_LENGTH; i++)
+    {
+        keyPad[i] ^= 0x36;
+    }
+    Sha256_Init(&context);
+    Sha256_ProcessBlocks(context.State, keyPad, 1);
+    memcpy(hmacKey->InnerState, context.State, sizeof(hmacKey->InnerState));
 
+    // and the outer pad block, key XOR 0x5c, flipping the inner pad bits in place
     for (i = 0; i < MAX_KEY_LENGTH; i++)
     {
-        innerKeyPad[i] ^= 0x36;
-        outerKeyPad[i] ^= 0x5c;
+        keyPad[i] ^= 0x36 ^ 0x5c;
     }
+    Sha256_Init(&context);
+    Sha256_ProcessBlocks(context.State, keyPad, 1);
+    memcpy(hmacKey->OuterState, context.State, sizeof(hmacKey->OuterState));
 
-    // perform inner SHA256
-    memset(buffer, 0x00, sizeof(buffer));
-    memcpy(buffer, innerKeyPad, MAX_KEY_LENGTH);
-    memcpy(buffer + MAX_KEY_LENGTH, data, dataLen);
+    memset(keyPad, 0, sizeof(keyPad));
+    memset(keyHash, 0, sizeof(keyHash));
+}
 
-    Sha256_ComputeHash(innerHash, buffer, MAX_KEY_LENGTH + dataLen);
+void HmacSha256_Init(HmacSha256Context *context, const HmacSha256Key *hmacKey)
+{
+    // the inner hash resumes after the inner pad, the outer pad waits for the final step
+    Sha256_InitFromState(&context->Inner, hmacKey->InnerState);
+    memcpy(context->OuterState, hmacKey->OuterState, sizeof(context->OuterState));
+}
 
-    // perform outer SHA256
-    memset(buffer, 0x00, sizeof(buffer));
-    memcpy(buffer, outerKeyPad, MAX_KEY_LENGTH);
-    memcpy(buffer + MAX_KEY_LENGTH, innerHash, SHA256_HASH_LENGTH);
+void HmacSha256_Update(HmacSha256Context *context, const uint8_t *data, size_t dataLen)
+{
+    Sha256_Update(&context->Inner, data, dataLen);
+}
 
-    Sha256_ComputeHash(hash, buffer, MAX_KEY_LENGTH + SHA256_HASH_LENGTH);
+void HmacSha256_Final(HmacSha256Context *context, uint8_t hash[SHA256_HASH_LENGTH])
+{
+    uint8_t innerHash[SHA256_HASH_LENGTH];
+
+    Sha256_Final(&context->Inner, innerHash);
+
+    // perform outer SHA256 on top of the outer pad midstate
+    Sha256_InitFromState(&context->Inner, context->OuterState);
+    Sha256_Update(&context->Inner, innerHash, SHA256_HASH_LENGTH);
+    Sha256_Final(&context->Inner, hash);
+}
+
+void HmacSha256_ComputeHashWithKey(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, int dataLen,
+    const HmacSha256Key *hmacKey)
+{
+    HmacSha256Context context;
+
+    HmacSha256_Init(&context, hmacKey);
+    HmacSha256_Update(&context, data, dataLen);
+    HmacSha256_Final(&context, hash);
+}
+
+void HmacSha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, int dataLen,
+    const uint8_t *key, int keyLen)
+{
+    HmacSha256Key hmacKey;
+
+    HmacSha256_SetKey(&hmacKey, key, keyLen);
+    HmacSha256_ComputeHashWithKey(hash, data, dataLen, &hmacKey);
+    memset(&hmacKey, 0, sizeof(hmacKey));
+}
+
+/**
+ * @brief Compress one block per lane.
+ * @param[in,out] state State of every lane.
+ * @param[in] m Block of every lane, used as the schedule ring and so overwritten.
+ */
+static inline __attribute__((always_inline)) void HmacLanes_Compress(HmacLanes state[8], HmacLanes m[16])
+{
+    HmacLanes a,b,c,d,e,f,g,h,t1,t2;
+    unsigned int i;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    for (i = 0; i < 64; i++)
+    {
+        if (i >= 16)
+        {
+            m[i & 15] += SIG1(m[(i - 2) & 15]) + m[(i - 7) & 15] + SIG0(m[(i - 15) & 15]);
+        }
+        t1 = h + EP1(e) + CH(e,f,g) + sha256RoundConstants[i] + m[i & 15];
+        t2 = EP0(a) + MAJ(a,b,c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+/**
+ * @brief Hash a 32 byte message per lane, on top of the pad midstates of that lane.
+ * @param[out] hash Resulting hash words.
+ * @param[in] state Pad midstate of every lane.
+ * @param[in] message Message words of every lane.
+ */
+static inline __attribute__((always_inline)) void HmacLanes_HashBlock(HmacLanes hash[8],
+    const HmacLanes state[8], const HmacLanes message[8])
+{
+    HmacLanes m[16];
+    unsigned int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        m[i] = message[i];
+        hash[i] = state[i];
+    }
+    m[8] = (HmacLanes){0} + 0x80000000;
+    for (i = 9; i < 15; i++)
+    {
+        m[i] = (HmacLanes){0};
+    }
+    m[15] = (HmacLanes){0} + HMAC_CHAIN_BIT_LENGTH;
+
+    HmacLanes_Compress(hash, m);
+}
+
+/**
+ * @brief Run up to maxIterations steps, hash = HMAC(key, hash), of every lane.
+ * @param[in,out] hash Hash words of every lane.
+ * @param[in] innerState Inner pad midstate of every lane.
+ * @param[in] outerState Outer pad midstate of every lane.
+ * @param[in] steps Steps left for every lane, lanes stop changing once theirs reach 0.
+ * @param[in] maxIterations Largest value in remaining.
+ */
+static inline __attribute__((always_inline)) void HmacLanes_Iterate(HmacLanes hash[8],
+    const HmacLanes innerState[8], const HmacLanes outerState[8], const HmacLanes *steps,
+    unsigned int maxIterations)
+{
+    HmacLanes innerHash[8], outerHash[8], active, remaining = *steps;
+    unsigned int i, j;
+
+    for (i = 0; i < maxIterations; i++)
+    {
+        HmacLanes_HashBlock(innerHash, innerState, hash);
+        HmacLanes_HashBlock(outerHash, outerState, innerHash);
+
+        // all ones in lanes which still have steps left
+        active = (HmacLanes)(remaining != 0);
+        for (j = 0; j < 8; j++)
+        {
+            hash[j] = (outerHash[j] & active) | (hash[j] & ~active);
+        }
+        remaining += active;
+    }
+}
+
+#ifdef HMAC_HAVE_AVX2
+__attribute__((target("avx2")))
+static void HmacLanes_IterateAvx2(HmacLanes hash[8], const HmacLanes innerState[8],
+    const HmacLanes outerState[8], const HmacLanes *steps, unsigned int maxIterations)
+{
+    HmacLanes_Iterate(hash, innerState, outerState, steps, maxIterations);
+}
+#endif
+
+static void HmacLanes_IterateGeneric(HmacLanes hash[8], const HmacLanes innerState[8],
+    const HmacLanes outerState[8], const HmacLanes *steps, unsigned int maxIterations)
+{
+    HmacLanes_Iterate(hash, innerState, outerState, steps, maxIterations);
+}
+
+/**
+ * @brief Run a group of up to HMAC_LANES chains side by side.
+ * @param[in,out] chains Chains of the group.
+ * @param[in] numChains Number of chains, at most HMAC_LANES.
+ */
+static void HmacSha256_ComputeChainGroup(HmacSha256Chain chains[], unsigned int numChains)
+{
+    HmacLanes hash[8], innerState[8], outerState[8], remaining;
+    unsigned int lane, i, maxIterations = 0;
+    HmacSha256Chain *chain;
+
+    remaining = (HmacLanes){0};
+    for (i = 0; i < 8; i++)
+    {
+        hash[i] = innerState[i] = outerState[i] = remaining;
+    }
+
+    // The first step hashes the variable length data, so it's done a lane at a time.
+    for (lane = 0; lane < numChains; lane++)
+    {
+        chain = &chains[lane];
+        HmacSha256_ComputeHashWithKey(chain->Hash, chain->Data, chain->DataLen, chain->Key);
+        if (chain->Iterations > 1)
+        {
+            remaining[lane] = chain->Iterations - 1;
+            if (remaining[lane] > maxIterations)
+            {
+                maxIterations = remaining[lane];
+            }
+        }
+        for (i = 0; i < 8; i++)
+        {
+            hash[i][lane] = ((uint32_t)chain->Hash[i * 4] << 24) | ((uint32_t)chain->Hash[i * 4 + 1] << 16) |
+                ((uint32_t)chain->Hash[i * 4 + 2] << 8) | chain->Hash[i * 4 + 3];
+            innerState[i][lane] = chain->Key->InnerState[i];
+            outerState[i][lane] = chain->Key->OuterState[i];
+        }
+    }
+
+    if (maxIterations == 0)
+    {
+        return;
+    }
+
+#ifdef HMAC_HAVE_AVX2
+    if (Sha256_HasAvx2())
+    {
+        HmacLanes_IterateAvx2(hash, innerState, outerState, &remaining, maxIterations);
+    }
+    else
+#endif
+    {
+        HmacLanes_IterateGeneric(hash, innerState, outerState, &remaining, maxIterations);
+    }
+
+    for (lane = 0; lane < numChains; lane++)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            PUT_UINT32(hash[i][lane], chains[lane].Hash, i * 4);
+        }
+    }
+}
+
+/**
+ * @brief Run chains one after the other.
+ * @param[in,out] chains Chains to compute.
+ * @param[in] numChains Number of chains.
+ */
+static void HmacSha256_ComputeChainsSerially(HmacSha256Chain chains[], unsigned int numChains)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < numChains; i++)
+    {
+        HmacSha256_ComputeHashWithKey(chains[i].Hash, chains[i].Data, chains[i].DataLen, chains[i].Key);
+        for (j = 1; j < chains[i].Iterations; j++)
+        {
+            HmacSha256_ComputeHashWithKey(chains[i].Hash, chains[i].Hash, SHA256_HASH_LENGTH, chains[i].Key);
+        }
+    }
+}
+
+void HmacSha256_ComputeHashChains(HmacSha256Chain chains[], unsigned int numChains)
+{
+    unsigned int i, groupSize;
+    bool useLanes = sha256Implementation == Sha256Implementation_Portable;
+    bool isHardware = !useLanes;
+
+#ifdef HMAC_HAVE_AVX2
+    // 8 AVX2 lanes outrun SHA-NI on one chain, SSE2 lanes don't.
+    useLanes = useLanes || Sha256_HasAvx2();
+#endif
+
+    if (numChains < 2 || !useLanes)
+    {
+        HmacSha256_ComputeChainsSerially(chains, numChains);
+        return;
+    }
+
+    for (i = 0; i < numChains; i += groupSize)
+    {
+        groupSize = numChains - i < HMAC_LANES ? numChains - i : HMAC_LANES;
+        // Against hardware SHA256 only a full group of lanes pays off, bench_hmac's chain sweep
+        // shows a half empty one running slower than the chains one at a time.
+        if (isHardware && groupSize < HMAC_LANES)
+        {
+            HmacSha256_ComputeChainsSerially(&chains[i], groupSize);
+        }
+        else
+        {
+            HmacSha256_ComputeChainGroup(&chains[i], groupSize);
+        }
+    }
+}
+
+bool HmacSha256_IsImplementationSupported(Sha256Implementation implementation)
+{
+    switch (implementation)
+    {
+        case Sha256Implementation_Portable:
+            return true;
+#ifdef SHA256_HAVE_SHA_NI
+        case Sha256Implementation_ShaNi:
+            return Sha256_HasShaNi();
+#endif
+#ifdef SHA256_HAVE_ARM_CE
+        case Sha256Implementation_ArmCe:
+            return Sha256_HasArmCe();
+#endif
+#ifdef SHA256_HAVE_LIBRARY
+        case Sha256Implementation_Library:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool HmacSha256_SetImplementation(Sha256Implementation implementation)
+{
+    if (!HmacSha256_IsImplementationSupported(implementation))
+    {
+        return false;
+    }
+    sha256Implementation = implementation;
+    Sha256_ProcessBlocks = sha256Implementations[implementation];
+    return true;
+}
+
+Sha256Implementation HmacSha256_GetImplementation(void)
+{
+    return sha256Implementation;
 }
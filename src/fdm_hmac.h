@@ -42,14 +42,93 @@
 
 //! \{
 #define SHA256_HASH_LENGTH 32
+#define SHA256_BLOCK_SIZE  64
 //! \}
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief SHA256 compression function implementations. The crypto library backend, when built
+ *        with one, is selected at startup, otherwise the fastest one supported by the CPU.
+ */
+typedef enum
+{
+    Sha256Implementation_Portable,
+    Sha256Implementation_ShaNi,
+    Sha256Implementation_ArmCe,
+    Sha256Implementation_Library,
+    Sha256Implementation_Max
+} Sha256Implementation;
+
+/**
+ * @brief SHA256 hash in progress.
+ */
+typedef struct
+{
+    //! \{
+    uint8_t  Data[SHA256_BLOCK_SIZE];
+    uint32_t DataLen;
+    uint64_t BitLen;
+    uint32_t State[8];
+    //! \}
+} Sha256ContextType;
+
+/**
+ * @brief HMAC key with the inner and outer pad blocks already compressed, so that hashing with the
+ *        same key many times skips rederiving and rehashing the pads.
+ */
+typedef struct
+{
+    //! \{
+    uint32_t InnerState[8];
+    uint32_t OuterState[8];
+    //! \}
+} HmacSha256Key;
+
+/**
+ * @brief HMAC in progress, fed with any number of updates of any length.
+ */
+typedef struct
+{
+    //! \{
+    Sha256ContextType Inner;
+    uint32_t OuterState[8];
+    //! \}
+} HmacSha256Context;
+
+/**
+ * @brief Compute a Hash of the data provided using SHA256 and write the result into a buffer
+ * @param[out] hash   - buffer to store resulting hash
+ * @param[in] data    - pointer to data to hash
+ * @param[in] dataLen - length of data in buffer
+ */
+void Sha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, size_t dataLen);
+
+/**
+ * @brief Derive the inner and outer pad midstates of a key
+ * @param[out] hmacKey - key to initialise
+ * @param[in] key      - pointer to key
+ * @param[in] keyLen   - length of key
+ */
+void HmacSha256_SetKey(HmacSha256Key *hmacKey, const uint8_t *key, int keyLen);
+
+/**
+ * @brief Compute a Hmac using SHA256 of the data provided with a key prepared by HmacSha256_SetKey
+ *        and write the result into a buffer. hash may point to data.
+ * @param[out] hash   - buffer to store resulting hash
+ * @param[in] data    - pointer to data to hash
+ * @param[in] dataLen - length of data in buffer
+ * @param[in] hmacKey - prepared key
+ */
+void HmacSha256_ComputeHashWithKey(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *data, int dataLen,
+    const HmacSha256Key *hmacKey);
+
 /**
  * @brief Compute a Hmac using SHA256 of the data provided and write the result into a buffer
  * @param[out] hash   - buffer to store resulting hash
@@ -60,6 +139,71 @@ extern "C" {
  */
 void HmacSha256_ComputeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t * data, int dataLen, const uint8_t * key, int keyLen);
 
+/**
+ * @brief Start a streaming HMAC
+ * @param[out] context - context to initialise
+ * @param[in] hmacKey  - key prepared by HmacSha256_SetKey, only needed during this call
+ */
+void HmacSha256_Init(HmacSha256Context *context, const HmacSha256Key *hmacKey);
+
+/**
+ * @brief Add data to a streaming HMAC. Data is hashed in place, never copied to a fixed buffer.
+ * @param[in,out] context - context started by HmacSha256_Init
+ * @param[in] data        - pointer to data to hash
+ * @param[in] dataLen     - length of data in buffer
+ */
+void HmacSha256_Update(HmacSha256Context *context, const uint8_t *data, size_t dataLen);
+
+/**
+ * @brief Finish a streaming HMAC and write the result into a buffer
+ * @param[in,out] context - context started by HmacSha256_Init, to be initialised again for reuse
+ * @param[out] hash       - buffer to store resulting hash
+ */
+void HmacSha256_Final(HmacSha256Context *context, uint8_t hash[SHA256_HASH_LENGTH]);
+
+/**
+ * @brief One chain of HMACs, Hash = HMAC(Key, Data) followed by Hash = HMAC(Key, Hash) until
+ *        Iterations HMACs have been computed, as used for licensee hashes.
+ */
+typedef struct
+{
+    //! \{
+    const HmacSha256Key *Key;
+    const uint8_t *Data;
+    int DataLen;
+    unsigned int Iterations;
+    uint8_t Hash[SHA256_HASH_LENGTH];
+    //! \}
+} HmacSha256Chain;
+
+/**
+ * @brief Compute independent HMAC chains, running several of them side by side in SIMD lanes
+ *        when that is faster than one at a time.
+ * @param[in,out] chains    - chains to compute, the result is written to their Hash
+ * @param[in] numChains     - number of chains
+ */
+void HmacSha256_ComputeHashChains(HmacSha256Chain chains[], unsigned int numChains);
+
+/**
+ * @brief Check whether an implementation is built in and supported by the CPU.
+ * @param[in] implementation - implementation to check
+ * @return true if it can be used otherwise false.
+ */
+bool HmacSha256_IsImplementationSupported(Sha256Implementation implementation);
+
+/**
+ * @brief Force an implementation, e.g. to compare them. Not to be called while hashing.
+ * @param[in] implementation - implementation to use
+ * @return true for success, false if it isn't supported.
+ */
+bool HmacSha256_SetImplementation(Sha256Implementation implementation);
+
+/**
+ * @brief Get the implementation in use.
+ * @return Implementation in use.
+ */
+Sha256Implementation HmacSha256_GetImplementation(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,30 +28,31 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
- /**
-  * @file utils.c
-  * @brief Provides common functions.
-  */
+
+/**
+ * @file fdm_licensee_hash.c
+ * @brief Provides the licensee hash, kept apart from the Awa based verification so that it can be
+ *        tested and benchmarked on its own.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include "fdm_licensee_hash.h"
 
 /***************************************************************************************************
- * Implementation
+ * Methods
  **************************************************************************************************/
 
- /**
-* @brief Copy source string to target without space
-*/
-void CopyStringWithoutSpace(char *targetString, const char *sourceString)
+void CalculateLicenseeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *challenge,
+    int challengeLength, int iterations, const HmacSha256Key *hmacKey)
 {
-    unsigned int i = 0, j = 0;
+    int i;
 
-    while (sourceString[i] != '\0')
+    HmacSha256_ComputeHashWithKey(hash, challenge, challengeLength, hmacKey);
+    for (i = 1; i < iterations; i++)
     {
-        if (sourceString[i] != ' ')
-        {
-            targetString[j] = sourceString[i];
-            j++;
-        }
-        i++;
+        HmacSha256_ComputeHashWithKey(hash, hash, SHA256_HASH_LENGTH, hmacKey);
     }
-    targetString[j] = '\0';
 }
@@ -28,25 +28,35 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
- /**
-  * @file utils.h
-  * @brief Header file for exposing utils functions.
-  */
 
-#ifndef UTILS_H
-#define UTILS_H
+/**
+ * @file fdm_licensee_hash.h
+ * @brief Header file for the licensee hash answered to Flow licensee verification challenges.
+ */
+
+#ifndef FDM_LICENSEE_HASH_H
+#define FDM_LICENSEE_HASH_H
+
+#include "fdm_hmac.h"
 
-#ifdef  __cplusplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Copy source string to target without space
+ * @brief Calculate the Licensee Hash based-on challenge, HMAC(key, challenge) re-hashed with the
+ *        same key until iterations HMACs have been computed.
+ * @param[out] hash Hash of licensee data calculated from challenge and hash iterations.
+ * @param[in] challenge Licensee challenge.
+ * @param[in] challengeLength length of challenge.
+ * @param[in] iterations Hash iterations.
+ * @param[in] hmacKey Prepared key of the licensee secret.
  */
-void CopyStringWithoutSpace(char *targetString, const char *sourceString);
+void CalculateLicenseeHash(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *challenge,
+    int challengeLength, int iterations, const HmacSha256Key *hmacKey);
 
-#ifdef  __cplusplus
+#ifdef __cplusplus
 }
 #endif
 
-#endif  /* UTILS_H */
+#endif  /* FDM_LICENSEE_HASH_H */
@@ -38,108 +38,297 @@
  **************************************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <pthread.h>
 #include "awa/client.h"
+#include "fdm_base64.h"
 #include "fdm_hmac.h"
+#include "fdm_licensee_hash.h"
 #include "fdm_register.h"
 #include "fdm_common.h"
 #include "fdm_log.h"
 
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define KEY_CACHE_SIZE        (4)
+#define MAX_LICENSEE_KEY_SIZE (128)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * @brief Prepared HMAC key of a licensee secret.
+ */
+typedef struct
+{
+    //! \{
+    uint8_t secretHash[SHA256_HASH_LENGTH];
+    HmacSha256Key key;
+    unsigned int lastUsed;
+    bool inUse;
+    //! \}
+} CachedKey;
+
+/**
+ * @brief Licensee hash calculated on a worker thread. The worker only touches isDone and
+ *        isCancelled after starting, under jobLock.
+ */
+typedef struct LicenseeHashJob
+{
+    //! \{
+    HmacSha256Key key;
+    uint8_t *challenge;
+    size_t challengeLength;
+    int iterations;
+    uint8_t hash[SHA256_HASH_LENGTH];
+    bool isDone;
+    bool isCancelled;
+    //! \}
+} LicenseeHashJob;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static CachedKey keyCache[KEY_CACHE_SIZE];
+static unsigned int keyCacheClock;
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+//! @endcond
+
 /***************************************************************************************************
  * Methods
  **************************************************************************************************/
 
 /**
-* @brief Calculate the Licensee Hash based-on challenge.
-* @param[out] hash Hash of licensee data calculated from challenge and hash iterations.
-* @param[in] challenge Licensee challenge.
-* @param[in] challengeLength length of challenge.
-* @param[in] iterations Hash iterations.
-* @param[in] licenseeSecret Licensee Secret.
+* @brief Free a licensee hash job, wiping its key.
+* @param[in] job Job to free.
+*/
+static void FreeJob(LicenseeHashJob *job)
+{
+    free(job->challenge);
+    memset(job, 0, sizeof(*job));
+    free(job);
+}
+
+/**
+* @brief Get the prepared HMAC key of a licensee secret, decoding and preparing it only if it isn't
+*        cached yet. Entries are looked up by the SHA256 of the secret, so the secret itself is
+*        never kept.
+* @param[out] hmacKey Prepared key.
+* @param[in] licenseeSecret Base64 encoded licensee secret.
 * @return true for success otherwise false.
 */
-static bool CalculateLicenseeHash(uint8_t hash[SHA256_HASH_LENGTH], const char *challenge,
-    int challengeLength, int iterations, const char *licenseeSecret)
+static bool GetLicenseeKey(HmacSha256Key *hmacKey, const char *licenseeSecret)
 {
-    unsigned int i;
-    uint8_t key[MAX_STR_SIZE];
+    uint8_t secretHash[SHA256_HASH_LENGTH];
+    uint8_t key[MAX_LICENSEE_KEY_SIZE];
+    size_t secretLength = strlen(licenseeSecret);
+    CachedKey *entry = &keyCache[0];
     int keyLength;
+    unsigned int i;
+
+    Sha256_ComputeHash(secretHash, (const uint8_t *)licenseeSecret, secretLength);
 
-    if (challenge == NULL || licenseeSecret == NULL)
+    for (i = 0; i < KEY_CACHE_SIZE; i++)
     {
-        LOG(LOG_ERR, "Null params passed to %s()", __func__);
-        return false;
+        if (keyCache[i].inUse && memcmp(keyCache[i].secretHash, secretHash, SHA256_HASH_LENGTH) == 0)
+        {
+            LOG(LOG_DBG, "Using cached licensee key");
+            keyCache[i].lastUsed = ++keyCacheClock;
+            *hmacKey = keyCache[i].key;
+            return true;
+        }
+        // remember a free or else the least recently used entry
+        if (!keyCache[i].inUse || (entry->inUse && keyCache[i].lastUsed < entry->lastUsed))
+        {
+            entry = &keyCache[i];
+        }
     }
 
-    LOG(LOG_DBG, "Calculating licensee hash");
-
-    keyLength = b64Decode((char *)key, sizeof(key), licenseeSecret, strlen(licenseeSecret));
-
+    keyLength = Base64_Decode(key, sizeof(key), licenseeSecret, secretLength);
     if (keyLength == -1)
     {
         LOG(LOG_ERR, "Failed to decode a base64 encoded value");
         return false;
     }
 
-    HmacSha256_ComputeHash(hash, (const uint8_t *) challenge, challengeLength, key, keyLength);
-    for (i = 1; i < iterations; i++)
+    HmacSha256_SetKey(hmacKey, key, keyLength);
+    memset(key, 0, sizeof(key));
+
+    // the evicted key is overwritten in place
+    memcpy(entry->secretHash, secretHash, SHA256_HASH_LENGTH);
+    entry->key = *hmacKey;
+    entry->lastUsed = ++keyCacheClock;
+    entry->inUse = true;
+    return true;
+}
+
+/**
+* @brief Compute the hash of a job on the worker thread, then post it back. The job is freed here
+*        instead if it was cancelled meanwhile.
+* @param[in] arg Licensee hash job.
+* @return NULL.
+*/
+static void *LicenseeHashWorker(void *arg)
+{
+    LicenseeHashJob *job = arg;
+    bool isCancelled;
+
+    LOG(LOG_DBG, "Calculating licensee hash");
+    CalculateLicenseeHash(job->hash, job->challenge, job->challengeLength, job->iterations, &job->key);
+
+    pthread_mutex_lock(&jobLock);
+    job->isDone = true;
+    isCancelled = job->isCancelled;
+    pthread_mutex_unlock(&jobLock);
+
+    if (isCancelled)
     {
-        HmacSha256_ComputeHash(hash, hash, SHA256_HASH_LENGTH, key, keyLength);
+        FreeJob(job);
     }
-    return true;
+    return NULL;
 }
 
-bool PerformFlowLicenseeVerification(AwaClientSession *session, Verification *verificationData, const char *licenseeSecret)
+bool StartFlowLicenseeVerification(Verification *verificationData, const char *licenseeSecret)
 {
-    uint8_t licenseeHash[SHA256_HASH_LENGTH] = {0};
-    char licenseeHashResourcePath[URL_PATH_SIZE] = {0};
-    AwaError error;
+    LicenseeHashJob *job;
+    pthread_attr_t attributes;
+    pthread_t thread;
+    bool isStarted = false;
 
-    if (session == NULL || verificationData == NULL)
+    if (verificationData == NULL || licenseeSecret == NULL || verificationData->challenge.Data == NULL)
     {
         LOG(LOG_ERR, "Null params passed to %s()", __func__);
         return false;
     }
 
+    if (verificationData->hashJob != NULL)
+    {
+        LOG(LOG_DBG, "Licensee hash is already being calculated");
+        return true;
+    }
+
     LOG(LOG_INFO, "Performing flow license verification");
 
-    // Calculate the LicenseeHash based-on challenge
-    if (!CalculateLicenseeHash(licenseeHash, verificationData->challenge.Data,
-        verificationData->challenge.Size, verificationData->iterations, licenseeSecret))
+    if ((job = calloc(1, sizeof(*job))) == NULL ||
+        (job->challenge = malloc(verificationData->challenge.Size)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate licensee hash job");
+        free(job);
+        verificationData->waitForServerResponse = false;
+        return false;
+    }
+    memcpy(job->challenge, verificationData->challenge.Data, verificationData->challenge.Size);
+    job->challengeLength = verificationData->challenge.Size;
+    job->iterations = verificationData->iterations;
+
+    // Decoding and key setup are cheap and use the key cache, so they stay on this thread.
+    if (!GetLicenseeKey(&job->key, licenseeSecret))
     {
         LOG(LOG_ERR, "Failed to calculate licensee hash");
+        FreeJob(job);
         verificationData->waitForServerResponse = false;
         return false;
     }
 
-    if (verificationData->licenseeHash.Data != NULL)
+    verificationData->hashJob = job;
+
+    if (pthread_attr_init(&attributes) == 0)
     {
-        free(verificationData->licenseeHash.Data);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        isStarted = pthread_create(&thread, &attributes, LicenseeHashWorker, job) == 0;
+        pthread_attr_destroy(&attributes);
     }
+    if (!isStarted)
+    {
+        LOG(LOG_WARN, "Failed to start licensee hash worker, calculating it here");
+        LicenseeHashWorker(job);
+    }
+    return true;
+}
 
-    verificationData->licenseeHash.Data = malloc(SHA256_HASH_LENGTH);
+bool PollFlowLicenseeVerification(AwaClientSession *session, Verification *verificationData)
+{
+    char licenseeHashResourcePath[URL_PATH_SIZE] = {0};
+    LicenseeHashJob *job;
+    AwaError error;
+    bool isDone;
 
-    if (verificationData->licenseeHash.Data != NULL)
+    if (session == NULL || verificationData == NULL)
     {
-        memcpy(verificationData->licenseeHash.Data , licenseeHash, SHA256_HASH_LENGTH);
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        return false;
     }
 
+    if ((job = verificationData->hashJob) == NULL)
+    {
+        return true;
+    }
+
+    pthread_mutex_lock(&jobLock);
+    isDone = job->isDone;
+    pthread_mutex_unlock(&jobLock);
+    if (!isDone)
+    {
+        return true;
+    }
+
+    // The job stays attached until the hash has been written, so that a failed write is retried
+    // on the next poll instead of losing the hash.
+    if (verificationData->licenseeHash.Data == NULL &&
+        (verificationData->licenseeHash.Data = malloc(SHA256_HASH_LENGTH)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate licensee hash");
+        return false;
+    }
+    memcpy(verificationData->licenseeHash.Data, job->hash, SHA256_HASH_LENGTH);
     verificationData->licenseeHash.Size = SHA256_HASH_LENGTH;
 
     // Write the hash to the Flow object
-    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeHashResourcePath, FlowObjectResourceId_LicenseeHash)) == AwaError_Success)
+    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeHashResourcePath, verificationData->instanceId,
+        FlowObjectResourceId_LicenseeHash)) != AwaError_Success)
     {
-        if(!SetResource(session, licenseeHashResourcePath, (void *)&verificationData->licenseeHash, AwaResourceType_Opaque))
-        {
-            LOG(LOG_ERR, "Failed to set licensee hash");
-            return false;
-        }
+        LOG(LOG_ERR, "Failed to create licensee hash resource path\nerror: %s", AwaError_ToString(error));
+        return false;
     }
-    else
+    if (!SetResource(session, licenseeHashResourcePath, (void *)&verificationData->licenseeHash, AwaResourceType_Opaque))
     {
-        LOG(LOG_ERR, "Failed to create licensee hash resource path\nerror: %s", AwaError_ToString(error));
+        LOG(LOG_ERR, "Failed to set licensee hash, retrying on the next poll");
         return false;
     }
+
+    verificationData->hashJob = NULL;
+    FreeJob(job);
     return true;
 }
+
+void CancelFlowLicenseeVerification(Verification *verificationData)
+{
+    LicenseeHashJob *job;
+    bool isDone;
+
+    if (verificationData == NULL || (job = verificationData->hashJob) == NULL)
+    {
+        return;
+    }
+    verificationData->hashJob = NULL;
+
+    // A running worker frees the job itself once it's done.
+    pthread_mutex_lock(&jobLock);
+    isDone = job->isDone;
+    job->isCancelled = true;
+    pthread_mutex_unlock(&jobLock);
+
+    if (isDone)
+    {
+        FreeJob(job);
+    }
+}
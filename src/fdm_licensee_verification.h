@@ -37,12 +37,28 @@
 #define FDM_LICENSEE_VERIFICATION_H
 
 /**
- * @brief Perform flow licensee verification using challenge and hash iterations and set the licensee hash to the flow object.
- * @param[in] session A pointer to a valid session.
+ * @brief Start flow licensee verification: calculate the licensee hash from the challenge and
+ *        hash iterations on a worker thread, so that the caller's loop stays responsive.
  * @param[in] verificationData Licensee verification data.
  * @param[in] licenseeSecret Licensee Secret.
  * @return true for success otherwise false.
  */
-bool PerformFlowLicenseeVerification(AwaClientSession *session, Verification *verificationData, const char *licenseeSecret);
+bool StartFlowLicenseeVerification(Verification *verificationData, const char *licenseeSecret);
+
+/**
+ * @brief Check for the licensee hash started by StartFlowLicenseeVerification, and set it to the
+ *        flow object once it has been calculated. If setting it fails the hash is kept and set
+ *        again by the next call.
+ * @param[in] session A pointer to a valid session.
+ * @param[in] verificationData Licensee verification data.
+ * @return true for success, including while the hash is still being calculated, otherwise false.
+ */
+bool PollFlowLicenseeVerification(AwaClientSession *session, Verification *verificationData);
+
+/**
+ * @brief Drop a licensee hash that is still being calculated.
+ * @param[in] verificationData Licensee verification data.
+ */
+void CancelFlowLicenseeVerification(Verification *verificationData);
 
 #endif  /* FDM_LICENSEE_VERIFICATION_H */
@@ -45,6 +45,10 @@
 #include <inttypes.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
 #include "awa/common.h"
 #include "awa/server.h"
 #include "device_manager.h"
@@ -52,6 +56,9 @@
 #include "fdm_log.h"
 #include "fdm_server_session.h"
 #include "fdm_register.h"
+#include "fdm_hex.h"
+#include "fdm_provision_journal.h"
+#include "fdm_rate_limit.h"
 
 /***************************************************************************************************
  * Definitions
@@ -62,9 +69,18 @@
 
 #define COAP_TIMEOUT 10000
 
-#define POLLING_SLEEP_SECONDS 2
+// Longest wait for a rate limit token, a device that isn't given one is left to the journal retry
+#define TOKEN_TIMEOUT 60000
+
+// Fallback polls start fast and back off, with jitter so that waiting devices spread out
+#define FIRST_POLL_INTERVAL_MS 250
+#define MAX_POLL_INTERVAL_MS 4000
 //! @endcond
 
+#if SERVER_SESSION_POOL_SIZE <= MAX_PROVISIONING_WINDOW
+#error "The server session pool must supply a full provisioning window next to the batch session"
+#endif
+
 /***************************************************************************************************
  * Typedef
  **************************************************************************************************/
@@ -81,10 +97,47 @@ typedef struct
     char deviceTypePath[URL_PATH_SIZE];
     char licenseeIDPath[URL_PATH_SIZE];
     char parentIDPath[URL_PATH_SIZE];
+    // FlowAccess object and instance, watched while waiting for provisioning
+    char flowAccessObjectPath[URL_PATH_SIZE];
+    char flowAccessInstancePath[URL_PATH_SIZE];
     //! \}
 
 } Paths;
 
+/**
+ * Constrained devices being provisioned together. Writes are handed out to the write workers from
+ * nextWrite, completion is then updated by server events and polls.
+ */
+typedef struct
+{
+    //! \{
+    ConstrainedDevice *devices;
+    DeviceStatus *statuses;
+    bool *isWaiting;
+    unsigned int numDevices;
+    unsigned int numWaiting;
+    const char *deviceType;
+    int licenseeID;
+    uint8_t parentID[DEVICE_ID_SIZE];
+    unsigned int nextWrite;
+    pthread_mutex_t lock;
+    int64_t start;
+    int64_t deadline;
+    //! \}
+} BatchProvisioning;
+
+/**
+ * Write worker of a batch, with the pooled session it writes on.
+ */
+typedef struct
+{
+    //! \{
+    BatchProvisioning *batch;
+    AwaServerSession *session;
+    pthread_t thread;
+    //! \}
+} WriteWorker;
+
 /***************************************************************************************************
  * Globals
  **************************************************************************************************/
@@ -92,6 +145,8 @@ typedef struct
 //! @cond Doxygen_Suppress
 static Paths pathStore;
 static bool pathsMade = false;
+static pthread_once_t pathsOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t defineLock = PTHREAD_MUTEX_INITIALIZER;
 //! @endcond
 
 /***************************************************************************************************
@@ -106,19 +161,20 @@ static bool MakePaths(void)
 {
     memset(&pathStore, 0, sizeof(Paths));
     if (AwaAPI_MakeObjectInstancePath(pathStore.flowObjectInstancePath, URL_PATH_SIZE,
-            Lwm2mObjectId_FlowObject, 0) != AwaError_Success ||
+            Lwm2mObjectId_FlowObject, OBJECT_INSTANCE_ID) != AwaError_Success ||
         // FlowObject resources
-        AwaAPI_MakeResourcePath(pathStore.fcapPath, URL_PATH_SIZE, Lwm2mObjectId_FlowObject, 0,
+        MAKE_FLOW_OBJECT_RESOURCE_PATH(pathStore.fcapPath, OBJECT_INSTANCE_ID,
             FlowObjectResourceId_Fcap) != AwaError_Success ||
-        AwaAPI_MakeResourcePath(pathStore.deviceTypePath, URL_PATH_SIZE,
-            Lwm2mObjectId_FlowObject, 0,
+        MAKE_FLOW_OBJECT_RESOURCE_PATH(pathStore.deviceTypePath, OBJECT_INSTANCE_ID,
             FlowObjectResourceId_DeviceType) != AwaError_Success ||
-        AwaAPI_MakeResourcePath(pathStore.licenseeIDPath, URL_PATH_SIZE,
-            Lwm2mObjectId_FlowObject, 0,
+        MAKE_FLOW_OBJECT_RESOURCE_PATH(pathStore.licenseeIDPath, OBJECT_INSTANCE_ID,
             FlowObjectResourceId_LicenseeId) != AwaError_Success ||
-        AwaAPI_MakeResourcePath(pathStore.parentIDPath, URL_PATH_SIZE,
-            Lwm2mObjectId_FlowObject, 0,
-            FlowObjectResourceId_ParentId) != AwaError_Success)
+        MAKE_FLOW_OBJECT_RESOURCE_PATH(pathStore.parentIDPath, OBJECT_INSTANCE_ID,
+            FlowObjectResourceId_ParentId) != AwaError_Success ||
+        // FlowAccess object and instance
+        MAKE_FLOW_ACCESS_OBJECT_PATH(pathStore.flowAccessObjectPath) != AwaError_Success ||
+        AwaAPI_MakeObjectInstancePath(pathStore.flowAccessInstancePath, URL_PATH_SIZE,
+            Lwm2mObjectId_FlowAccess, OBJECT_INSTANCE_ID) != AwaError_Success)
     {
         LOG(LOG_ERR, "Couldn't generate all object and resource paths");
         return false;
@@ -128,57 +184,142 @@ static bool MakePaths(void)
 }
 
 /**
- * @brief Check if flow access instance is registered or not.
- * @param[in] session Holds server session.
- * @param[in] clientListResponse List of responses from client.
- * @return true if flow access instance found, else false.
+ * @brief Generate the paths once for all the threads that provision.
  */
-bool IsFlowAccessInstanceRegistered(const AwaServerSession *session, const AwaServerListClientsResponse *clientListResponse)
+static void MakePathsOnce(void)
+{
+    pathsMade = MakePaths();
+}
+
+bool ParseRegisteredPath(const char *path, AwaObjectID *objectID, AwaObjectInstanceID *objectInstanceID)
+{
+    char *end;
+    unsigned long id;
+
+    if (path == NULL || path[0] != '/' || !isdigit((unsigned char)path[1]))
+    {
+        return false;
+    }
+    id = strtoul(&path[1], &end, 10);
+    if (id > AWA_MAX_ID)
+    {
+        return false;
+    }
+    *objectID = id;
+    *objectInstanceID = AWA_INVALID_ID;
+
+    if (*end == '\0')
+    {
+        return true;
+    }
+    if (end[0] != '/' || !isdigit((unsigned char)end[1]))
+    {
+        return false;
+    }
+    id = strtoul(&end[1], &end, 10);
+    if (*end != '\0' || id > AWA_MAX_ID)
+    {
+        return false;
+    }
+    *objectInstanceID = id;
+    return true;
+}
+
+bool GetRegisteredObjects(const AwaServerListClientsResponse *clientListResponse, RegisteredObjects *registeredObjects)
 {
-    bool found = false;
-    AwaRegisteredEntityIterator *objectIterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(clientListResponse);
+    AwaRegisteredEntityIterator *objectIterator;
+    AwaObjectID objectID;
+    AwaObjectInstanceID objectInstanceID;
+    unsigned int i;
+
+    if (clientListResponse == NULL || registeredObjects == NULL)
+    {
+        LOG(LOG_ERR, "Null arguments to %s()", __func__);
+        return false;
+    }
+
+    registeredObjects->numObjects = 0;
+    objectIterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(clientListResponse);
+    if (objectIterator == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create registered entity iterator");
+        return false;
+    }
+
     while (AwaRegisteredEntityIterator_Next(objectIterator))
     {
-        const char *path = AwaRegisteredEntityIterator_GetPath(objectIterator);
-        AwaObjectID objectID = AWA_INVALID_ID;
-        AwaObjectInstanceID objectInstanceID = AWA_INVALID_ID;
-        AwaServerSession_PathToIDs(session, path, &objectID, &objectInstanceID, NULL);
-        if (objectID == Lwm2mObjectId_FlowAccess && objectInstanceID == 0)
+        if (!ParseRegisteredPath(AwaRegisteredEntityIterator_GetPath(objectIterator), &objectID, &objectInstanceID))
         {
-            LOG(LOG_DBG, "Flow Access Instance Found");
-            found = true;
-            break;
+            continue;
+        }
+
+        // Instances of an object are registered next to each other, so look from the last one.
+        for (i = registeredObjects->numObjects; i > 0; i--)
+        {
+            if (registeredObjects->objects[i - 1].objectID == objectID)
+            {
+                break;
+            }
+        }
+        if (i == 0)
+        {
+            if (registeredObjects->numObjects == MAX_REGISTERED_OBJECTS)
+            {
+                LOG(LOG_WARN, "More than %d objects registered, ignoring object %d", MAX_REGISTERED_OBJECTS, objectID);
+                continue;
+            }
+            i = ++registeredObjects->numObjects;
+            registeredObjects->objects[i - 1].objectID = objectID;
+            registeredObjects->objects[i - 1].instances = 0;
+        }
+        if (objectInstanceID != AWA_INVALID_ID && objectInstanceID < 64)
+        {
+            registeredObjects->objects[i - 1].instances |= (uint64_t)1 << objectInstanceID;
         }
     }
     AwaRegisteredEntityIterator_Free(&objectIterator);
-    return found;
+    return true;
 }
 
-/**
- * @brief Check if flow object instance is registered or not.
- * @param[in] session Holds server session.
- * @param[in] clientListResponse List of responses from client.
- * @return true if flow object instance found, else false.
- */
-bool IsFlowObjectInstanceRegistered(const AwaServerSession *session, const AwaServerListClientsResponse *clientListResponse)
+bool IsObjectInstanceRegistered(const RegisteredObjects *registeredObjects, AwaObjectID objectID,
+    AwaObjectInstanceID objectInstanceID)
 {
-    bool found = false;
-    AwaRegisteredEntityIterator *objectIterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(clientListResponse);
-    while (AwaRegisteredEntityIterator_Next(objectIterator))
+    unsigned int i;
+
+    for (i = 0; i < registeredObjects->numObjects; i++)
     {
-        const char *path = AwaRegisteredEntityIterator_GetPath(objectIterator);
-        AwaObjectID objectID = AWA_INVALID_ID;
-        AwaObjectInstanceID objectInstanceID = AWA_INVALID_ID;
-        AwaServerSession_PathToIDs(session, path, &objectID, &objectInstanceID, NULL);
-        if (objectID == Lwm2mObjectId_FlowObject && objectInstanceID == 0)
+        if (registeredObjects->objects[i].objectID == objectID)
         {
-            LOG(LOG_DBG, "Flow Object Instance Found");
-            found = true;
-            break;
+            return objectInstanceID < 64 && (registeredObjects->objects[i].instances & ((uint64_t)1 << objectInstanceID));
         }
     }
-    AwaRegisteredEntityIterator_Free(&objectIterator);
-    return found;
+    return false;
+}
+
+/**
+ * @brief Fill a device's status from a performed list clients operation.
+ * @param[in] clientListOperation Performed list clients operation.
+ * @param[in] clientID Holds ID of registered client.
+ * @param[out] deviceStatus Pointer to structure holding device status information.
+ */
+static void FillDeviceStatus(const AwaServerListClientsOperation *clientListOperation, const char *clientID,
+    DeviceStatus *deviceStatus)
+{
+    const AwaServerListClientsResponse *response = AwaServerListClientsOperation_GetResponse(clientListOperation, clientID);
+    RegisteredObjects registeredObjects;
+    deviceStatus->isDevicePresent = (response != NULL);
+    if (deviceStatus->isDevicePresent && GetRegisteredObjects(response, &registeredObjects))
+    {
+        deviceStatus->isFlowAccessInstanceRegistered = IsObjectInstanceRegistered(&registeredObjects,
+            Lwm2mObjectId_FlowAccess, OBJECT_INSTANCE_ID);
+        deviceStatus->isFlowObjectInstanceRegistered = IsObjectInstanceRegistered(&registeredObjects,
+            Lwm2mObjectId_FlowObject, OBJECT_INSTANCE_ID);
+    }
+    else
+    {
+        deviceStatus->isFlowObjectInstanceRegistered = false;
+        deviceStatus->isFlowAccessInstanceRegistered = false;
+    }
 }
 
 /**
@@ -186,9 +327,11 @@ bool IsFlowObjectInstanceRegistered(const AwaServerSession *session, const AwaSe
  * @param[in] session Holds server session.
  * @param[in] clientID Holds ID of registered client.
  * @param[in] deviceStatus Pointer to structure holding device status information.
+ * @param[in] queryTimeout Time to wait for the server in milliseconds.
  * @return true if status is retrieved successfully, else false.
  */
-static bool GetDeviceStatus(const AwaServerSession *session, const char *clientID, DeviceStatus *deviceStatus)
+static bool GetDeviceStatus(const AwaServerSession *session, const char *clientID, DeviceStatus *deviceStatus,
+    int queryTimeout)
 {
     AwaError error = AwaError_Unspecified;
     bool result = true;
@@ -206,93 +349,87 @@ static bool GetDeviceStatus(const AwaServerSession *session, const char *clientI
         return false;
     }
 
-    error = AwaServerListClientsOperation_Perform(clientListOperation, QUERY_TIMEOUT);
+    error = AwaServerListClientsOperation_Perform(clientListOperation, queryTimeout);
     if (error == AwaError_Success)
     {
-        const AwaServerListClientsResponse *response = AwaServerListClientsOperation_GetResponse(clientListOperation, clientID);
-        deviceStatus->isDevicePresent = (response != NULL);
-        if (deviceStatus->isDevicePresent)
-        {
-            deviceStatus->isFlowAccessInstanceRegistered = IsFlowAccessInstanceRegistered(session, response);
-            deviceStatus->isFlowObjectInstanceRegistered = IsFlowObjectInstanceRegistered(session, response);
-        }
-        else
-        {
-            deviceStatus->isFlowObjectInstanceRegistered = false;
-            deviceStatus->isFlowAccessInstanceRegistered = false;
-        }
+        FillDeviceStatus(clientListOperation, clientID, deviceStatus);
     }
     else
     {
         LOG(LOG_ERR, "Failed to perform list clients operation");
+        deviceStatus->isDevicePresent = false;
+        deviceStatus->isFlowObjectInstanceRegistered = false;
+        deviceStatus->isFlowAccessInstanceRegistered = false;
+        result = false;
     }
     AwaServerListClientsOperation_Free(&clientListOperation);
-    return true;
+    return result;
 }
 
 /**
- * @brief Write to the parent ID resource of flow object of constrained device.
- * @param[in] session Holds server session.
- * @param[in] clientID Holds ID of registered client.
- * @param[in] parentID Parent ID to be assigned.
- * @return true if parent ID written successfully, else false.
+ * @brief Get the monotonic time.
+ * @return time in milliseconds.
  */
-static bool WriteParentID (const AwaServerSession *session, const char *clientID, const char *parentID)
+static int64_t GetMonotonicTimeMs(void)
 {
-    unsigned char i, gatewayDeviceID[DEVICE_ID_SIZE];
-    AwaOpaque parentIDOpaque;
-    AwaError error = AwaError_Success;
-    bool result = false;
-    // 3 because two is for hex letters and one for space
-    if (strlen(parentID)/3 != DEVICE_ID_SIZE)
-    {
-        LOG(LOG_ERR, "ParentID is not of %u bytes", DEVICE_ID_SIZE);
-        return false;
-    }
+    struct timespec now;
 
-    AwaServerWriteOperation *writeOp = AwaServerWriteOperation_New(session, AwaWriteMode_Update);
-    if (writeOp != NULL)
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Get the time left until a deadline, capped to a limit.
+ * @param[in] deadline Monotonic time of the deadline in milliseconds.
+ * @param[in] limit Most milliseconds to return.
+ * @return milliseconds left, at most limit, 0 once the deadline has passed.
+ */
+static int GetRemainingMs(int64_t deadline, int limit)
+{
+    int64_t remaining = deadline - GetMonotonicTimeMs();
+
+    if (remaining <= 0)
     {
-        for (i = 0; i < DEVICE_ID_SIZE; i++)
-        {
-            // 3 because two is for hex letters and one for space
-            sscanf(&parentID[i*3], "%02hhX", &gatewayDeviceID[i]);
-        }
-        parentIDOpaque.Data = gatewayDeviceID;
-        parentIDOpaque.Size = sizeof(gatewayDeviceID);
-        error = AwaServerWriteOperation_AddValueAsOpaque(writeOp, pathStore.parentIDPath, parentIDOpaque);
-        if (error == AwaError_Success)
-        {
-            error = AwaServerWriteOperation_Perform(writeOp, clientID, COAP_TIMEOUT);
-            if (error == AwaError_Success)
-            {
-                result = true;
-            }
-            else
-            {
-                LOG(LOG_ERR, "Failed to write parentID\nerror: %s", AwaError_ToString(error));
-            }
-        }
-        AwaServerWriteOperation_Free(&writeOp);
+        return 0;
     }
-    return result;
+    return remaining < limit ? (int)remaining : limit;
 }
 
 /**
- * @brief Write provisioning information e.g. device type, licensee ID and fcap to device.
+ * @brief Write provisioning information e.g. device type, licensee ID, fcap and parent ID to device,
+ *        creating the flow object instance if needed, all in a single write operation.
  * @param[in] session Holds server session.
  * @param[in] clientID Holds ID of registered client.
  * @param[in] fcapCode Pointer to fcap code.
  * @param[in] deviceType Pointer to device type.
  * @param[in] licenseeID Licensee ID.
+ * @param[in] parentID Device ID of the parent gateway, DEVICE_ID_SIZE bytes.
  * @param[in] isFlowObjectInstanceRegistered States if flow object instance is registered or not.
+ * @param[in] deadline Monotonic time in milliseconds by which the write has to be done.
  * @return true if provisioning information is written successfully to device, else false.
  */
 static bool WriteProvisioningInformationToDevice (const AwaServerSession *session,
-    const char *clientID, const char *fcapCode, const char *deviceType, int licenseeID, bool isFlowObjectInstanceRegistered)
+    const char *clientID, const char *fcapCode, const char *deviceType, int licenseeID, const uint8_t *parentID,
+    bool isFlowObjectInstanceRegistered, int64_t deadline)
 {
+    AwaOpaque parentIDOpaque;
     bool result = false;
     AwaError error = AwaError_Success;
+    int timeout = GetRemainingMs(deadline, TOKEN_TIMEOUT);
+
+    // Paced globally and per parent radio, bursts of writes cause retransmission storms on the mesh.
+    if (!RateLimit_AcquireWrite(parentID, DEVICE_ID_SIZE, timeout))
+    {
+        LOG(LOG_ERR, "No write token for %s within %d ms", clientID, timeout);
+        return false;
+    }
+    timeout = GetRemainingMs(deadline, COAP_TIMEOUT);
+    if (timeout == 0)
+    {
+        LOG(LOG_ERR, "No time left to write to %s", clientID);
+        return false;
+    }
+
     AwaServerWriteOperation *writeOp = AwaServerWriteOperation_New(session, AwaWriteMode_Update);
     if (writeOp != NULL)
     {
@@ -312,7 +449,13 @@ static bool WriteProvisioningInformationToDevice (const AwaServerSession *sessio
         }
         if (error == AwaError_Success)
         {
-            error = AwaServerWriteOperation_Perform(writeOp, clientID, COAP_TIMEOUT);
+            parentIDOpaque.Data = (void *)parentID;
+            parentIDOpaque.Size = DEVICE_ID_SIZE;
+            error = AwaServerWriteOperation_AddValueAsOpaque(writeOp, pathStore.parentIDPath, parentIDOpaque);
+        }
+        if (error == AwaError_Success)
+        {
+            error = AwaServerWriteOperation_Perform(writeOp, clientID, timeout);
             if (error == AwaError_Success)
             {
                 result = true;
@@ -332,111 +475,624 @@ static bool WriteProvisioningInformationToDevice (const AwaServerSession *sessio
 }
 
 /**
- * @brief Wait for specified timeout until provisioning is done.
- * @param[in] serverSession Holds server session.
+ * @brief Record that a device of the batch is provisioned, if it is still waiting.
+ * @param[in] batch Batch provisioning.
  * @param[in] clientID Holds ID of registered client.
- * @param[in] timeout Time to wait for provisioning to complete.
- * @return true if provisioning is successful, else false.
  */
-static bool WaitForProvisioning(AwaServerSession *serverSession, const char *clientID, int timeout)
+static void SetDeviceProvisioned(BatchProvisioning *batch, const char *clientID)
 {
-    DeviceStatus deviceStatus;
-    while (timeout-- != 0)
+    unsigned int i;
+
+    for (i = 0; i < batch->numDevices; i++)
     {
-        GetDeviceStatus(serverSession, clientID, &deviceStatus);
-        if (deviceStatus.isFlowAccessInstanceRegistered)
+        if (batch->isWaiting[i] && strcmp(batch->devices[i].clientID, clientID) == 0)
         {
-            return true;
+            LOG(LOG_DBG, "Flow Access Instance registered by %s", clientID);
+            batch->isWaiting[i] = false;
+            batch->numWaiting--;
+            batch->devices[i].status = PROVISION_OK;
+            batch->devices[i].provisionTime = GetMonotonicTimeMs() - batch->start;
+            break;
         }
-        sleep(POLLING_SLEEP_SECONDS);
     }
-    LOG(LOG_ERR, "Failed to provision device");
-    return false;
 }
 
-bool IsConstrainedDeviceProvisioned(const char *clientID)
+/**
+ * @brief Check a registration update for the FlowAccess instance of the clients being provisioned.
+ * @param[in] event Registration update event.
+ * @param[in] context Batch provisioning.
+ */
+static void ProvisioningUpdateCallback(const AwaServerClientUpdateEvent *event, void *context)
 {
+    BatchProvisioning *batch = context;
+    AwaClientIterator *clientIterator;
+    AwaRegisteredEntityIterator *objectIterator;
+    AwaObjectID objectID;
+    AwaObjectInstanceID objectInstanceID;
+
+    clientIterator = AwaServerClientUpdateEvent_NewClientIterator(event);
+    if (clientIterator == NULL)
+    {
+        return;
+    }
+    while (AwaClientIterator_Next(clientIterator))
+    {
+        const char *clientID = AwaClientIterator_GetClientID(clientIterator);
+
+        objectIterator = AwaServerClientUpdateEvent_NewRegisteredEntityIterator(event, clientID);
+        if (objectIterator == NULL)
+        {
+            continue;
+        }
+        while (AwaRegisteredEntityIterator_Next(objectIterator))
+        {
+            if (ParseRegisteredPath(AwaRegisteredEntityIterator_GetPath(objectIterator), &objectID, &objectInstanceID) &&
+                objectID == Lwm2mObjectId_FlowAccess && objectInstanceID == OBJECT_INSTANCE_ID)
+            {
+                SetDeviceProvisioned(batch, clientID);
+                break;
+            }
+        }
+        AwaRegisteredEntityIterator_Free(&objectIterator);
+    }
+    AwaClientIterator_Free(&clientIterator);
+}
+
+/**
+ * @brief Check a notification of the FlowAccess object of a client being provisioned.
+ * @param[in] changeSet Changed paths.
+ * @param[in] context Batch provisioning.
+ */
+static void FlowAccessObserveCallback(const AwaChangeSet *changeSet, void *context)
+{
+    BatchProvisioning *batch = context;
+
+    if (AwaChangeSet_ContainsPath(changeSet, pathStore.flowAccessInstancePath))
+    {
+        SetDeviceProvisioned(batch, AwaChangeSet_GetClientID(changeSet));
+    }
+}
+
+/**
+ * @brief Observe the FlowAccess object of a client. The client may not have registered the object
+ *        yet, in which case registration update events are relied upon.
+ * @param[in] session Holds server session.
+ * @param[in] clientID Holds ID of registered client.
+ * @param[in] batch Batch provisioning to update from notifications.
+ * @return observation to cancel with CancelObservation, or NULL.
+ */
+static AwaServerObservation *ObserveFlowAccess(AwaServerSession *session, const char *clientID,
+    BatchProvisioning *batch)
+{
+    AwaServerObservation *observation;
+    AwaServerObserveOperation *operation;
+    AwaError error = AwaError_Unspecified;
+
+    observation = AwaServerObservation_New(clientID, pathStore.flowAccessObjectPath, FlowAccessObserveCallback, batch);
+    if (observation == NULL)
+    {
+        return NULL;
+    }
+
+    operation = AwaServerObserveOperation_New(session);
+    if (operation != NULL)
+    {
+        if (AwaServerObserveOperation_AddObservation(operation, observation) == AwaError_Success &&
+            (error = AwaServerObserveOperation_Perform(operation, QUERY_TIMEOUT)) == AwaError_Success)
+        {
+            const AwaServerObserveResponse *response = AwaServerObserveOperation_GetResponse(operation, clientID);
+            const AwaPathResult *result = response == NULL ? NULL :
+                AwaServerObserveResponse_GetPathResult(response, pathStore.flowAccessObjectPath);
+            error = result == NULL ? AwaError_Unspecified : AwaPathResult_GetError(result);
+        }
+        AwaServerObserveOperation_Free(&operation);
+    }
+
+    if (error != AwaError_Success)
+    {
+        LOG(LOG_DBG, "Couldn't observe %s of %s, waiting for registration updates", pathStore.flowAccessObjectPath,
+            clientID);
+        AwaServerObservation_Free(&observation);
+    }
+    return observation;
+}
+
+/**
+ * @brief Cancel and free an observation made by ObserveFlowAccess.
+ * @param[in] session Holds server session.
+ * @param[in,out] observation Observation to cancel, may point to NULL.
+ */
+static void CancelObservation(AwaServerSession *session, AwaServerObservation **observation)
+{
+    AwaServerObserveOperation *operation;
+
+    if (*observation == NULL)
+    {
+        return;
+    }
+
+    operation = AwaServerObserveOperation_New(session);
+    if (operation != NULL)
+    {
+        if (AwaServerObserveOperation_AddCancelObservation(operation, *observation) != AwaError_Success ||
+            AwaServerObserveOperation_Perform(operation, QUERY_TIMEOUT) != AwaError_Success)
+        {
+            LOG(LOG_WARN, "Failed to cancel observation of %s", pathStore.flowAccessObjectPath);
+        }
+        AwaServerObserveOperation_Free(&operation);
+    }
+    AwaServerObservation_Free(observation);
+}
+
+/**
+ * @brief Check all waiting devices of the batch with a single list clients operation.
+ * @param[in] session Holds server session.
+ * @param[in] batch Batch provisioning.
+ * @param[in] queryTimeout Time to wait for the poll token and the server together, in milliseconds.
+ * @return true if the server answered, else false.
+ */
+static bool PollWaitingDevices(const AwaServerSession *session, BatchProvisioning *batch, int queryTimeout)
+{
+    AwaServerListClientsOperation *clientListOperation;
     DeviceStatus deviceStatus;
-    if (clientID == NULL)
+    AwaError error;
+    unsigned int i;
+    int64_t start = GetMonotonicTimeMs();
+
+    clientListOperation = AwaServerListClientsOperation_New(session);
+    if (clientListOperation == NULL)
     {
-        LOG(LOG_ERR, "Null arguments to %s()", __func__);
+        LOG(LOG_ERR, "Failed to create new client list operation");
         return false;
     }
 
-    AwaServerSession *serverSession = Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+    if (!RateLimit_AcquirePoll(queryTimeout))
+    {
+        LOG(LOG_DBG, "Client list poll rate limited");
+        AwaServerListClientsOperation_Free(&clientListOperation);
+        return false;
+    }
 
-    if (serverSession == NULL)
+    // The server only gets what is left after waiting for the token.
+    queryTimeout -= GetMonotonicTimeMs() - start;
+    if (queryTimeout <= 0)
     {
-        LOG(LOG_ERR, "Failed to establish session with server");
+        LOG(LOG_DBG, "No time left for the client list poll");
+        AwaServerListClientsOperation_Free(&clientListOperation);
         return false;
     }
-    GetDeviceStatus(serverSession, clientID, &deviceStatus);
-    Server_ReleaseSession(&serverSession);
-    return deviceStatus.isFlowAccessInstanceRegistered;
+
+    error = AwaServerListClientsOperation_Perform(clientListOperation, queryTimeout);
+    if (error == AwaError_Success)
+    {
+        for (i = 0; i < batch->numDevices; i++)
+        {
+            if (batch->isWaiting[i])
+            {
+                FillDeviceStatus(clientListOperation, batch->devices[i].clientID, &deviceStatus);
+                if (deviceStatus.isFlowAccessInstanceRegistered)
+                {
+                    SetDeviceProvisioned(batch, batch->devices[i].clientID);
+                }
+            }
+        }
+    }
+    else
+    {
+        LOG(LOG_ERR, "Failed to perform list clients operation");
+    }
+    AwaServerListClientsOperation_Free(&clientListOperation);
+    return error == AwaError_Success;
 }
 
-ProvisionStatus ProvisionConstrainedDevice(const char *clientID, const char*fcap,
-    const char *deviceType, int licenseeID, const char *parentID, int timeout)
+/**
+ * @brief Wait until all written devices of the batch are provisioned, or its deadline passes.
+ * @param[in] serverSession Holds server session.
+ * @param[in] batch Batch provisioning.
+ */
+static void WaitForProvisioning(AwaServerSession *serverSession, BatchProvisioning *batch)
+{
+    AwaServerObservation *observation = NULL;
+    int64_t now = GetMonotonicTimeMs();
+    int64_t deadline = batch->deadline;
+    int64_t pollInterval = FIRST_POLL_INTERVAL_MS;
+    int64_t nextPoll = now + pollInterval;
+    unsigned int seed = (unsigned int)now;
+
+    AwaServerSession_SetClientUpdateEventCallback(serverSession, ProvisioningUpdateCallback, batch);
+
+    // Observing costs a round trip per device, a batch relies on registration updates instead.
+    if (batch->numDevices == 1 && batch->numWaiting == 1)
+    {
+        observation = ObserveFlowAccess(serverSession, batch->devices[0].clientID, batch);
+    }
+
+    // Events report completion at once, polling only catches an event that was missed.
+    while (batch->numWaiting != 0 && now < deadline)
+    {
+        if (nextPoll > deadline)
+        {
+            nextPoll = deadline;
+        }
+        if (AwaServerSession_Process(serverSession, nextPoll > now ? nextPoll - now : 0) == AwaError_Success)
+        {
+            AwaServerSession_DispatchCallbacks(serverSession);
+        }
+        now = GetMonotonicTimeMs();
+        if (batch->numWaiting != 0 && now >= nextPoll && now < deadline)
+        {
+            // The poll itself mustn't run past the deadline either.
+            PollWaitingDevices(serverSession, batch, GetRemainingMs(deadline, QUERY_TIMEOUT));
+            now = GetMonotonicTimeMs();
+            pollInterval = pollInterval * 2 < MAX_POLL_INTERVAL_MS ? pollInterval * 2 : MAX_POLL_INTERVAL_MS;
+            nextPoll = now + pollInterval - pollInterval / 4 + rand_r(&seed) % (pollInterval / 2 + 1);
+        }
+    }
+
+    CancelObservation(serverSession, &observation);
+    AwaServerSession_SetClientUpdateEventCallback(serverSession, NULL, NULL);
+
+    if (batch->numWaiting != 0)
+    {
+        LOG(LOG_ERR, "Failed to provision %u device(s)", batch->numWaiting);
+    }
+}
+
+static bool IsFlowDefined(const AwaServerSession *session)
+{
+    return AwaServerSession_IsObjectDefined(session, Lwm2mObjectId_FlowObject) &&
+        AwaServerSession_IsObjectDefined(session, Lwm2mObjectId_FlowAccess);
+}
+
+static AwaServerSession *AcquirePooledSession(bool isPoolOnly)
+{
+    return isPoolOnly ? Server_TryAcquireSession() : Server_AcquireSession();
+}
+
+/**
+ * @brief Take a pooled session that knows the flow object definitions, defining them at the server
+ *        if the session misses them. That is decided per session rather than once: after the server
+ *        daemon restarts, the sessions reconnected to it miss the definitions again. A session that
+ *        still misses them, e.g. connected before another session defined them, is reconnected.
+ * @param[in] isPoolOnly true to get NULL rather than a session of its own when the pool is exhausted.
+ * @return a pointer to session with server, or NULL.
+ */
+static AwaServerSession *AcquireFlowSession(bool isPoolOnly)
 {
-    ProvisionStatus result = PROVISION_FAIL;
     OBJECT_T flowObjects[] = {flowObject, flowAccessObject};
+    AwaServerSession *session = AcquirePooledSession(isPoolOnly);
+    unsigned int i;
+    bool isDefined;
+
+    for (i = 0; session != NULL && !IsFlowDefined(session); i++)
+    {
+        pthread_mutex_lock(&defineLock);
+        isDefined = DefineObjectsAtServer(session, flowObjects, ARRAY_SIZE(flowObjects)) && IsFlowDefined(session);
+        pthread_mutex_unlock(&defineLock);
+        if (isDefined)
+        {
+            break;
+        }
+
+        Server_ReturnSession(&session, false);
+        if (i == SERVER_SESSION_POOL_SIZE)
+        {
+            LOG(LOG_ERR, "Failed to register flow objects' definitions at the server");
+            break;
+        }
+        session = AcquirePooledSession(isPoolOnly);
+    }
+    return session;
+}
+
+/**
+ * @brief Write the provisioning information to the devices of a batch, taking the next device to
+ *        write until none are left or the deadline of the batch has passed. Several may run side
+ *        by side, each one on its own session.
+ * @param[in] session Holds server session.
+ * @param[in] batch Batch provisioning.
+ */
+static void WriteDevices(const AwaServerSession *session, BatchProvisioning *batch)
+{
+    unsigned int i;
+    int64_t start;
+    bool isWritten;
+
+    // Devices left unwritten at the deadline stay failed, and are retried from the journal.
+    while (GetRemainingMs(batch->deadline, 1) != 0)
+    {
+        pthread_mutex_lock(&batch->lock);
+        for (i = batch->nextWrite; i < batch->numDevices; i++)
+        {
+            if (batch->statuses[i].isDevicePresent && !batch->statuses[i].isFlowAccessInstanceRegistered)
+            {
+                break;
+            }
+        }
+        batch->nextWrite = i + 1;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (i >= batch->numDevices)
+        {
+            break;
+        }
+
+        start = GetMonotonicTimeMs();
+        isWritten = WriteProvisioningInformationToDevice(session, batch->devices[i].clientID, batch->devices[i].fcap,
+            batch->deviceType, batch->licenseeID, batch->parentID, batch->statuses[i].isFlowObjectInstanceRegistered, batch->deadline);
+        batch->devices[i].writeTime = GetMonotonicTimeMs() - start;
+
+        if (!isWritten)
+        {
+            LOG(LOG_ERR, "Writing of device provisioning information to %s failed", batch->devices[i].clientID);
+            continue;
+        }
+        pthread_mutex_lock(&batch->lock);
+        batch->isWaiting[i] = true;
+        batch->numWaiting++;
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+/**
+ * @brief Write worker of a batch, on the pooled session it was given.
+ * @param[in] arg Write worker.
+ * @return NULL.
+ */
+static void *ProvisioningWriteWorker(void *arg)
+{
+    WriteWorker *worker = arg;
+
+    WriteDevices(worker->session, worker->batch);
+    Server_ReturnSession(&worker->session, true);
+    return NULL;
+}
+
+/**
+ * @brief Get the status of all the devices of a batch with a single list clients operation.
+ * @param[in] session Holds server session.
+ * @param[in] batch Batch provisioning.
+ * @param[out] numToWrite Number of devices present and not provisioned yet.
+ * @return true if status is retrieved successfully, else false.
+ */
+static bool GetBatchStatuses(const AwaServerSession *session, BatchProvisioning *batch, unsigned int *numToWrite)
+{
+    AwaServerListClientsOperation *clientListOperation;
+    AwaError error;
+    unsigned int i;
+    int timeout = GetRemainingMs(batch->deadline, TOKEN_TIMEOUT);
+
+    clientListOperation = AwaServerListClientsOperation_New(session);
+    if (clientListOperation == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create new client list operation");
+        return false;
+    }
+
+    *numToWrite = 0;
+    if (!RateLimit_AcquirePoll(timeout))
+    {
+        LOG(LOG_ERR, "No client list poll token within %d ms", timeout);
+        AwaServerListClientsOperation_Free(&clientListOperation);
+        return false;
+    }
+    timeout = GetRemainingMs(batch->deadline, QUERY_TIMEOUT);
+    if (timeout == 0)
+    {
+        LOG(LOG_ERR, "No time left to list the clients");
+        AwaServerListClientsOperation_Free(&clientListOperation);
+        return false;
+    }
+    error = AwaServerListClientsOperation_Perform(clientListOperation, timeout);
+    if (error == AwaError_Success)
+    {
+        for (i = 0; i < batch->numDevices; i++)
+        {
+            FillDeviceStatus(clientListOperation, batch->devices[i].clientID, &batch->statuses[i]);
+            if (!batch->statuses[i].isDevicePresent)
+            {
+                LOG(LOG_ERR, "Device %s not present", batch->devices[i].clientID);
+            }
+            else if (batch->statuses[i].isFlowAccessInstanceRegistered)
+            {
+                LOG(LOG_INFO, "Device %s already provisioned", batch->devices[i].clientID);
+                batch->devices[i].status = ALREADY_PROVISIONED;
+            }
+            else
+            {
+                (*numToWrite)++;
+            }
+        }
+    }
+    else
+    {
+        LOG(LOG_ERR, "Failed to perform list clients operation");
+    }
+    AwaServerListClientsOperation_Free(&clientListOperation);
+    return error == AwaError_Success;
+}
+
+bool IsConstrainedDeviceProvisioned(const char *clientID, bool *isBusy)
+{
     DeviceStatus deviceStatus;
-    LOG(LOG_INFO, "Provision constrained device:\n"
-        "\n%-11s\t = %s\n%-11s\t = %s\n%-11s\t = %d\n%-11s\t = %s", "Client ID", clientID, "Device Type",
-        deviceType, "Licensee ID", licenseeID, "Parent ID", parentID);
-    if (clientID == NULL || fcap == NULL || parentID == NULL)
+    bool isHealthy;
+    if (clientID == NULL || isBusy == NULL)
     {
         LOG(LOG_ERR, "Null arguments to %s()", __func__);
-        return PROVISION_FAIL;
+        return false;
     }
 
-    AwaServerSession *serverSession = Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+    // A short wait, the caller is told the gateway is busy rather than kept waiting behind a batch.
+    *isBusy = !RateLimit_AcquirePoll(RATE_LIMIT_QUERY_TIMEOUT);
+    if (*isBusy)
+    {
+        LOG(LOG_ERR, "No client list poll token within %d ms", RATE_LIMIT_QUERY_TIMEOUT);
+        return false;
+    }
+
+    AwaServerSession *serverSession = Server_AcquireSession();
+
     if (serverSession == NULL)
     {
         LOG(LOG_ERR, "Failed to establish session with server");
-        return PROVISION_FAIL;
+        return false;
     }
+    isHealthy = GetDeviceStatus(serverSession, clientID, &deviceStatus, QUERY_TIMEOUT);
+    Server_ReturnSession(&serverSession, isHealthy);
+    return deviceStatus.isFlowAccessInstanceRegistered;
+}
 
-    if (!pathsMade)
+bool ProvisionConstrainedDevices(ConstrainedDevice devices[], unsigned int numDevices, const char *deviceType,
+    int licenseeID, const char *parentID, int timeout, unsigned int window)
+{
+    BatchProvisioning batch = {0};
+    AwaServerSession *serverSession;
+    WriteWorker workers[MAX_PROVISIONING_WINDOW];
+    char parentHex[HEX_ENCODED_LENGTH(DEVICE_ID_SIZE, '\0') + 1];
+    unsigned int i, numWorkers = 0, numToWrite = 0;
+    bool result = false;
+
+    // The timeout bounds the whole call, the waits for rate limit tokens and the writes included.
+    batch.start = GetMonotonicTimeMs();
+    batch.deadline = batch.start + (int64_t)timeout * 1000;
+
+    if (devices == NULL || deviceType == NULL)
     {
-        if (!MakePaths())
+        LOG(LOG_ERR, "Null arguments to %s()", __func__);
+        return false;
+    }
+    for (i = 0; i < numDevices; i++)
+    {
+        devices[i].status = PROVISION_FAIL;
+        devices[i].writeTime = -1;
+        devices[i].provisionTime = -1;
+        if (devices[i].clientID == NULL || devices[i].fcap == NULL)
         {
-            LOG(LOG_ERR, "Failed to create paths");
+            LOG(LOG_ERR, "Null arguments to %s()", __func__);
             return false;
         }
-        pathsMade = true;
+    }
+    if (window == 0 || window > MAX_PROVISIONING_WINDOW)
+    {
+        window = window == 0 ? 1 : MAX_PROVISIONING_WINDOW;
     }
 
-    if (DefineObjectsAtServer(serverSession, flowObjects, ARRAY_SIZE(flowObjects)))
+    // Decoded once for the batch, and checked before anything is sent to the devices.
+    if (parentID == NULL)
     {
-        GetDeviceStatus(serverSession, clientID, &deviceStatus);
-        if (!deviceStatus.isDevicePresent)
+        if (!GetGatewayDeviceID(batch.parentID, sizeof(batch.parentID)))
         {
-            LOG(LOG_ERR, "Device not present");
-        }
-        else if (deviceStatus.isFlowAccessInstanceRegistered)
-        {
-            LOG(LOG_INFO, "Device already provisioned");
-            result = ALREADY_PROVISIONED;
+            LOG(LOG_ERR, "No parent ID given and the gateway DeviceID isn't known");
+            return false;
         }
-        else
+    }
+    else if (Hex_Decode(batch.parentID, sizeof(batch.parentID), parentID) != DEVICE_ID_SIZE)
+    {
+        LOG(LOG_ERR, "ParentID is not %u hex encoded bytes", DEVICE_ID_SIZE);
+        return false;
+    }
+
+    pthread_once(&pathsOnce, MakePathsOnce);
+    if (!pathsMade)
+    {
+        LOG(LOG_ERR, "Failed to create paths");
+        return false;
+    }
+
+    batch.devices = devices;
+    batch.numDevices = numDevices;
+    batch.deviceType = deviceType;
+    batch.licenseeID = licenseeID;
+    batch.statuses = calloc(numDevices, sizeof(DeviceStatus));
+    batch.isWaiting = calloc(numDevices, sizeof(bool));
+    if (numDevices != 0 && (batch.statuses == NULL || batch.isWaiting == NULL))
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for batch provisioning");
+        free(batch.statuses);
+        free(batch.isWaiting);
+        return false;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+
+    serverSession = AcquireFlowSession(false);
+    if (serverSession == NULL)
+    {
+        LOG(LOG_ERR, "Failed to establish session with server");
+    }
+    else if (!GetBatchStatuses(serverSession, &batch, &numToWrite))
+    {
+        Server_ReturnSession(&serverSession, false);
+    }
+    else
+    {
+        // A single device is written on this session, a batch by up to window workers side by side.
+        // There are only as many workers as the pool has sessions to spare.
+        if (numToWrite > 1 && window > 1)
         {
-            if (!WriteProvisioningInformationToDevice(serverSession, clientID, fcap, deviceType, licenseeID, deviceStatus.isFlowObjectInstanceRegistered) ||
-                !WriteParentID(serverSession, clientID, parentID))
+            for (i = 0; i < window && i < numToWrite; i++)
             {
-                LOG(LOG_ERR, "Writing of device provisioning information failed");
+                workers[numWorkers].batch = &batch;
+                workers[numWorkers].session = AcquireFlowSession(true);
+                if (workers[numWorkers].session == NULL)
+                {
+                    LOG(LOG_DBG, "Window capped to %u workers by the server session pool", numWorkers);
+                    break;
+                }
+                if (pthread_create(&workers[numWorkers].thread, NULL, ProvisioningWriteWorker,
+                    &workers[numWorkers]) == 0)
+                {
+                    numWorkers++;
+                }
+                else
+                {
+                    Server_ReturnSession(&workers[numWorkers].session, true);
+                }
             }
-            else if (WaitForProvisioning(serverSession, clientID, timeout))
+            for (i = 0; i < numWorkers; i++)
             {
-                result = PROVISION_OK;
+                pthread_join(workers[i].thread, NULL);
             }
         }
+        if (numWorkers == 0)
+        {
+            WriteDevices(serverSession, &batch);
+        }
+
+        WaitForProvisioning(serverSession, &batch);
+        Server_ReturnSession(&serverSession, true);
+        result = true;
     }
-    else
+
+    // Failures are retried in the background, also when the server couldn't be reached. The retry
+    // keeps the parent resolved now, even if another gateway instance is selected meanwhile.
+    parentHex[Hex_Encode(parentHex, batch.parentID, DEVICE_ID_SIZE, '\0')] = '\0';
+    for (i = 0; i < numDevices; i++)
     {
-        LOG(LOG_ERR, "Failed to register flow objects' definitions at the server");
+        if (devices[i].status == PROVISION_FAIL)
+        {
+            ProvisionJournal_RecordFailure(devices[i].clientID, devices[i].fcap, deviceType, licenseeID, parentHex);
+        }
+        else
+        {
+            ProvisionJournal_RecordSuccess(devices[i].clientID);
+        }
     }
-    Server_ReleaseSession(&serverSession);
-    LOG(LOG_INFO, "status = %d", result);
+
+    pthread_mutex_destroy(&batch.lock);
+    free(batch.statuses);
+    free(batch.isWaiting);
     return result;
 }
+
+ProvisionStatus ProvisionConstrainedDevice(const char *clientID, const char*fcap,
+    const char *deviceType, int licenseeID, const char *parentID, int timeout)
+{
+    ConstrainedDevice device = {.clientID = clientID, .fcap = fcap};
+    LOG(LOG_INFO, "Provision constrained device:\n"
+        "\n%-11s\t = %s\n%-11s\t = %s\n%-11s\t = %d\n%-11s\t = %s", "Client ID", clientID, "Device Type",
+        deviceType, "Licensee ID", licenseeID, "Parent ID", parentID != NULL ? parentID : "gateway DeviceID");
+
+    ProvisionConstrainedDevices(&device, 1, deviceType, licenseeID, parentID, timeout, 1);
+    LOG(LOG_INFO, "status = %d", device.status);
+    return device.status;
+}
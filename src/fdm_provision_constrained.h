@@ -50,7 +50,8 @@
  * @param[in] deviceType registered device type
  * @param[in] licenseeID Licensee ID.
  * @param[in] parentID Device ID of Gateway device.
- * @param[in] timeout time to wait for notification to arrive.
+ * @param[in] timeout seconds to wait for the device to complete provisioning once the provisioning
+ *            information is written.
  * @return 0 for PROVISION_OK
            1 for PROVISION_FAIL
            2 for ALREADY_PROVISIONED
@@ -67,4 +68,34 @@ ProvisionStatus ProvisionConstrainedDevice(const char *clientID, const char *fca
  */
 bool IsDeviceProvisioned(const AwaServerSession *session, const char *clientID);
 
+/**
+ * @brief Parse a registered path, "/<object>" or "/<object>/<instance>", without looking it up
+ *        in the session's object definitions.
+ * @param[in] path Registered path.
+ * @param[out] objectID Object ID.
+ * @param[out] objectInstanceID Instance ID, AWA_INVALID_ID if the path is an object.
+ * @return true if path is an object or object instance path, else false.
+ */
+bool ParseRegisteredPath(const char *path, AwaObjectID *objectID, AwaObjectInstanceID *objectInstanceID);
+
+/**
+ * @brief Gather the objects and instances registered by a client in one pass over its registered
+ *        paths, for checking single instances. Only the first MAX_REGISTERED_OBJECTS objects and
+ *        instances 0 to 63 are kept.
+ * @param[in] clientListResponse Response of the client from a list clients operation.
+ * @param[out] registeredObjects Registered objects of the client.
+ * @return true if registered objects are retrieved successfully, else false.
+ */
+bool GetRegisteredObjects(const AwaServerListClientsResponse *clientListResponse, RegisteredObjects *registeredObjects);
+
+/**
+ * @brief Check if an object instance is among the registered objects of a client.
+ * @param[in] registeredObjects Registered objects from GetRegisteredObjects.
+ * @param[in] objectID Object ID.
+ * @param[in] objectInstanceID Object instance ID.
+ * @return true if object instance is registered, else false.
+ */
+bool IsObjectInstanceRegistered(const RegisteredObjects *registeredObjects, AwaObjectID objectID,
+    AwaObjectInstanceID objectInstanceID);
+
 #endif  /* FDM_PROVISION_CONSTRAINED_H */
@@ -0,0 +1,609 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_provision_journal.c
+ * @brief Journals failed constrained device provisionings to an append-only file and retries them
+ *        in the background.
+ *
+ * Each failure appends one record, "attempts licensee client fcap device-type parent" separated by
+ * tabs, with the parent as compact hex. The last record of a client wins, so replaying the file on
+ * start restores the pending retries. Successes and spent retry budgets rewrite the file with the
+ * remaining clients only.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "device_manager.h"
+#include "fdm_provision_journal.h"
+#include "fdm_file_writer.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_JOURNAL_ENTRIES     (256)
+#define MAX_RETRY_ATTEMPTS      (10)
+#define FIRST_RETRY_INTERVAL_MS (60 * 1000)
+#define MAX_RETRY_INTERVAL_MS   (60 * 60 * 1000)
+#define JOURNAL_FIELD_COUNT     (6)
+#define FILE_MODE               (0666)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A constrained device waiting to be provisioned again.
+ */
+typedef struct
+{
+    //! \{
+    char *clientID;
+    char *fcap;
+    char *deviceType;
+    char *parentID;
+    int licenseeID;
+    unsigned int attempts;
+    int64_t nextRetry;
+    //! \}
+} JournalEntry;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static pthread_mutex_t journalLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journalChanged;
+static pthread_t retryThread;
+static bool isRunning = false;
+static char *journalPath = NULL;
+static JournalEntry entries[MAX_JOURNAL_ENTRIES];
+static unsigned int numEntries = 0;
+static unsigned int retrySeed;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static int64_t GetMonotonicTimeMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static JournalEntry *FindEntry(const char *clientID)
+{
+    unsigned int i;
+
+    for (i = 0; i < numEntries; i++)
+    {
+        if (strcmp(entries[i].clientID, clientID) == 0)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void FreeEntry(JournalEntry *entry)
+{
+    free(entry->clientID);
+    free(entry->fcap);
+    free(entry->deviceType);
+    free(entry->parentID);
+}
+
+static void RemoveEntry(JournalEntry *entry)
+{
+    FreeEntry(entry);
+    *entry = entries[--numEntries];
+}
+//! \}
+
+/**
+ * @brief Schedule the next retry of an entry, doubling the delay with every attempt. The delay is
+ *        jittered so that devices that failed together are retried apart.
+ * @param[in] entry Journal entry.
+ */
+static void ScheduleRetry(JournalEntry *entry)
+{
+    int64_t interval = FIRST_RETRY_INTERVAL_MS;
+    unsigned int i;
+
+    for (i = 1; i < entry->attempts && interval < MAX_RETRY_INTERVAL_MS; i++)
+    {
+        interval *= 2;
+    }
+    if (interval > MAX_RETRY_INTERVAL_MS)
+    {
+        interval = MAX_RETRY_INTERVAL_MS;
+    }
+    entry->nextRetry = GetMonotonicTimeMs() + interval - interval / 4 + rand_r(&retrySeed) % (interval / 2 + 1);
+}
+
+/**
+ * @brief Format the journal record of an entry.
+ * @param[in] entry Journal entry.
+ * @param[out] buffer Buffer for the record, or NULL to measure it.
+ * @param[in] size Size of buffer.
+ * @return length of the record, without the terminating null.
+ */
+static int FormatRecord(const JournalEntry *entry, char *buffer, size_t size)
+{
+    return snprintf(buffer, size, "%u\t%d\t%s\t%s\t%s\t%s\n", entry->attempts, entry->licenseeID,
+        entry->clientID, entry->fcap, entry->deviceType, entry->parentID);
+}
+
+/**
+ * @brief Append the record of an entry to the journal file, with a single synced write.
+ * @param[in] entry Journal entry.
+ * @return true for success otherwise false.
+ */
+static bool AppendRecord(const JournalEntry *entry)
+{
+    int length = FormatRecord(entry, NULL, 0);
+    char *record = malloc(length + 1);
+    bool result = false;
+    ssize_t written;
+    int fd;
+
+    if (record == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for journal record");
+        return false;
+    }
+    FormatRecord(entry, record, length + 1);
+
+    if ((fd = open(journalPath, O_WRONLY | O_APPEND | O_CREAT, FILE_MODE)) >= 0)
+    {
+        do
+        {
+            written = write(fd, record, length);
+        } while (written < 0 && errno == EINTR);
+        result = written == length && fdatasync(fd) == 0;
+        close(fd);
+    }
+    if (!result)
+    {
+        LOG(LOG_ERR, "Failed to append to %s", journalPath);
+    }
+    free(record);
+    return result;
+}
+
+/**
+ * @brief Rewrite the journal file with one record per remaining entry.
+ */
+static void CompactJournal(void)
+{
+    size_t length = 0;
+    char *content;
+    unsigned int i;
+
+    for (i = 0; i < numEntries; i++)
+    {
+        length += FormatRecord(&entries[i], NULL, 0);
+    }
+    content = malloc(length + 1);
+    if (content == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for compacting %s", journalPath);
+        return;
+    }
+
+    length = 0;
+    for (i = 0; i < numEntries; i++)
+    {
+        length += FormatRecord(&entries[i], content + length, FormatRecord(&entries[i], NULL, 0) + 1);
+    }
+
+    // Appends go to the file by path, so they must not slip in before the rename.
+    if (FileWriter_SaveAsync(journalPath, content, length))
+    {
+        FileWriter_Flush();
+    }
+}
+
+/**
+ * @brief Check that a value can be stored in a tab separated record.
+ * @param[in] value Value.
+ * @return true if the value is storable, else false.
+ */
+static bool IsStorable(const char *value)
+{
+    return value != NULL && value[0] != '\0' && strpbrk(value, "\t\n") == NULL;
+}
+
+/**
+ * @brief Fill an entry, copying its values.
+ * @param[out] entry Journal entry.
+ * @param[in] clientID Client ID of the device.
+ * @param[in] fcap FCAP code.
+ * @param[in] deviceType registered device type.
+ * @param[in] licenseeID Licensee ID.
+ * @param[in] parentID Device ID of Gateway device.
+ * @return true for success otherwise false, in which case nothing is allocated.
+ */
+static bool FillEntry(JournalEntry *entry, const char *clientID, const char *fcap, const char *deviceType,
+    int licenseeID, const char *parentID)
+{
+    entry->clientID = strdup(clientID);
+    entry->fcap = strdup(fcap);
+    entry->deviceType = strdup(deviceType);
+    entry->parentID = strdup(parentID);
+    entry->licenseeID = licenseeID;
+    if (entry->clientID == NULL || entry->fcap == NULL || entry->deviceType == NULL || entry->parentID == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate memory for journal entry");
+        FreeEntry(entry);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Replay one journal record, replacing an earlier record of the same client.
+ * @param[in] record Null terminated record, without the newline. It is split in place.
+ * @return true if the record is valid, else false.
+ */
+static bool ReplayRecord(char *record)
+{
+    char *fields[JOURNAL_FIELD_COUNT];
+    JournalEntry *entry;
+    unsigned int i;
+    char *end;
+    long attempts, licenseeID;
+
+    for (i = 0; i < JOURNAL_FIELD_COUNT; i++)
+    {
+        fields[i] = strsep(&record, "\t");
+        if (fields[i] == NULL || fields[i][0] == '\0')
+        {
+            return false;
+        }
+    }
+    attempts = strtol(fields[0], &end, 10);
+    if (record != NULL || *end != '\0' || attempts <= 0)
+    {
+        return false;
+    }
+    licenseeID = strtol(fields[1], &end, 10);
+    if (*end != '\0')
+    {
+        return false;
+    }
+
+    entry = FindEntry(fields[2]);
+    if (entry != NULL)
+    {
+        RemoveEntry(entry);
+    }
+    if (attempts >= MAX_RETRY_ATTEMPTS || numEntries == MAX_JOURNAL_ENTRIES)
+    {
+        return true;
+    }
+    entry = &entries[numEntries];
+    if (FillEntry(entry, fields[2], fields[3], fields[4], licenseeID, fields[5]))
+    {
+        entry->attempts = attempts;
+        ScheduleRetry(entry);
+        numEntries++;
+    }
+    return true;
+}
+
+/**
+ * @brief Load the journal file, compacting it if it holds superseded records.
+ * @return true for success otherwise false.
+ */
+static bool LoadJournal(void)
+{
+    FILE *file;
+    char *line = NULL;
+    size_t lineSize = 0;
+    ssize_t length;
+    unsigned int numRecords = 0;
+
+    file = fopen(journalPath, "r");
+    if (file == NULL)
+    {
+        return errno == ENOENT;
+    }
+
+    while ((length = getline(&line, &lineSize, file)) > 0)
+    {
+        numRecords++;
+        // A record without its newline was cut short by a crash and is dropped.
+        if (line[length - 1] != '\n')
+        {
+            break;
+        }
+        line[length - 1] = '\0';
+        if (!ReplayRecord(line))
+        {
+            LOG(LOG_WARN, "Skipping invalid record in %s", journalPath);
+        }
+    }
+    free(line);
+    fclose(file);
+
+    if (numRecords != numEntries)
+    {
+        CompactJournal();
+    }
+    if (numEntries != 0)
+    {
+        LOG(LOG_INFO, "%u constrained device provisioning(s) to retry", numEntries);
+    }
+    return true;
+}
+
+/**
+ * @brief Retry journaled provisionings as they fall due, one device at a time. The outcome is
+ *        journaled by ProvisionConstrainedDevices() like any other provisioning.
+ * @param[in] arg Unused.
+ * @return NULL.
+ */
+static void *RetryWorker(void *arg)
+{
+    ConstrainedDevice device;
+    JournalEntry retry;
+    JournalEntry *due;
+    struct timespec wakeUp;
+    unsigned int i;
+    int64_t now;
+
+    (void)arg;
+    pthread_mutex_lock(&journalLock);
+    while (isRunning)
+    {
+        due = NULL;
+        for (i = 0; i < numEntries; i++)
+        {
+            if (due == NULL || entries[i].nextRetry < due->nextRetry)
+            {
+                due = &entries[i];
+            }
+        }
+
+        now = GetMonotonicTimeMs();
+        if (due == NULL)
+        {
+            pthread_cond_wait(&journalChanged, &journalLock);
+        }
+        else if (due->nextRetry > now)
+        {
+            wakeUp.tv_sec = due->nextRetry / 1000;
+            wakeUp.tv_nsec = (due->nextRetry % 1000) * 1000000;
+            pthread_cond_timedwait(&journalChanged, &journalLock, &wakeUp);
+        }
+        else if (FillEntry(&retry, due->clientID, due->fcap, due->deviceType, due->licenseeID, due->parentID))
+        {
+            // Pushed back in case the outcome isn't journaled, e.g. the server couldn't be reached.
+            ScheduleRetry(due);
+            pthread_mutex_unlock(&journalLock);
+
+            LOG(LOG_INFO, "Retrying provisioning of %s", retry.clientID);
+            device.clientID = retry.clientID;
+            device.fcap = retry.fcap;
+            ProvisionConstrainedDevices(&device, 1, retry.deviceType, retry.licenseeID, retry.parentID,
+                DEFAULT_PROVSIONING_TIMEOUT, 1);
+            FreeEntry(&retry);
+
+            pthread_mutex_lock(&journalLock);
+        }
+        else
+        {
+            ScheduleRetry(due);
+        }
+    }
+    pthread_mutex_unlock(&journalLock);
+    return NULL;
+}
+
+bool ProvisionJournal_Start(const char *path)
+{
+    pthread_condattr_t conditionAttributes;
+
+    if (path == NULL)
+    {
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        return false;
+    }
+
+    pthread_mutex_lock(&journalLock);
+    if (isRunning)
+    {
+        pthread_mutex_unlock(&journalLock);
+        return true;
+    }
+
+    journalPath = strdup(path);
+    retrySeed = (unsigned int)GetMonotonicTimeMs();
+    if (journalPath == NULL || !LoadJournal())
+    {
+        LOG(LOG_ERR, "Failed to load provisioning journal %s", path);
+        free(journalPath);
+        journalPath = NULL;
+        pthread_mutex_unlock(&journalLock);
+        return false;
+    }
+
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&journalChanged, &conditionAttributes);
+    pthread_condattr_destroy(&conditionAttributes);
+
+    isRunning = true;
+    if (pthread_create(&retryThread, NULL, RetryWorker, NULL) != 0)
+    {
+        LOG(LOG_ERR, "Failed to start provisioning retry thread");
+        isRunning = false;
+        pthread_cond_destroy(&journalChanged);
+    }
+    pthread_mutex_unlock(&journalLock);
+    return isRunning;
+}
+
+void ProvisionJournal_RecordFailure(const char *clientID, const char *fcap, const char *deviceType,
+    int licenseeID, const char *parentID)
+{
+    JournalEntry *entry;
+
+    if (!IsStorable(clientID) || !IsStorable(fcap) || !IsStorable(deviceType) || !IsStorable(parentID))
+    {
+        LOG(LOG_WARN, "Provisioning of %s can't be journaled for retry", clientID);
+        return;
+    }
+
+    pthread_mutex_lock(&journalLock);
+    if (!isRunning)
+    {
+        pthread_mutex_unlock(&journalLock);
+        return;
+    }
+
+    entry = FindEntry(clientID);
+    if (entry == NULL)
+    {
+        if (numEntries == MAX_JOURNAL_ENTRIES)
+        {
+            LOG(LOG_WARN, "Provisioning journal full, not retrying %s", clientID);
+            pthread_mutex_unlock(&journalLock);
+            return;
+        }
+        entry = &entries[numEntries];
+        if (!FillEntry(entry, clientID, fcap, deviceType, licenseeID, parentID))
+        {
+            pthread_mutex_unlock(&journalLock);
+            return;
+        }
+        entry->attempts = 0;
+        numEntries++;
+    }
+    else if (strcmp(entry->fcap, fcap) != 0 || strcmp(entry->deviceType, deviceType) != 0 ||
+        strcmp(entry->parentID, parentID) != 0 || entry->licenseeID != licenseeID)
+    {
+        // A newer request for the same device replaces the journaled one.
+        unsigned int attempts = entry->attempts;
+        JournalEntry replacement;
+
+        if (FillEntry(&replacement, clientID, fcap, deviceType, licenseeID, parentID))
+        {
+            FreeEntry(entry);
+            *entry = replacement;
+        }
+        entry->attempts = attempts;
+    }
+
+    entry->attempts++;
+    if (entry->attempts >= MAX_RETRY_ATTEMPTS)
+    {
+        LOG(LOG_ERR, "Giving up provisioning %s after %u attempts", clientID, entry->attempts);
+        RemoveEntry(entry);
+        CompactJournal();
+    }
+    else
+    {
+        LOG(LOG_INFO, "Provisioning of %s failed, attempt %u of %u", clientID, entry->attempts,
+            MAX_RETRY_ATTEMPTS);
+        ScheduleRetry(entry);
+        AppendRecord(entry);
+        pthread_cond_signal(&journalChanged);
+    }
+    pthread_mutex_unlock(&journalLock);
+}
+
+void ProvisionJournal_RecordSuccess(const char *clientID)
+{
+    JournalEntry *entry;
+
+    if (clientID == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&journalLock);
+    if (isRunning && (entry = FindEntry(clientID)) != NULL)
+    {
+        LOG(LOG_INFO, "%s provisioned after %u failed attempt(s)", clientID, entry->attempts);
+        RemoveEntry(entry);
+        CompactJournal();
+        pthread_cond_signal(&journalChanged);
+    }
+    pthread_mutex_unlock(&journalLock);
+}
+
+void ProvisionJournal_Stop(void)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&journalLock);
+    if (!isRunning)
+    {
+        pthread_mutex_unlock(&journalLock);
+        return;
+    }
+    isRunning = false;
+    pthread_cond_signal(&journalChanged);
+    pthread_mutex_unlock(&journalLock);
+
+    pthread_join(retryThread, NULL);
+    pthread_cond_destroy(&journalChanged);
+
+    for (i = 0; i < numEntries; i++)
+    {
+        FreeEntry(&entries[i]);
+    }
+    numEntries = 0;
+    free(journalPath);
+    journalPath = NULL;
+}
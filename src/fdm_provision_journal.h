@@ -0,0 +1,80 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_provision_journal.h
+ * @brief Header file for exposing the journal of failed constrained device provisionings, which
+ *        are retried in the background.
+ */
+
+#ifndef FDM_PROVISION_JOURNAL_H
+#define FDM_PROVISION_JOURNAL_H
+
+#include <stdbool.h>
+
+//! \{
+#define PROVISION_JOURNAL_FILE  "/etc/lwm2m/provision_retry.journal"
+//! \}
+
+/**
+ * @brief Load the journal, left by an earlier run if any, and start retrying the provisionings
+ *        it holds. Until started, failures are not journaled.
+ * @param[in] path Path of the journal file.
+ * @return true for success otherwise false.
+ */
+bool ProvisionJournal_Start(const char *path);
+
+/**
+ * @brief Journal a failed provisioning of a constrained device, to be retried with a growing
+ *        delay until it succeeds or its retry budget is spent.
+ * @param[in] clientID Client ID of the device.
+ * @param[in] fcap FCAP code.
+ * @param[in] deviceType registered device type.
+ * @param[in] licenseeID Licensee ID.
+ * @param[in] parentID Device ID of Gateway device, hex encoded.
+ */
+void ProvisionJournal_RecordFailure(const char *clientID, const char *fcap, const char *deviceType,
+    int licenseeID, const char *parentID);
+
+/**
+ * @brief Drop a constrained device from the journal once it is provisioned, compacting the
+ *        journal file.
+ * @param[in] clientID Client ID of the device.
+ */
+void ProvisionJournal_RecordSuccess(const char *clientID);
+
+/**
+ * @brief Stop retrying, waiting for a retry in progress. Journaled provisionings are kept in the
+ *        journal file for the next run.
+ */
+void ProvisionJournal_Stop(void);
+
+#endif  /* FDM_PROVISION_JOURNAL_H */
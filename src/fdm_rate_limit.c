@@ -0,0 +1,342 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_rate_limit.c
+ * @brief Token buckets pacing writes, globally and per parent gateway, and client list polls, so
+ *        that bulk provisioning doesn't flood the low-bandwidth mesh.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "fdm_rate_limit.h"
+#include "fdm_common.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_PARENT_BUCKETS  (16)
+#define MS_PER_MINUTE       (60 * 1000)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * Tokens left in a bucket, as of its last refill.
+ */
+typedef struct
+{
+    //! \{
+    double tokens;
+    int64_t lastRefill;
+    //! \}
+} TokenBucket;
+
+/**
+ * Write bucket of a parent gateway.
+ */
+typedef struct
+{
+    //! \{
+    uint8_t parentID[DEVICE_ID_SIZE];
+    size_t parentIDSize;
+    TokenBucket bucket;
+    int64_t lastUsed;
+    //! \}
+} ParentBucket;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static pthread_mutex_t limitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tokensChanged;
+static bool isInitialised = false;
+static RateLimitConfig limits;
+static TokenBucket writeBucket;
+static TokenBucket pollBucket;
+static ParentBucket parentBuckets[MAX_PARENT_BUCKETS];
+static unsigned int numParentBuckets = 0;
+static RateLimitStats writeUsage;
+static RateLimitStats pollUsage;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static int64_t GetMonotonicTimeMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void Initialise(void)
+{
+    pthread_condattr_t conditionAttributes;
+
+    if (!isInitialised)
+    {
+        pthread_condattr_init(&conditionAttributes);
+        pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+        pthread_cond_init(&tokensChanged, &conditionAttributes);
+        pthread_condattr_destroy(&conditionAttributes);
+        isInitialised = true;
+    }
+}
+
+static unsigned int GetBurst(unsigned int burst)
+{
+    return burst == 0 ? 1 : burst;
+}
+//! \}
+
+/**
+ * @brief Add the tokens earned since the last refill, up to the burst.
+ * @param[in,out] bucket Token bucket.
+ * @param[in] perMinute Rate of the bucket, 0 if unlimited.
+ * @param[in] burst Burst of the bucket.
+ * @param[in] now Current monotonic time in milliseconds.
+ */
+static void Refill(TokenBucket *bucket, unsigned int perMinute, unsigned int burst, int64_t now)
+{
+    bucket->tokens += (double)(now - bucket->lastRefill) * perMinute / MS_PER_MINUTE;
+    // Kept full while unlimited, so that setting a rate starts with a whole burst.
+    if (perMinute == 0 || bucket->tokens > GetBurst(burst))
+    {
+        bucket->tokens = GetBurst(burst);
+    }
+    bucket->lastRefill = now;
+}
+
+/**
+ * @brief Get the time until a bucket holds a whole token.
+ * @param[in] bucket Token bucket, just refilled.
+ * @param[in] perMinute Rate of the bucket, 0 if unlimited.
+ * @return milliseconds to wait, 0 if a token is available.
+ */
+static int64_t GetWaitMs(const TokenBucket *bucket, unsigned int perMinute)
+{
+    if (perMinute == 0 || bucket->tokens >= 1)
+    {
+        return 0;
+    }
+    return (int64_t)((1 - bucket->tokens) * MS_PER_MINUTE / perMinute) + 1;
+}
+
+/**
+ * @brief Find the write bucket of a parent gateway, replacing the least recently used bucket if
+ *        there's no room for a new parent. A new bucket starts full.
+ * @param[in] parentID Device ID of the parent gateway.
+ * @param[in] parentIDSize Size of parentID, at most DEVICE_ID_SIZE.
+ * @param[in] now Current monotonic time in milliseconds.
+ * @return bucket of the parent.
+ */
+static TokenBucket *GetParentBucket(const uint8_t *parentID, size_t parentIDSize, int64_t now)
+{
+    ParentBucket *parent = NULL;
+    unsigned int i;
+
+    for (i = 0; i < numParentBuckets; i++)
+    {
+        if (parentBuckets[i].parentIDSize == parentIDSize &&
+            memcmp(parentBuckets[i].parentID, parentID, parentIDSize) == 0)
+        {
+            parent = &parentBuckets[i];
+            break;
+        }
+        if (parent == NULL || parentBuckets[i].lastUsed < parent->lastUsed)
+        {
+            parent = &parentBuckets[i];
+        }
+    }
+
+    if (i == numParentBuckets)
+    {
+        if (numParentBuckets < MAX_PARENT_BUCKETS)
+        {
+            parent = &parentBuckets[numParentBuckets++];
+        }
+        memcpy(parent->parentID, parentID, parentIDSize);
+        parent->parentIDSize = parentIDSize;
+        parent->bucket.tokens = GetBurst(limits.parentWriteBurst);
+        parent->bucket.lastRefill = now;
+    }
+    parent->lastUsed = now;
+    return &parent->bucket;
+}
+
+/**
+ * @brief Take a token from one or two buckets at once, waiting until both hold one.
+ * @param[in] bucket Token bucket.
+ * @param[in] perMinute Rate of bucket.
+ * @param[in] burst Burst of bucket.
+ * @param[in] parentID Device ID of the parent gateway, or NULL if there's no parent bucket.
+ * @param[in] parentIDSize Size of parentID.
+ * @param[in] timeout Milliseconds to wait at most, or RATE_LIMIT_WAIT_FOREVER.
+ * @param[in,out] usage Usage to update.
+ * @return true if the tokens were taken, false if they weren't available in time.
+ */
+static bool Acquire(TokenBucket *bucket, const unsigned int *perMinute, const unsigned int *burst,
+    const uint8_t *parentID, size_t parentIDSize, int timeout, RateLimitStats *usage)
+{
+    TokenBucket *parentBucket = NULL;
+    struct timespec wakeUp;
+    int64_t start, now, wait, parentWait;
+    bool result = false;
+
+    pthread_mutex_lock(&limitLock);
+    Initialise();
+    start = now = GetMonotonicTimeMs();
+    usage->queueDepth++;
+
+    while (true)
+    {
+        // Rates are read through pointers so that waiters follow RateLimit_Configure().
+        Refill(bucket, *perMinute, *burst, now);
+        wait = GetWaitMs(bucket, *perMinute);
+        if (parentID != NULL)
+        {
+            // Looked up again every time, the bucket may have been handed to another parent.
+            parentBucket = GetParentBucket(parentID, parentIDSize, now);
+            Refill(parentBucket, limits.parentWritesPerMinute, limits.parentWriteBurst, now);
+            parentWait = GetWaitMs(parentBucket, limits.parentWritesPerMinute);
+            wait = parentWait > wait ? parentWait : wait;
+        }
+
+        if (wait == 0)
+        {
+            if (*perMinute != 0)
+            {
+                bucket->tokens -= 1;
+            }
+            if (parentBucket != NULL && limits.parentWritesPerMinute != 0)
+            {
+                parentBucket->tokens -= 1;
+            }
+            result = true;
+            break;
+        }
+        if (timeout != RATE_LIMIT_WAIT_FOREVER && now + wait > start + timeout)
+        {
+            break;
+        }
+
+        wakeUp.tv_sec = (now + wait) / 1000;
+        wakeUp.tv_nsec = ((now + wait) % 1000) * 1000000;
+        pthread_cond_timedwait(&tokensChanged, &limitLock, &wakeUp);
+        now = GetMonotonicTimeMs();
+    }
+
+    usage->queueDepth--;
+    if (result)
+    {
+        usage->numAcquired++;
+        usage->totalWaitMs += now - start;
+        if ((uint64_t)(now - start) > usage->maxWaitMs)
+        {
+            usage->maxWaitMs = now - start;
+        }
+    }
+    else
+    {
+        usage->numTimedOut++;
+    }
+    pthread_mutex_unlock(&limitLock);
+    return result;
+}
+
+void RateLimit_Configure(const RateLimitConfig *config)
+{
+    if (config == NULL)
+    {
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        return;
+    }
+
+    pthread_mutex_lock(&limitLock);
+    Initialise();
+    limits = *config;
+    pthread_cond_broadcast(&tokensChanged);
+    pthread_mutex_unlock(&limitLock);
+}
+
+void RateLimit_GetConfig(RateLimitConfig *config)
+{
+    pthread_mutex_lock(&limitLock);
+    *config = limits;
+    pthread_mutex_unlock(&limitLock);
+}
+
+bool RateLimit_AcquireWrite(const uint8_t *parentID, size_t parentIDSize, int timeout)
+{
+    if (parentID != NULL && parentIDSize > DEVICE_ID_SIZE)
+    {
+        parentIDSize = DEVICE_ID_SIZE;
+    }
+    return Acquire(&writeBucket, &limits.writesPerMinute, &limits.writeBurst, parentID, parentIDSize,
+        timeout, &writeUsage);
+}
+
+bool RateLimit_AcquirePoll(int timeout)
+{
+    return Acquire(&pollBucket, &limits.pollsPerMinute, &limits.pollBurst, NULL, 0, timeout, &pollUsage);
+}
+
+void RateLimit_GetStats(RateLimitStats *writeStats, RateLimitStats *pollStats)
+{
+    pthread_mutex_lock(&limitLock);
+    if (writeStats != NULL)
+    {
+        *writeStats = writeUsage;
+    }
+    if (pollStats != NULL)
+    {
+        *pollStats = pollUsage;
+    }
+    pthread_mutex_unlock(&limitLock);
+}
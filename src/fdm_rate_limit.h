@@ -0,0 +1,117 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_rate_limit.h
+ * @brief Header file for exposing the token buckets that pace server operations toward constrained
+ *        devices.
+ */
+
+#ifndef FDM_RATE_LIMIT_H
+#define FDM_RATE_LIMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//! \{
+#define RATE_LIMIT_WAIT_FOREVER (-1)
+//! Milliseconds a query made over ubus waits for its poll token, a busy gateway fails it instead.
+#define RATE_LIMIT_QUERY_TIMEOUT (1000)
+//! \}
+
+/**
+ * Rates of the token buckets, in operations per minute. A rate of 0 leaves the bucket unlimited.
+ * A burst is the number of operations allowed back to back after an idle period, at least 1.
+ */
+typedef struct
+{
+    //! \{
+    unsigned int writesPerMinute;
+    unsigned int writeBurst;
+    unsigned int parentWritesPerMinute;
+    unsigned int parentWriteBurst;
+    unsigned int pollsPerMinute;
+    unsigned int pollBurst;
+    //! \}
+} RateLimitConfig;
+
+/**
+ * Usage of a kind of operation since start.
+ */
+typedef struct
+{
+    //! \{
+    unsigned int queueDepth;
+    uint64_t numAcquired;
+    uint64_t numTimedOut;
+    uint64_t totalWaitMs;
+    uint64_t maxWaitMs;
+    //! \}
+} RateLimitStats;
+
+/**
+ * @brief Set the rates of the token buckets. Waiting operations pick up the new rates at once.
+ * @param[in] config Rates, all unlimited until set.
+ */
+void RateLimit_Configure(const RateLimitConfig *config);
+
+/**
+ * @brief Get the rates of the token buckets.
+ * @param[out] config Rates.
+ */
+void RateLimit_GetConfig(RateLimitConfig *config);
+
+/**
+ * @brief Wait for a write token from the global bucket and from the bucket of the parent gateway
+ *        whose radio carries the write.
+ * @param[in] parentID Device ID of the parent gateway.
+ * @param[in] parentIDSize Size of parentID.
+ * @param[in] timeout Milliseconds to wait at most, or RATE_LIMIT_WAIT_FOREVER.
+ * @return true if the write may go ahead, false if no token was available in time.
+ */
+bool RateLimit_AcquireWrite(const uint8_t *parentID, size_t parentIDSize, int timeout);
+
+/**
+ * @brief Wait for a token from the bucket of client list polls.
+ * @param[in] timeout Milliseconds to wait at most, or RATE_LIMIT_WAIT_FOREVER.
+ * @return true if the poll may go ahead, false if no token was available in time.
+ */
+bool RateLimit_AcquirePoll(int timeout);
+
+/**
+ * @brief Get the queue depth and wait times of writes and polls.
+ * @param[out] writeStats Write usage.
+ * @param[out] pollStats Poll usage.
+ */
+void RateLimit_GetStats(RateLimitStats *writeStats, RateLimitStats *pollStats);
+
+#endif  /* FDM_RATE_LIMIT_H */
@@ -46,6 +46,9 @@
 #include "awa/server.h"
 #include "awa/common.h"
 #include "fdm_common.h"
+#include "fdm_flow_access_snapshot.h"
+#include "fdm_string_builder.h"
+#include "fdm_hex.h"
 #include "fdm_log.h"
 
 /***************************************************************************************************
@@ -54,7 +57,6 @@
 
 //! \{
 #define MIN_INSTANCES     (0)
-#define MAX_INSTANCES     (1)
 #define OPAQUE_VALUE_SIZE (32)
 //! \}
 
@@ -73,7 +75,7 @@ static AwaObjectDefinition *CreateObjectDefinition(const OBJECT_T *object)
     bool result = true;
     RESOURCE_T *resource;
     AwaError error;
-    AwaObjectDefinition *awaObject = AwaObjectDefinition_New(object->id, object->name, MIN_INSTANCES, MAX_INSTANCES);
+    AwaObjectDefinition *awaObject = AwaObjectDefinition_New(object->id, object->name, MIN_INSTANCES, MAX_FLOW_INSTANCES);
 
     if (awaObject == NULL)
     {
@@ -444,7 +446,8 @@ bool DoesObjectExist(AwaClientSession *session, AwaObjectID objectId, AwaObjectI
     return result;
 }
 
-bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const char *deviceType, int64_t licenseeID, const char *fcap)
+bool PopulateFlowObject(AwaClientSession *session, AwaObjectInstanceID instanceId, const char *deviceName,
+    const char *deviceType, int64_t licenseeID, const char *fcap)
 {
     char objectInstancePath[URL_PATH_SIZE] = {0};
     char deviceNameResourcePath[URL_PATH_SIZE] = {0};
@@ -464,14 +467,14 @@ bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const
     LOG(LOG_INFO, "Populate flow object with device type, licensee id and fcap");
 
     //Generate all object and resource paths
-    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(objectInstancePath) != AwaError_Success  ||
-        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(deviceNameResourcePath,
+    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(objectInstancePath, instanceId) != AwaError_Success  ||
+        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(deviceNameResourcePath, instanceId,
             FlowObjectResourceId_DeviceName)) != AwaError_Success ||
-        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(deviceTypeResourcePath,
+        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(deviceTypeResourcePath, instanceId,
             FlowObjectResourceId_DeviceType)) != AwaError_Success ||
-        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeIdResourcePath,
+        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeIdResourcePath, instanceId,
             FlowObjectResourceId_LicenseeId)) != AwaError_Success ||
-        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(fcapResourcePath, FlowObjectResourceId_Fcap))
+        (error = MAKE_FLOW_OBJECT_RESOURCE_PATH(fcapResourcePath, instanceId, FlowObjectResourceId_Fcap))
             != AwaError_Success))
     {
         LOG(LOG_ERR, "Failed to generate all object and resource paths\nerror: %s", AwaError_ToString(error));
@@ -485,7 +488,7 @@ bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const
         return false;
     }
 
-    if (!DoesObjectExist(session, Lwm2mObjectId_FlowObject, OBJECT_INSTANCE_ID))
+    if (!DoesObjectExist(session, Lwm2mObjectId_FlowObject, instanceId))
     {
         LOG(LOG_DBG, "Flow object instance doesn't exist, so create it");
         if ((error = AwaClientSetOperation_CreateObjectInstance(handler, objectInstancePath)) != AwaError_Success)
@@ -529,69 +532,41 @@ bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const
     return status;
 }
 
-unsigned int GetResources(AwaClientSession *session, const OBJECT_T objects[], unsigned int numObjects, char strings[][MAX_STR_SIZE])
+/**
+ * @brief Render the values of resources for which wantToSave is set as "Name=\"value\"" lines and
+ *        add them to a snapshot. Values are used in place from the get response.
+ * @param[in] response Get response holding the object instances.
+ * @param[in] objects Objects whose resources to render.
+ * @param[in] instanceIds Instance of each object to render.
+ * @param[in] numObjects Number of objects.
+ * @param[in] text Builder for the text lines.
+ * @param[in] snapshot Optional snapshot builder, may be NULL.
+ * @return true for success otherwise false.
+ */
+static bool RenderResources(const AwaClientGetResponse *response, const OBJECT_T objects[],
+    const AwaObjectInstanceID instanceIds[], unsigned int numObjects, StringBuilder *text,
+    FlowAccessSnapshotBuilder *snapshot)
 {
     const char *value;
     const AwaInteger *intValue;
     const AwaTime *timeValue;
-    AwaOpaque opaqueValue;
-    unsigned int i, j, k, resCount = 0;
-    unsigned char *opaqueData;
-    char *offset;
+    const AwaOpaque *opaqueValue;
+    char *hexText;
+    size_t hexLength;
+    unsigned int i, j;
     const OBJECT_T *object;
     RESOURCE_T *resource;
     bool result = true;
     AwaError error;
-    char objectInstancePath[URL_PATH_SIZE];
     char resourcePath[URL_PATH_SIZE];
-    const AwaClientGetResponse *response;
-    AwaClientGetOperation *operation;
-
-    if ((operation = AwaClientGetOperation_New(session)) == NULL)
-    {
-        LOG(LOG_ERR, "Failed to create get operation from session");
-        return 0;
-    }
+    const void *snapshotValue = NULL;
+    size_t snapshotLength = 0;
+    FlowAccessFieldType snapshotType = FlowAccessFieldType_None;
 
-    for (i = 0; i < numObjects; i++)
+    for (i = 0; i < numObjects && result; i++)
     {
-        memset(objectInstancePath, 0, URL_PATH_SIZE);
-        memset(resourcePath, 0, URL_PATH_SIZE);
-
         object = &objects[i];
 
-        if ((error = AwaAPI_MakeObjectInstancePath(objectInstancePath, URL_PATH_SIZE,
-            object->id, OBJECT_INSTANCE_ID)) != AwaError_Success)
-        {
-            LOG(LOG_ERR, "Failed to create path for %s object\nerror: %s", object->name, AwaError_ToString(error));
-            result = false;
-            break;
-        }
-        if ((error = AwaClientGetOperation_AddPath(operation, objectInstancePath)) != AwaError_Success)
-        {
-            LOG(LOG_ERR, "Failed to add %s object path to get operation\nerror: %s", object->name, AwaError_ToString(error));
-            result = false;
-            break;
-        }
-        if ((error = AwaClientGetOperation_Perform(operation, IPC_TIMEOUT)) != AwaError_Success)
-        {
-            LOG(LOG_ERR, "Failed to perform get operation for %s object\nerror: %s", object->name, AwaError_ToString(error));
-            result = false;
-            break;
-        }
-        if ((response = AwaClientGetOperation_GetResponse(operation)) == NULL)
-        {
-            LOG(LOG_ERR, "Failed to get response from get operation for %s object", object->name);
-            result = false;
-            break;
-        }
-        if (!AwaClientGetResponse_ContainsPath(response, objectInstancePath))
-        {
-            LOG(LOG_ERR, "Response doesn't contain %s object path", object->name);
-            result = false;
-            break;
-        }
-
         for (j = 0; j < object->numResources; j++)
         {
             resource = &object->resources[j];
@@ -599,8 +574,8 @@ unsigned int GetResources(AwaClientSession *session, const OBJECT_T objects[], u
             {
                 continue;
             }
-            if ((error = AwaAPI_MakeResourcePath(resourcePath, URL_PATH_SIZE, object->id,
-                OBJECT_INSTANCE_ID, resource->id)) != AwaError_Success)
+            if ((error = MAKE_RESOURCE_PATH(resourcePath, object->id, instanceIds[i], resource->id))
+                != AwaError_Success)
             {
                 LOG(LOG_ERR, "Failed to create path for %s resource\nerror: %s", resource->name, AwaError_ToString(error));
                 result = false;
@@ -618,36 +593,59 @@ unsigned int GetResources(AwaClientSession *session, const OBJECT_T objects[], u
                 case AwaResourceType_String:
                     if ((error = AwaClientGetResponse_GetValueAsCStringPointer(response, resourcePath, &value)) == AwaError_Success)
                     {
-                        sprintf(strings[resCount++], "%s=\"%s\"", resource->name, value);
+                        snapshotValue = value;
+                        snapshotLength = strlen(value);
+                        snapshotType = FlowAccessFieldType_String;
+                        result = StringBuilder_AppendString(text, resource->name) &&
+                            StringBuilder_Append(text, "=\"", 2) &&
+                            StringBuilder_Append(text, value, snapshotLength) &&
+                            StringBuilder_Append(text, "\"\n", 2);
                     }
                     break;
 
                 case AwaResourceType_Integer:
                     if ((error = AwaClientGetResponse_GetValueAsIntegerPointer(response, resourcePath, &intValue)) == AwaError_Success)
                     {
-                        sprintf(strings[resCount++], "%s=\"%" PRId64 "\"", resource->name, *intValue);
+                        snapshotValue = intValue;
+                        snapshotLength = sizeof(*intValue);
+                        snapshotType = FlowAccessFieldType_Integer;
+                        result = StringBuilder_AppendFormat(text, "%s=\"%" PRId64 "\"\n", resource->name, *intValue);
                     }
                     break;
 
                 case AwaResourceType_Time:
                     if ((error = AwaClientGetResponse_GetValueAsTimePointer(response, resourcePath, &timeValue)) == AwaError_Success)
                     {
-                        sprintf(strings[resCount++], "%s=\"%" PRId64 "\"", resource->name, *timeValue);
+                        snapshotValue = timeValue;
+                        snapshotLength = sizeof(*timeValue);
+                        snapshotType = FlowAccessFieldType_Integer;
+                        result = StringBuilder_AppendFormat(text, "%s=\"%" PRId64 "\"\n", resource->name, *timeValue);
                     }
                     break;
 
                 case AwaResourceType_Opaque:
-                    if ((error = AwaClientGetResponse_GetValueAsOpaque(response, resourcePath, &opaqueValue)) == AwaError_Success)
+                    if ((error = AwaClientGetResponse_GetValueAsOpaquePointer(response, resourcePath, &opaqueValue)) == AwaError_Success)
                     {
-                        opaqueData = (unsigned char *)opaqueValue.Data;
-                        offset = strings[resCount];
-                        offset += sprintf(strings[resCount], "%s=\"", resource->name);
-                        for (k = 0; k < DEVICE_ID_SIZE; k++)
+                        snapshotValue = opaqueValue->Data;
+                        snapshotLength = opaqueValue->Size;
+                        snapshotType = FlowAccessFieldType_Opaque;
+                        hexLength = HEX_ENCODED_LENGTH(opaqueValue->Size, ' ');
+                        result = StringBuilder_AppendString(text, resource->name) &&
+                            StringBuilder_Append(text, "=\"", 2);
+                        if (result && (hexText = StringBuilder_Reserve(text, hexLength)) != NULL)
+                        {
+                            Hex_Encode(hexText, opaqueValue->Data, opaqueValue->Size, ' ');
+                            StringBuilder_Commit(text, hexLength);
+                        }
+                        else if (result && text->isMeasuring)
+                        {
+                            StringBuilder_Commit(text, hexLength);
+                        }
+                        else
                         {
-                            offset += sprintf(offset, "%02X ", *opaqueData++);
+                            result = false;
                         }
-                        sprintf(offset, "\"");
-                        resCount++;
+                        result = result && StringBuilder_Append(text, "\"\n", 2);
                     }
                     break;
 
@@ -662,16 +660,122 @@ unsigned int GetResources(AwaClientSession *session, const OBJECT_T objects[], u
                 result = false;
                 break;
             }
+            if (!result)
+            {
+                LOG(LOG_ERR, "Failed to render %s resource value", resource->name);
+                break;
+            }
+            if (snapshot != NULL && !FlowAccessSnapshotBuilder_AddResource(snapshot, object->id, resource->id,
+                snapshotType, snapshotValue, snapshotLength))
+            {
+                LOG(LOG_ERR, "Failed to add %s resource value to snapshot", resource->name);
+                result = false;
+                break;
+            }
         }
-        if (!result)
+    }
+    return result;
+}
+
+bool GetResources(AwaClientSession *session, const OBJECT_T objects[],
+    const AwaObjectInstanceID instanceIds[], unsigned int numObjects, StringBuilder *text,
+    FlowAccessSnapshotBuilder *snapshot)
+{
+    unsigned int i;
+    const OBJECT_T *object;
+    bool result = true;
+    AwaError error;
+    char objectInstancePath[URL_PATH_SIZE];
+    const AwaClientGetResponse *response = NULL;
+    AwaClientGetOperation *operation;
+
+    if (session == NULL || instanceIds == NULL || text == NULL)
+    {
+        LOG(LOG_ERR, "Null params passed to %s()", __func__);
+        return false;
+    }
+
+    if ((operation = AwaClientGetOperation_New(session)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to create get operation from session");
+        return false;
+    }
+
+    // Fetch every object instance with a single get operation.
+    for (i = 0; i < numObjects; i++)
+    {
+        object = &objects[i];
+
+        if ((error = AwaAPI_MakeObjectInstancePath(objectInstancePath, URL_PATH_SIZE,
+            object->id, instanceIds[i])) != AwaError_Success)
         {
+            LOG(LOG_ERR, "Failed to create path for %s object\nerror: %s", object->name, AwaError_ToString(error));
+            result = false;
+            break;
+        }
+        if ((error = AwaClientGetOperation_AddPath(operation, objectInstancePath)) != AwaError_Success)
+        {
+            LOG(LOG_ERR, "Failed to add %s object path to get operation\nerror: %s", object->name, AwaError_ToString(error));
+            result = false;
             break;
         }
     }
 
+    if (result)
+    {
+        if ((error = AwaClientGetOperation_Perform(operation, IPC_TIMEOUT)) != AwaError_Success)
+        {
+            LOG(LOG_ERR, "Failed to perform get operation\nerror: %s", AwaError_ToString(error));
+            result = false;
+        }
+        else if ((response = AwaClientGetOperation_GetResponse(operation)) == NULL)
+        {
+            LOG(LOG_ERR, "Failed to get response from get operation");
+            result = false;
+        }
+    }
+
+    for (i = 0; i < numObjects && result; i++)
+    {
+        object = &objects[i];
+        AwaAPI_MakeObjectInstancePath(objectInstancePath, URL_PATH_SIZE, object->id, instanceIds[i]);
+        if (!AwaClientGetResponse_ContainsPath(response, objectInstancePath))
+        {
+            LOG(LOG_ERR, "Response doesn't contain %s object path", object->name);
+            result = false;
+        }
+    }
+
+    // Measure first, so that the text and the snapshot are each rendered into one allocation.
+    if (result)
+    {
+        StringBuilder_InitMeasure(text);
+        if (snapshot != NULL)
+        {
+            FlowAccessSnapshotBuilder_InitMeasure(snapshot);
+        }
+        result = RenderResources(response, objects, instanceIds, numObjects, text, snapshot);
+    }
+
+    if (result)
+    {
+        // One extra byte lets a trailing formatted value be written without growing.
+        result = StringBuilder_Init(text, text->length + 1) &&
+            (snapshot == NULL || FlowAccessSnapshotBuilder_Init(snapshot, snapshot->length)) &&
+            RenderResources(response, objects, instanceIds, numObjects, text, snapshot);
+        if (!result)
+        {
+            StringBuilder_Free(text);
+            if (snapshot != NULL)
+            {
+                FlowAccessSnapshotBuilder_Free(snapshot);
+            }
+        }
+    }
+
     if ((error = AwaClientGetOperation_Free(&operation)) != AwaError_Success)
     {
         LOG(LOG_WARN, "Failed to free get operation\nerror: %s", AwaError_ToString(error));
     }
-    return (result ? resCount : 0);
+    return result;
 }
@@ -41,6 +41,8 @@
 #include "awa/server.h"
 #include "awa/common.h"
 #include "fdm_common.h"
+#include "fdm_flow_access_snapshot.h"
+#include "fdm_string_builder.h"
 
 /**
  * @brief Define objects and their resources and register them with Awa client.
@@ -72,13 +74,15 @@ bool DoesObjectExist(AwaClientSession *session, AwaObjectID objectId, AwaObjectI
 /**
  * @brief Populate flow object with device type, licensee id and fcap.
  * @param[in] session A pointer to a valid session.
+ * @param[in] instanceId Flow object instance to populate, created if it doesn't exist.
  * @param[in] deviceName User assigned name of device.
  * @param[in] deviceType FlowCloud registered device type.
  * @param[in] licenseeID Licensee.
  * @param[in] fcap FlowCloud Access Provisioning Code.
  * @return true for success otherwise false.
  */
-bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const char *deviceType, int64_t licenseeID, const char *fcap);
+bool PopulateFlowObject(AwaClientSession *session, AwaObjectInstanceID instanceId, const char *deviceName,
+    const char *deviceType, int64_t licenseeID, const char *fcap);
 
 /**
  * @brief Set specified value to resource.
@@ -91,13 +95,18 @@ bool PopulateFlowObject(AwaClientSession *session, const char *deviceName, const
 bool SetResource(AwaClientSession *session, const char *resourcePath, void *value, AwaResourceType type);
 
 /**
- * @brief Get value of specified object's resources for which wantToSave parameter is set.
+ * @brief Get value of specified object's resources for which wantToSave parameter is set, rendered
+ *        as one "Name=\"value\"" line per resource.
  * @param[in] session A pointer to a valid session.
  * @param[in] objects Flow object's properties.
+ * @param[in] instanceIds Instance to read for each object.
  * @param[in] numObjects Number of objects to define and register.
- * @param[out] strings Resource value strings.
- * @return resource count for success and 0 for fail.
+ * @param[out] text Builder filled with the rendered lines, to be released by the caller.
+ * @param[out] snapshot Optional snapshot builder filled with the resource values, may be NULL.
+ * @return true for success otherwise false.
  */
-unsigned int GetResources(AwaClientSession *session, const OBJECT_T objects[], unsigned int numObjects, char strings[][MAX_STR_SIZE]);
+bool GetResources(AwaClientSession *session, const OBJECT_T objects[],
+    const AwaObjectInstanceID instanceIds[], unsigned int numObjects, StringBuilder *text,
+    FlowAccessSnapshotBuilder *snapshot);
 
 #endif  /* FDM_REGISTER_H */
@@ -37,13 +37,133 @@
  * Includes
  **************************************************************************************************/
 
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
 #include "awa/server.h"
+#include "fdm_server_session.h"
 #include "fdm_log.h"
 
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * A session kept connected between requests.
+ */
+typedef struct
+{
+    //! \{
+    AwaServerSession *session;
+    time_t lastUsed;
+    bool inUse;
+    //! \}
+} PooledSession;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static PooledSession sessionPool[SERVER_SESSION_POOL_SIZE];
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+//! @endcond
+
 /***************************************************************************************************
  * Methods
  **************************************************************************************************/
 
+//! \{
+static time_t GetMonotonicTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+/**
+ * @brief Check that the server daemon still answers on an idle session, it may have been
+ *        restarted since.
+ * @param[in] session session to check.
+ * @return true if the server answered otherwise false.
+ */
+static bool IsSessionHealthy(AwaServerSession *session)
+{
+    AwaServerListClientsOperation *operation;
+    AwaError error;
+
+    operation = AwaServerListClientsOperation_New(session);
+    if (operation == NULL)
+    {
+        return false;
+    }
+    error = AwaServerListClientsOperation_Perform(operation, IPC_TIMEOUT);
+    AwaServerListClientsOperation_Free(&operation);
+
+    if (error != AwaError_Success)
+    {
+        LOG(LOG_WARN, "Server session check failed\nerror: %s", AwaError_ToString(error));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Take a session from the pool, connecting it if needed.
+ * @param[in] isFallbackAllowed true to connect a session of its own when the pool is exhausted.
+ * @return a pointer to session with server, or NULL.
+ */
+static AwaServerSession *AcquireSession(bool isFallbackAllowed)
+{
+    PooledSession *pooled = NULL;
+    time_t now = GetMonotonicTime();
+    int i;
+
+    pthread_mutex_lock(&poolLock);
+    for (i = 0; i < SERVER_SESSION_POOL_SIZE; i++)
+    {
+        if (!sessionPool[i].inUse && (pooled == NULL || sessionPool[i].session != NULL))
+        {
+            pooled = &sessionPool[i];
+        }
+    }
+    if (pooled != NULL)
+    {
+        pooled->inUse = true;
+    }
+    pthread_mutex_unlock(&poolLock);
+
+    if (pooled == NULL)
+    {
+        LOG(LOG_DBG, "Server session pool exhausted");
+        // Fall back to a session of its own.
+        return isFallbackAllowed ? Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT) : NULL;
+    }
+
+    if (pooled->session != NULL && now - pooled->lastUsed >= SERVER_SESSION_CHECK_INTERVAL &&
+        !IsSessionHealthy(pooled->session))
+    {
+        LOG(LOG_INFO, "Reconnecting session with server");
+        Server_ReleaseSession(&pooled->session);
+    }
+
+    if (pooled->session == NULL)
+    {
+        pooled->session = Server_EstablishSession(SERVER_ADDRESS, SERVER_PORT);
+    }
+
+    if (pooled->session == NULL)
+    {
+        pthread_mutex_lock(&poolLock);
+        pooled->inUse = false;
+        pthread_mutex_unlock(&poolLock);
+        return NULL;
+    }
+    return pooled->session;
+}
+//! \}
+
 AwaServerSession *Server_EstablishSession(const char *address, unsigned int port)
 {
     // Initialise Device Management session
@@ -93,3 +213,69 @@ void Server_ReleaseSession(AwaServerSession **session)
         LOG(LOG_ERR, "Failed to free session with server");
     }
 }
+
+AwaServerSession *Server_AcquireSession(void)
+{
+    return AcquireSession(true);
+}
+
+AwaServerSession *Server_TryAcquireSession(void)
+{
+    return AcquireSession(false);
+}
+
+void Server_ReturnSession(AwaServerSession **session, bool isHealthy)
+{
+    int i;
+
+    if (session == NULL || *session == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&poolLock);
+    for (i = 0; i < SERVER_SESSION_POOL_SIZE; i++)
+    {
+        if (sessionPool[i].inUse && sessionPool[i].session == *session)
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&poolLock);
+
+    if (i == SERVER_SESSION_POOL_SIZE || !isHealthy)
+    {
+        Server_ReleaseSession(session);
+        if (i == SERVER_SESSION_POOL_SIZE)
+        {
+            return;
+        }
+        sessionPool[i].session = NULL;
+    }
+
+    pthread_mutex_lock(&poolLock);
+    sessionPool[i].lastUsed = GetMonotonicTime();
+    sessionPool[i].inUse = false;
+    pthread_mutex_unlock(&poolLock);
+    *session = NULL;
+}
+
+void Server_CloseSessions(void)
+{
+    int i;
+
+    pthread_mutex_lock(&poolLock);
+    for (i = 0; i < SERVER_SESSION_POOL_SIZE; i++)
+    {
+        if (sessionPool[i].inUse)
+        {
+            LOG(LOG_WARN, "Closing server session still in use");
+        }
+        if (sessionPool[i].session != NULL)
+        {
+            Server_ReleaseSession(&sessionPool[i].session);
+        }
+        sessionPool[i].inUse = false;
+    }
+    pthread_mutex_unlock(&poolLock);
+}
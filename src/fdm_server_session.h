@@ -38,6 +38,13 @@
 
 #include "fdm_common.h"
 
+//! \{
+/* Room for a full provisioning window of write workers (16) next to the session of the batch, auto
+ * provisioning, the journal retry and the ubus queries. */
+#define SERVER_SESSION_POOL_SIZE      (20)
+#define SERVER_SESSION_CHECK_INTERVAL (30)
+//! \}
+
 /**
  * @brief Establish a session with Awa LWM2M Server
  * @param[in] address IP address of the server
@@ -52,4 +59,31 @@ AwaServerSession *Server_EstablishSession(const char *address, unsigned int port
  */
 void Server_ReleaseSession(AwaServerSession **session);
 
+/**
+ * @brief Take a session from the pool of sessions kept connected to the Awa LWM2M Server, connecting
+ *        it if needed. A session idle for SERVER_SESSION_CHECK_INTERVAL seconds is checked first and
+ *        reconnected if the server no longer answers on it.
+ * @return a pointer to session with server, to be given back with Server_ReturnSession, or NULL.
+ */
+AwaServerSession *Server_AcquireSession(void);
+
+/**
+ * @brief Take a session from the pool like Server_AcquireSession, but without falling back to a
+ *        session of its own when every pooled session is in use.
+ * @return a pointer to session with server, to be given back with Server_ReturnSession, or NULL.
+ */
+AwaServerSession *Server_TryAcquireSession(void);
+
+/**
+ * @brief Give back a session taken by Server_AcquireSession or Server_TryAcquireSession.
+ * @param[in,out] session A pointer to the session, set to NULL.
+ * @param[in] isHealthy false if an IPC error was seen on the session, to reconnect it next time.
+ */
+void Server_ReturnSession(AwaServerSession **session, bool isHealthy);
+
+/**
+ * @brief Disconnect the pooled sessions.
+ */
+void Server_CloseSessions(void);
+
 #endif  /* FDM_SERVER_SESSION_H */
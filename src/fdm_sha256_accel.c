@@ -0,0 +1,201 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_sha256_accel.c
+ * @brief Hardware accelerated SHA256 compression functions. Each is compiled for its instruction
+ *        set with a target attribute and only called after the CPU has been probed for it.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include "fdm_sha256_accel.h"
+
+#ifdef SHA256_HAVE_SHA_NI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#ifdef SHA256_HAVE_ARM_CE
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define CPUID_FEATURES          (1)
+#define CPUID_EXTENDED_FEATURES (7)
+#define CPUID_SSSE3             (1 << 9)
+#define CPUID_SSE4_1            (1 << 19)
+#define CPUID_SHA               (1 << 29)
+
+#ifdef __clang__
+#define ARM_CE_TARGET "crypto"
+#else
+#define ARM_CE_TARGET "+crypto"
+#endif
+//! \}
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+#ifdef SHA256_HAVE_SHA_NI
+bool Sha256_HasShaNi(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(CPUID_FEATURES, &eax, &ebx, &ecx, &edx) ||
+        (ecx & (CPUID_SSSE3 | CPUID_SSE4_1)) != (CPUID_SSSE3 | CPUID_SSE4_1))
+    {
+        return false;
+    }
+    if (!__get_cpuid_count(CPUID_EXTENDED_FEATURES, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (ebx & CPUID_SHA) != 0;
+}
+
+#ifdef HMAC_HAVE_AVX2
+bool Sha256_HasAvx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+__attribute__((target("sha,sse4.1")))
+void Sha256_ProcessBlocksShaNi(uint32_t state[8], const uint8_t *data, size_t numBlocks)
+{
+    const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abefSave, cdghSave, message, temp;
+    __m128i words[4];
+    unsigned int i;
+
+    // The SHA instructions work on the state as ABEF and CDGH
+    temp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+    state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xf0);
+
+    while (numBlocks--)
+    {
+        abefSave = state0;
+        cdghSave = state1;
+
+        // Four rounds per step, with the schedule kept in a ring of four vectors
+        for (i = 0; i < 16; i++)
+        {
+            if (i < 4)
+            {
+                words[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i * 16)),
+                    byteSwapMask);
+            }
+            else
+            {
+                temp = _mm_alignr_epi8(words[(i - 1) & 3], words[(i - 2) & 3], 4);
+                words[i & 3] = _mm_sha256msg1_epu32(words[i & 3], words[(i - 3) & 3]);
+                words[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(words[i & 3], temp),
+                    words[(i - 1) & 3]);
+            }
+            message = _mm_add_epi32(words[i & 3],
+                _mm_loadu_si128((const __m128i *)&sha256RoundConstants[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0e));
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    // Back to ABCD and EFGH
+    temp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(temp, state1, 0xf0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, temp, 8));
+}
+#endif
+
+#ifdef SHA256_HAVE_ARM_CE
+bool Sha256_HasArmCe(void)
+{
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+__attribute__((target(ARM_CE_TARGET)))
+void Sha256_ProcessBlocksArmCe(uint32_t state[8], const uint8_t *data, size_t numBlocks)
+{
+    uint32x4_t state0, state1, abcdSave, efghSave, message, temp;
+    uint32x4_t words[4];
+    unsigned int i;
+
+    state0 = vld1q_u32(&state[0]);
+    state1 = vld1q_u32(&state[4]);
+
+    while (numBlocks--)
+    {
+        abcdSave = state0;
+        efghSave = state1;
+
+        // Four rounds per step, with the schedule kept in a ring of four vectors
+        for (i = 0; i < 16; i++)
+        {
+            if (i < 4)
+            {
+                words[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+            }
+            else
+            {
+                words[i & 3] = vsha256su1q_u32(vsha256su0q_u32(words[i & 3], words[(i - 3) & 3]),
+                    words[(i - 2) & 3], words[(i - 1) & 3]);
+            }
+            message = vaddq_u32(words[i & 3], vld1q_u32(&sha256RoundConstants[i * 4]));
+            temp = state0;
+            state0 = vsha256hq_u32(state0, state1, message);
+            state1 = vsha256h2q_u32(state1, temp, message);
+        }
+
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif
@@ -0,0 +1,121 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_sha256_accel.h
+ * @brief Internal interface between the portable SHA256 code and the hardware accelerated or
+ *        crypto library compression functions.
+ */
+
+#ifndef FDM_SHA256_ACCEL_H
+#define FDM_SHA256_ACCEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fdm_hmac.h"
+
+//! \{
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_HAVE_SHA_NI
+#define HMAC_HAVE_AVX2
+#endif
+
+#if defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+#define SHA256_HAVE_ARM_CE
+#endif
+
+#if defined(FDM_CRYPTO_OPENSSL) || defined(FDM_CRYPTO_MBEDTLS)
+#define SHA256_HAVE_LIBRARY
+#endif
+//! \}
+
+/**
+ * @brief Compress whole 64 byte blocks into a SHA256 state.
+ */
+typedef void (*Sha256ProcessBlocksFunction)(uint32_t state[8], const uint8_t *data, size_t numBlocks);
+
+/**
+ * SHA256 round constants.
+ */
+extern const uint32_t sha256RoundConstants[64];
+
+#ifdef SHA256_HAVE_SHA_NI
+/**
+ * @brief Check whether the CPU implements the x86 SHA extensions and SSE4.1.
+ * @return true if supported otherwise false.
+ */
+bool Sha256_HasShaNi(void);
+
+/**
+ * @brief Compress blocks with the x86 SHA extensions.
+ * @param[in,out] state SHA256 state.
+ * @param[in] data Blocks to compress.
+ * @param[in] numBlocks Number of 64 byte blocks.
+ */
+void Sha256_ProcessBlocksShaNi(uint32_t state[8], const uint8_t *data, size_t numBlocks);
+#endif
+
+#ifdef HMAC_HAVE_AVX2
+/**
+ * @brief Check whether the CPU and OS support AVX2, for the lane parallel HMAC chains.
+ * @return true if supported otherwise false.
+ */
+bool Sha256_HasAvx2(void);
+#endif
+
+#ifdef SHA256_HAVE_ARM_CE
+/**
+ * @brief Check whether the CPU implements the ARMv8 SHA256 instructions.
+ * @return true if supported otherwise false.
+ */
+bool Sha256_HasArmCe(void);
+
+/**
+ * @brief Compress blocks with the ARMv8 Crypto Extension.
+ * @param[in,out] state SHA256 state.
+ * @param[in] data Blocks to compress.
+ * @param[in] numBlocks Number of 64 byte blocks.
+ */
+void Sha256_ProcessBlocksArmCe(uint32_t state[8], const uint8_t *data, size_t numBlocks);
+#endif
+
+#ifdef SHA256_HAVE_LIBRARY
+/**
+ * @brief Compress blocks with the crypto library chosen at build time.
+ * @param[in,out] state SHA256 state.
+ * @param[in] data Blocks to compress.
+ * @param[in] numBlocks Number of 64 byte blocks.
+ */
+void Sha256_ProcessBlocksLibrary(uint32_t state[8], const uint8_t *data, size_t numBlocks);
+#endif
+
+#endif  /* FDM_SHA256_ACCEL_H */
@@ -0,0 +1,103 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_sha256_library.c
+ * @brief SHA256 compression function provided by the crypto library selected with the
+ *        CRYPTO_BACKEND build option, whose own assembly is tuned per architecture.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <string.h>
+#include "fdm_sha256_accel.h"
+
+#if defined(FDM_CRYPTO_OPENSSL)
+// SHA256_Transform is deprecated, but it is the only way to resume from a saved midstate.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+#elif defined(FDM_CRYPTO_MBEDTLS)
+#include <mbedtls/sha256.h>
+#endif
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#if defined(FDM_CRYPTO_MBEDTLS) && !defined(MBEDTLS_PRIVATE)
+// mbedTLS 2.x has no private member wrapper
+#define MBEDTLS_PRIVATE(member) member
+#endif
+//! \}
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+#if defined(FDM_CRYPTO_OPENSSL)
+void Sha256_ProcessBlocksLibrary(uint32_t state[8], const uint8_t *data, size_t numBlocks)
+{
+    SHA256_CTX context;
+    unsigned int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        context.h[i] = state[i];
+    }
+    while (numBlocks--)
+    {
+        SHA256_Transform(&context, data);
+        data += SHA256_BLOCK_SIZE;
+    }
+    for (i = 0; i < 8; i++)
+    {
+        state[i] = context.h[i];
+    }
+}
+#elif defined(FDM_CRYPTO_MBEDTLS)
+void Sha256_ProcessBlocksLibrary(uint32_t state[8], const uint8_t *data, size_t numBlocks)
+{
+    mbedtls_sha256_context context;
+
+    mbedtls_sha256_init(&context);
+    memcpy(context.MBEDTLS_PRIVATE(state), state, sizeof(context.MBEDTLS_PRIVATE(state)));
+    while (numBlocks--)
+    {
+        mbedtls_internal_sha256_process(&context, data);
+        data += SHA256_BLOCK_SIZE;
+    }
+    memcpy(state, context.MBEDTLS_PRIVATE(state), sizeof(context.MBEDTLS_PRIVATE(state)));
+    mbedtls_sha256_free(&context);
+}
+#endif
@@ -0,0 +1,197 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_string_builder.c
+ * @brief Provides a growable, arena-backed string builder.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "fdm_string_builder.h"
+#include "fdm_log.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MIN_GROW_SIZE (64)
+//! \}
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+void StringBuilder_InitMeasure(StringBuilder *builder)
+{
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->isMeasuring = true;
+}
+
+bool StringBuilder_Init(StringBuilder *builder, size_t capacity)
+{
+    builder->length = 0;
+    builder->capacity = capacity;
+    builder->isMeasuring = false;
+    builder->data = (capacity > 0) ? malloc(capacity) : NULL;
+    if (capacity > 0 && builder->data == NULL)
+    {
+        LOG(LOG_ERR, "Failed to allocate %zu bytes for string builder", capacity);
+        builder->capacity = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Make sure that at least length more bytes fit in the builder.
+ * @param[in] builder Builder.
+ * @param[in] length Number of bytes needed.
+ * @return true for success otherwise false.
+ */
+static bool EnsureSpace(StringBuilder *builder, size_t length)
+{
+    size_t capacity;
+    char *data;
+
+    if (builder->length + length <= builder->capacity)
+    {
+        return true;
+    }
+
+    capacity = builder->capacity * 2;
+    if (capacity < builder->length + length)
+    {
+        capacity = builder->length + length + MIN_GROW_SIZE;
+    }
+
+    if ((data = realloc(builder->data, capacity)) == NULL)
+    {
+        LOG(LOG_ERR, "Failed to grow string builder to %zu bytes", capacity);
+        return false;
+    }
+    builder->data = data;
+    builder->capacity = capacity;
+    return true;
+}
+
+bool StringBuilder_Append(StringBuilder *builder, const char *data, size_t length)
+{
+    if (!builder->isMeasuring)
+    {
+        if (!EnsureSpace(builder, length))
+        {
+            return false;
+        }
+        memcpy(builder->data + builder->length, data, length);
+    }
+    builder->length += length;
+    return true;
+}
+
+bool StringBuilder_AppendString(StringBuilder *builder, const char *string)
+{
+    return StringBuilder_Append(builder, string, strlen(string));
+}
+
+bool StringBuilder_AppendFormat(StringBuilder *builder, const char *format, ...)
+{
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(builder->isMeasuring ? NULL : builder->data + builder->length,
+        builder->isMeasuring ? 0 : builder->capacity - builder->length, format, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+        return false;
+    }
+
+    // vsnprintf needs room for a terminator, which is not counted as content.
+    if (!builder->isMeasuring && builder->length + length >= builder->capacity)
+    {
+        if (!EnsureSpace(builder, length + 1))
+        {
+            return false;
+        }
+        va_start(args, format);
+        vsnprintf(builder->data + builder->length, length + 1, format, args);
+        va_end(args);
+    }
+    builder->length += length;
+    return true;
+}
+
+char *StringBuilder_Reserve(StringBuilder *builder, size_t length)
+{
+    if (builder->isMeasuring || !EnsureSpace(builder, length))
+    {
+        return NULL;
+    }
+    return builder->data + builder->length;
+}
+
+void StringBuilder_Commit(StringBuilder *builder, size_t length)
+{
+    builder->length += length;
+}
+
+char *StringBuilder_Release(StringBuilder *builder, size_t *length)
+{
+    char *data = builder->data;
+
+    if (length != NULL)
+    {
+        *length = builder->length;
+    }
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    return data;
+}
+
+void StringBuilder_Free(StringBuilder *builder)
+{
+    free(builder->data);
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+}
@@ -0,0 +1,129 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file fdm_string_builder.h
+ * @brief Header file for exposing a growable, arena-backed string builder. A builder can first be
+ *        run in measuring mode to find out the exact size of its output, so that the real pass
+ *        needs a single allocation.
+ */
+
+#ifndef FDM_STRING_BUILDER_H
+#define FDM_STRING_BUILDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * String builder state.
+ */
+typedef struct
+{
+    //! \{
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool isMeasuring;
+    //! \}
+} StringBuilder;
+
+/**
+ * @brief Initialise a builder that only counts the length of what is appended to it.
+ * @param[out] builder Builder to initialise.
+ */
+void StringBuilder_InitMeasure(StringBuilder *builder);
+
+/**
+ * @brief Initialise a builder backed by a single allocation of the given capacity. The builder
+ *        still grows if more is appended than was reserved.
+ * @param[out] builder Builder to initialise.
+ * @param[in] capacity Number of bytes to reserve.
+ * @return true for success otherwise false.
+ */
+bool StringBuilder_Init(StringBuilder *builder, size_t capacity);
+
+/**
+ * @brief Append bytes to the builder.
+ * @param[in] builder Builder.
+ * @param[in] data Bytes to append.
+ * @param[in] length Number of bytes.
+ * @return true for success otherwise false.
+ */
+bool StringBuilder_Append(StringBuilder *builder, const char *data, size_t length);
+
+/**
+ * @brief Append a NUL terminated string to the builder.
+ * @param[in] builder Builder.
+ * @param[in] string String to append.
+ * @return true for success otherwise false.
+ */
+bool StringBuilder_AppendString(StringBuilder *builder, const char *string);
+
+/**
+ * @brief Append printf style formatted text to the builder.
+ * @param[in] builder Builder.
+ * @param[in] format Format string.
+ * @return true for success otherwise false.
+ */
+bool StringBuilder_AppendFormat(StringBuilder *builder, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Reserve space for length bytes at the end of the builder, for callers that write into the
+ *        buffer directly. StringBuilder_Commit must follow with the number of bytes written.
+ * @param[in] builder Builder.
+ * @param[in] length Number of bytes to reserve.
+ * @return Pointer to the reserved space, or NULL on failure or while measuring.
+ */
+char *StringBuilder_Reserve(StringBuilder *builder, size_t length);
+
+/**
+ * @brief Account for bytes written into space returned by StringBuilder_Reserve, or for bytes that
+ *        would have been written while measuring.
+ * @param[in] builder Builder.
+ * @param[in] length Number of bytes written.
+ */
+void StringBuilder_Commit(StringBuilder *builder, size_t length);
+
+/**
+ * @brief Hand the built content over to the caller.
+ * @param[in] builder Builder, which is left empty.
+ * @param[out] length Length of the content.
+ * @return Heap allocated content, owned by the caller.
+ */
+char *StringBuilder_Release(StringBuilder *builder, size_t *length);
+
+/**
+ * @brief Free the builder content.
+ * @param[in] builder Builder.
+ */
+void StringBuilder_Free(StringBuilder *builder);
+
+#endif  /* FDM_STRING_BUILDER_H */
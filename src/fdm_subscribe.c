@@ -56,7 +56,6 @@
 */
 static void flowObjectCallback(const AwaChangeSet *changeSet, void *context)
 {
-    static bool done = false;
     char licenseeChallengeResourcePath[URL_PATH_SIZE] = {0};
     char hashIterationsResourcePath[URL_PATH_SIZE] = {0};
     AwaOpaque licenseeChallenge = {0};
@@ -72,7 +71,8 @@ static void flowObjectCallback(const AwaChangeSet *changeSet, void *context)
     LOG(LOG_INFO, "Flow object updated");
 
     // Extract and store licensee challenge
-    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeChallengeResourcePath, FlowObjectResourceId_LicenseeChallenge)) == AwaError_Success)
+    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(licenseeChallengeResourcePath,
+        verificationData->instanceId, FlowObjectResourceId_LicenseeChallenge)) == AwaError_Success)
     {
         if (AwaChangeSet_ContainsPath(changeSet, licenseeChallengeResourcePath))
         {
@@ -112,7 +112,8 @@ static void flowObjectCallback(const AwaChangeSet *changeSet, void *context)
         LOG(LOG_DBG, "Failed to create licensee challenge resource path\nerror: %s", AwaError_ToString(error));
     }
 
-    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(hashIterationsResourcePath, FlowObjectResourceId_HashIterations)) == AwaError_Success)
+    if ((error = MAKE_FLOW_OBJECT_RESOURCE_PATH(hashIterationsResourcePath,
+        verificationData->instanceId, FlowObjectResourceId_HashIterations)) == AwaError_Success)
     {
         if (AwaChangeSet_ContainsPath(changeSet, hashIterationsResourcePath))
         {
@@ -138,10 +139,12 @@ static void flowObjectCallback(const AwaChangeSet *changeSet, void *context)
     }
 
     // no errors yet, check to see if we have what we need for provisioning
-    if (verificationData->waitForServerResponse && verificationData->hasChallenge && verificationData->hasIterations && !done)
+    if (verificationData->waitForServerResponse && verificationData->hasChallenge && verificationData->hasIterations &&
+        !verificationData->isVerificationRequested)
     {
         verificationData->verifyLicensee = true;
-        done = true;    // do this step once, because setting an object that we are observing will cause an infinite loop
+        // do this step once, because setting an object that we are observing will cause an infinite loop
+        verificationData->isVerificationRequested = true;
     }
 }
 
@@ -186,15 +189,15 @@ static void flowAccessCallback(const AwaChangeSet *changeSet, void *context)
 
     LOG(LOG_INFO, "Flow access object updated");
 
-    if ((error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(urlPath, FlowAccessResourceId_Url))
-            != AwaError_Success ||
-        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(keyPath, FlowAccessResourceId_CustomerKey))
-            != AwaError_Success ||
-        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(secretPath,
+    if ((error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(urlPath, verificationData->instanceId,
+            FlowAccessResourceId_Url)) != AwaError_Success ||
+        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(keyPath, verificationData->instanceId,
+            FlowAccessResourceId_CustomerKey)) != AwaError_Success ||
+        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(secretPath, verificationData->instanceId,
             FlowAccessResourceId_CustomerSecret)) != AwaError_Success ||
-        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(tokenPath,
+        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(tokenPath, verificationData->instanceId,
             FlowAccessResourceId_RememberMeToken)) != AwaError_Success ||
-        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(tokenExpiryPath,
+        (error = MAKE_FLOW_ACCESS_OBJECT_RESOURCE_PATH(tokenExpiryPath, verificationData->instanceId,
             FlowAccessResourceId_RememberMeTokenExpiry)) != AwaError_Success)
     {
         LOG(LOG_ERR, "Failed to generate resource path for all Flow access resources\nerror: %s", AwaError_ToString(error));
@@ -235,7 +238,7 @@ bool SubscribeToFlowObjects(AwaClientSession *session, FlowSubscriptions *subscr
 
     LOG(LOG_INFO, "Subscribing to Flow and Flow Access object change notifications");
 
-    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(flowObjectInstancePath)) != AwaError_Success ||
+    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(flowObjectInstancePath, verificationData->instanceId)) != AwaError_Success ||
         (error = MAKE_FLOW_ACCESS_OBJECT_PATH(flowAccessInstancePath)) != AwaError_Success)
     {
         LOG(LOG_ERR, "Failed to generate path for %u or %u objects\nerror: %s",
@@ -243,6 +246,8 @@ bool SubscribeToFlowObjects(AwaClientSession *session, FlowSubscriptions *subscr
         return false;
     }
 
+    subscriptions->instanceId = verificationData->instanceId;
+
     // Subscribe to Flow and Flow access object change notifications and the specified callback
     // function will be fired on AwaClientSession_DispatchCallbacks if the subscribed entity has
     // changed since the session callbacks were last dispatched.
@@ -328,7 +333,7 @@ void UnSubscribeFromFlowObjects(AwaClientSession *session, FlowSubscriptions *su
 
     LOG(LOG_INFO, "Unsubscribe from flow and flow access change notifications");
 
-    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(flowObjectInstancePath)) != AwaError_Success ||
+    if ((error = MAKE_FLOW_OBJECT_INSTANCE_PATH(flowObjectInstancePath, subscriptions->instanceId)) != AwaError_Success ||
         (error = MAKE_FLOW_ACCESS_OBJECT_PATH(flowAccessPath)) != AwaError_Success)
     {
         LOG(LOG_ERR, "Failed to create path for flow object or flow access object\nerror: %s", AwaError_ToString(error));
@@ -0,0 +1,102 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file fdm_test.h
+ * @brief Checks shared by the unit tests. Each test is an executable run by ctest that exits with
+ *        a non-zero status if any check failed.
+ */
+
+#ifndef FDM_TEST_H
+#define FDM_TEST_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+//! \{
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+//! \}
+
+//! @cond Doxygen_Suppress
+static unsigned int testFailures;
+//! @endcond
+
+/** Record a failure, with the location and the condition, if condition is false. */
+#define CHECK(condition)                                                             \
+    do {                                                                             \
+        if (!(condition))                                                            \
+        {                                                                            \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+            testFailures++;                                                          \
+        }                                                                            \
+    } while (0)
+
+/** Exit status of a test, to be returned from main. */
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+/**
+ * @brief Decode a hex literal of a test vector. The literal is trusted to be valid.
+ * @param[out] data Buffer large enough for the decoded bytes.
+ * @param[in] hex Compact hex text.
+ * @return Number of bytes decoded.
+ */
+static inline size_t Test_DecodeHex(uint8_t *data, const char *hex)
+{
+    size_t length = strlen(hex) / 2;
+    unsigned int byte;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        sscanf(&hex[i * 2], "%2x", &byte);
+        data[i] = byte;
+    }
+    return length;
+}
+
+/**
+ * @brief Check a hash against the hex of the expected one.
+ * @param[in] hash Computed bytes.
+ * @param[in] expected Hex of the expected bytes.
+ * @return true if they match otherwise false.
+ */
+static inline bool Test_IsHexEqual(const uint8_t *hash, const char *expected)
+{
+    uint8_t expectedBytes[256];
+    size_t length = Test_DecodeHex(expectedBytes, expected);
+
+    return memcmp(hash, expectedBytes, length) == 0;
+}
+
+#endif  /* FDM_TEST_H */
@@ -0,0 +1,261 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file test_auto_provision_rules.c
+ * @brief Unit tests of loading and matching the auto provisioning rules.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "fdm_auto_provision_rules.h"
+#include "fdm_log.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define DEFAULT_TIMEOUT (30)
+#define DEFAULT_WINDOW  (4)
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+int debugLevel = LOG_FATAL;
+FILE *debugStream = NULL;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static bool LoadText(AutoProvisionRules *ruleSet, const char *text)
+{
+    char path[] = "/tmp/test_auto_provision_rules_XXXXXX";
+    int fd = mkstemp(path);
+    bool result;
+
+    memset(ruleSet, 0, sizeof(*ruleSet));
+    ruleSet->timeout = DEFAULT_TIMEOUT;
+    ruleSet->window = DEFAULT_WINDOW;
+    if (fd < 0 || write(fd, text, strlen(text)) != (ssize_t)strlen(text))
+    {
+        printf("Failed to write %s\n", path);
+        testFailures++;
+        return false;
+    }
+    close(fd);
+    result = AutoProvisionRules_Load(ruleSet, path);
+    unlink(path);
+    return result;
+}
+
+static bool IsEmpty(const AutoProvisionRules *ruleSet)
+{
+    return ruleSet->rules == NULL && ruleSet->numRules == 0 && ruleSet->parentID == NULL;
+}
+
+static void TestLoad(void)
+{
+    AutoProvisionRules ruleSet;
+
+    CHECK(LoadText(&ruleSet,
+        "{\"parent_id\": \"085A24DEA8C20A4BAB244CF6ED5D5F62\", \"timeout\": 60, \"window\": 8, \"rules\": ["
+        "{\"client_id_prefix\": \"Led\", \"client_id_regex\": \"^Led[0-9]+$\", \"fcap\": \"XXXX\","
+        " \"device_type\": \"FlowCreatorLED\", \"licensee_id\": 7},"
+        "{\"manufacturer\": \"Imagination\", \"model_number\": \"Clicker\", \"fcap\": \"YYYY\","
+        " \"device_type\": \"Clicker\", \"licensee_id\": 8}]}"));
+    CHECK(ruleSet.numRules == 2);
+    CHECK(ruleSet.parentID != NULL && strcmp(ruleSet.parentID, "085A24DEA8C20A4BAB244CF6ED5D5F62") == 0);
+    CHECK(ruleSet.timeout == 60);
+    CHECK(ruleSet.window == 8);
+    if (ruleSet.numRules == 2)
+    {
+        CHECK(strcmp(ruleSet.rules[0].clientIDPrefix, "Led") == 0);
+        CHECK(ruleSet.rules[0].hasClientIDRegex);
+        CHECK(ruleSet.rules[0].manufacturer == NULL && ruleSet.rules[0].modelNumber == NULL);
+        CHECK(strcmp(ruleSet.rules[0].fcap, "XXXX") == 0);
+        CHECK(strcmp(ruleSet.rules[0].deviceType, "FlowCreatorLED") == 0);
+        CHECK(ruleSet.rules[0].licenseeID == 7);
+
+        CHECK(ruleSet.rules[1].clientIDPrefix == NULL && !ruleSet.rules[1].hasClientIDRegex);
+        CHECK(strcmp(ruleSet.rules[1].manufacturer, "Imagination") == 0);
+        CHECK(strcmp(ruleSet.rules[1].modelNumber, "Clicker") == 0);
+        CHECK(ruleSet.rules[1].licenseeID == 8);
+    }
+    AutoProvisionRules_Free(&ruleSet);
+    CHECK(IsEmpty(&ruleSet));
+    CHECK(ruleSet.timeout == 60 && ruleSet.window == 8);
+}
+
+static void TestLoadDefaults(void)
+{
+    AutoProvisionRules ruleSet;
+
+    // Options left out keep the values given, an empty rules array is valid.
+    CHECK(LoadText(&ruleSet, "{\"rules\": []}"));
+    CHECK(ruleSet.numRules == 0 && ruleSet.parentID == NULL);
+    CHECK(ruleSet.timeout == DEFAULT_TIMEOUT && ruleSet.window == DEFAULT_WINDOW);
+    AutoProvisionRules_Free(&ruleSet);
+
+    // Windows are clamped to 1 up to the largest provisioning window.
+    CHECK(LoadText(&ruleSet, "{\"window\": 0, \"rules\": []}"));
+    CHECK(ruleSet.window == 1);
+    AutoProvisionRules_Free(&ruleSet);
+    CHECK(LoadText(&ruleSet, "{\"window\": -3, \"rules\": []}"));
+    CHECK(ruleSet.window == 1);
+    AutoProvisionRules_Free(&ruleSet);
+    CHECK(LoadText(&ruleSet, "{\"window\": 100, \"rules\": []}"));
+    CHECK(ruleSet.window == AUTO_PROVISION_MAX_WINDOW);
+    AutoProvisionRules_Free(&ruleSet);
+    CHECK(LoadText(&ruleSet, "{\"window\": 16, \"rules\": []}"));
+    CHECK(ruleSet.window == AUTO_PROVISION_MAX_WINDOW);
+    AutoProvisionRules_Free(&ruleSet);
+
+    // A timeout that isn't positive keeps the default.
+    CHECK(LoadText(&ruleSet, "{\"timeout\": 0, \"rules\": []}"));
+    CHECK(ruleSet.timeout == DEFAULT_TIMEOUT);
+    AutoProvisionRules_Free(&ruleSet);
+    CHECK(LoadText(&ruleSet, "{\"timeout\": -5, \"rules\": []}"));
+    CHECK(ruleSet.timeout == DEFAULT_TIMEOUT);
+    AutoProvisionRules_Free(&ruleSet);
+
+    // A parent_id that isn't a string is left out.
+    CHECK(LoadText(&ruleSet, "{\"parent_id\": 5, \"rules\": []}"));
+    CHECK(ruleSet.parentID == NULL);
+    AutoProvisionRules_Free(&ruleSet);
+}
+
+static void TestLoadInvalid(void)
+{
+    const char *texts[] =
+    {
+        "",
+        "{\"rules\": [",
+        "{}",
+        "{\"rules\": {}}",
+        "[]",
+        // Each rule needs fcap, device_type and licensee_id, as strings where they are.
+        "{\"rules\": [{\"device_type\": \"Led\", \"licensee_id\": 7}]}",
+        "{\"rules\": [{\"fcap\": \"XXXX\", \"licensee_id\": 7}]}",
+        "{\"rules\": [{\"fcap\": \"XXXX\", \"device_type\": \"Led\"}]}",
+        "{\"rules\": [{\"fcap\": 5, \"device_type\": \"Led\", \"licensee_id\": 7}]}",
+        "{\"rules\": [{\"fcap\": \"XXXX\", \"device_type\": \"Led\", \"licensee_id\": 7, \"client_id_regex\": \"(\"}]}",
+        // A bad rule after valid ones, which are freed with it.
+        "{\"parent_id\": \"085A24\", \"rules\": [{\"client_id_prefix\": \"Led\", \"client_id_regex\": \"^Led\","
+        " \"fcap\": \"XXXX\", \"device_type\": \"Led\", \"licensee_id\": 7}, {\"fcap\": \"YYYY\"}]}",
+    };
+    AutoProvisionRules ruleSet;
+
+    for (size_t i = 0; i < ARRAY_SIZE(texts); i++)
+    {
+        if (LoadText(&ruleSet, texts[i]))
+        {
+            printf("Loaded invalid rules %s\n", texts[i]);
+            testFailures++;
+            AutoProvisionRules_Free(&ruleSet);
+        }
+        CHECK(IsEmpty(&ruleSet));
+    }
+
+    memset(&ruleSet, 0, sizeof(ruleSet));
+    CHECK(!AutoProvisionRules_Load(&ruleSet, "/nonexistent/auto_provision.cfg"));
+    CHECK(IsEmpty(&ruleSet));
+}
+
+static void TestClientIDMatching(void)
+{
+    AutoProvisionRules ruleSet;
+    const AutoProvisionRule *any, *prefix, *regex, *both;
+
+    CHECK(LoadText(&ruleSet, "{\"rules\": ["
+        "{\"fcap\": \"A\", \"device_type\": \"A\", \"licensee_id\": 1},"
+        "{\"client_id_prefix\": \"Led\", \"fcap\": \"B\", \"device_type\": \"B\", \"licensee_id\": 1},"
+        "{\"client_id_regex\": \"^(Led|Button)[0-9]+$\", \"fcap\": \"C\", \"device_type\": \"C\", \"licensee_id\": 1},"
+        "{\"client_id_prefix\": \"Led\", \"client_id_regex\": \"[0-9]$\", \"fcap\": \"D\", \"device_type\": \"D\","
+        " \"licensee_id\": 1}]}"));
+    if (ruleSet.numRules != 4)
+    {
+        CHECK(ruleSet.numRules == 4);
+        AutoProvisionRules_Free(&ruleSet);
+        return;
+    }
+    any = &ruleSet.rules[0];
+    prefix = &ruleSet.rules[1];
+    regex = &ruleSet.rules[2];
+    both = &ruleSet.rules[3];
+
+    CHECK(AutoProvisionRules_IsClientIDMatching(any, "Anything"));
+    CHECK(AutoProvisionRules_IsClientIDMatching(any, ""));
+
+    CHECK(AutoProvisionRules_IsClientIDMatching(prefix, "Led"));
+    CHECK(AutoProvisionRules_IsClientIDMatching(prefix, "LedDevice1"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(prefix, "Le"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(prefix, "led1"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(prefix, "MyLed"));
+
+    CHECK(AutoProvisionRules_IsClientIDMatching(regex, "Led12"));
+    CHECK(AutoProvisionRules_IsClientIDMatching(regex, "Button3"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(regex, "Led"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(regex, "Led1x"));
+
+    CHECK(AutoProvisionRules_IsClientIDMatching(both, "LedDevice1"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(both, "LedDevice"));
+    CHECK(!AutoProvisionRules_IsClientIDMatching(both, "Button1"));
+
+    AutoProvisionRules_Free(&ruleSet);
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    TestLoad();
+    TestLoadDefaults();
+    TestLoadInvalid();
+    TestClientIDMatching();
+    return TEST_RESULT();
+}
@@ -0,0 +1,172 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_base64.c
+ * @brief Unit tests of the base64 decoder.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "fdm_base64.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_DECODED_LENGTH (64)
+//! \}
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static int Decode(uint8_t *data, size_t maxLength, const char *text)
+{
+    return Base64_Decode(data, maxLength, text, strlen(text));
+}
+
+static void TestRfc4648Vectors(void)
+{
+    // RFC 4648 section 10, with and without the padding.
+    const char *vectors[][3] =
+    {
+        {"", "", ""},
+        {"f", "Zg==", "Zg"},
+        {"fo", "Zm8=", "Zm8"},
+        {"foo", "Zm9v", "Zm9v"},
+        {"foob", "Zm9vYg==", "Zm9vYg"},
+        {"fooba", "Zm9vYmE=", "Zm9vYmE"},
+        {"foobar", "Zm9vYmFy", "Zm9vYmFy"}
+    };
+    uint8_t data[MAX_DECODED_LENGTH];
+    size_t length;
+
+    for (size_t i = 0; i < ARRAY_SIZE(vectors); i++)
+    {
+        length = strlen(vectors[i][0]);
+        for (size_t j = 1; j < 3; j++)
+        {
+            memset(data, 0, sizeof(data));
+            CHECK(Decode(data, sizeof(data), vectors[i][j]) == (int)length);
+            CHECK(memcmp(data, vectors[i][0], length) == 0);
+        }
+        CHECK(BASE64_DECODED_LENGTH(strlen(vectors[i][1])) >= length);
+    }
+}
+
+static void TestAlphabet(void)
+{
+    const uint8_t expected[] = {0x00, 0x10, 0x83, 0x10, 0x51, 0x87, 0x20, 0x92, 0x8B, 0x30, 0xD3, 0x8F,
+        0x41, 0x14, 0x93, 0x51, 0x55, 0x97, 0x61, 0x96, 0x9B, 0x71, 0xD7, 0x9F, 0x82, 0x18, 0xA3, 0x92,
+        0x59, 0xA7, 0xA2, 0x9A, 0xAB, 0xB2, 0xDB, 0xAF, 0xC3, 0x1C, 0xB3, 0xD3, 0x5D, 0xB7, 0xE3, 0x9E,
+        0xBB, 0xF3, 0xDF, 0xBF};
+    uint8_t data[MAX_DECODED_LENGTH];
+
+    // Every character of the alphabet once, in the order of its value.
+    CHECK(Decode(data, sizeof(data), "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/") ==
+        sizeof(expected));
+    CHECK(memcmp(data, expected, sizeof(expected)) == 0);
+}
+
+static void TestDecodeInvalid(void)
+{
+    uint8_t data[MAX_DECODED_LENGTH];
+
+    // Characters outside the standard alphabet, the URL safe one included.
+    CHECK(Decode(data, sizeof(data), "Zm9v!mFy") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9v-_Fy") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9v YmFy") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9vYmF\n") == -1);
+    CHECK(Base64_Decode(data, sizeof(data), "Zm9v\0mFy", 8) == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9v\xC3mFy") == -1);
+
+    // Padding anywhere but at the end, or more of it than a quantum can take.
+    CHECK(Decode(data, sizeof(data), "Zg==Zg==") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm=v") == -1);
+    CHECK(Decode(data, sizeof(data), "=m9v") == -1);
+    CHECK(Decode(data, sizeof(data), "Z===") == -1);
+    CHECK(Decode(data, sizeof(data), "====") == -1);
+    CHECK(Decode(data, sizeof(data), "Zg=") == -1);
+    CHECK(Decode(data, sizeof(data), "Zg===") == -1);
+
+    // A lone character can't make up a byte, and the character after the text isn't read.
+    CHECK(Decode(data, sizeof(data), "Z") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9vY") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9vY===") == -1);
+    CHECK(Base64_Decode(data, sizeof(data), "Zm9vYA", 5) == -1);
+
+    // The unused bits of the last character must be zero.
+    CHECK(Decode(data, sizeof(data), "Zh==") == -1);
+    CHECK(Decode(data, sizeof(data), "Zh") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm9=") == -1);
+    CHECK(Decode(data, sizeof(data), "Zm/") == -1);
+
+    CHECK(Base64_Decode(NULL, sizeof(data), "Zg==", 4) == -1);
+    CHECK(Base64_Decode(data, sizeof(data), NULL, 4) == -1);
+}
+
+static void TestDecodeOverflow(void)
+{
+    uint8_t data[7];
+
+    // One byte more than maxLength fails without writing past it.
+    memset(data, 0xEE, sizeof(data));
+    CHECK(Decode(data, 6, "Zm9vYmFy") == 6);
+    CHECK(memcmp(data, "foobar", 6) == 0);
+    memset(data, 0xEE, sizeof(data));
+    CHECK(Decode(data, 5, "Zm9vYmFy") == -1);
+    CHECK(Decode(data, 4, "Zm9vYmE=") == -1);
+    CHECK(data[4] == 0xEE);
+
+    CHECK(Decode(data, 0, "Zg==") == -1);
+    CHECK(Decode(data, 0, "") == 0);
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    TestRfc4648Vectors();
+    TestAlphabet();
+    TestDecodeInvalid();
+    TestDecodeOverflow();
+    return TEST_RESULT();
+}
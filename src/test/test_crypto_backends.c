@@ -0,0 +1,175 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_crypto_backends.c
+ * @brief Cross-check of the SHA256 implementations and crypto library backend against the portable
+ *        code, on random messages and on the licensee hash workload.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "fdm_hmac.h"
+#include "fdm_licensee_hash.h"
+#include "fdm_test.h"
+
+#if defined(FDM_CRYPTO_OPENSSL)
+#include <openssl/sha.h>
+#elif defined(FDM_CRYPTO_MBEDTLS)
+#include <mbedtls/version.h>
+#include <mbedtls/sha256.h>
+#endif
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define NUM_MESSAGES        (200)
+#define MAX_MESSAGE_LENGTH  (1100)
+#define NUM_LICENSEE_HASHES (20)
+#define LICENSEE_KEY_SIZE   (64)
+#define MAX_CHALLENGE_SIZE  (512)
+#define MAX_ITERATIONS      (200)
+
+#if defined(FDM_CRYPTO_MBEDTLS) && MBEDTLS_VERSION_MAJOR < 3
+// mbedTLS 2.x returns an error code from the _ret variant only
+#define mbedtls_sha256 mbedtls_sha256_ret
+#endif
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static uint32_t randomState = 0x9e3779b9;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static uint32_t NextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void FillRandom(uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = NextRandom();
+    }
+}
+
+static void TestSha256(Sha256Implementation implementation)
+{
+    static uint8_t message[MAX_MESSAGE_LENGTH];
+    uint8_t expected[SHA256_HASH_LENGTH], hash[SHA256_HASH_LENGTH];
+    size_t length;
+
+    for (int i = 0; i < NUM_MESSAGES; i++)
+    {
+        length = NextRandom() % (MAX_MESSAGE_LENGTH + 1);
+        FillRandom(message, length);
+
+        HmacSha256_SetImplementation(Sha256Implementation_Portable);
+        Sha256_ComputeHash(expected, message, length);
+        HmacSha256_SetImplementation(implementation);
+        Sha256_ComputeHash(hash, message, length);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+
+#if defined(FDM_CRYPTO_OPENSSL)
+        SHA256(message, length, hash);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+#elif defined(FDM_CRYPTO_MBEDTLS)
+        CHECK(mbedtls_sha256(message, length, hash, 0) == 0);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+#endif
+    }
+}
+
+static void TestLicenseeHash(Sha256Implementation implementation)
+{
+    uint8_t key[LICENSEE_KEY_SIZE], challenge[MAX_CHALLENGE_SIZE];
+    uint8_t expected[SHA256_HASH_LENGTH], hash[SHA256_HASH_LENGTH];
+    HmacSha256Key hmacKey;
+    int challengeLength, iterations;
+
+    for (int i = 0; i < NUM_LICENSEE_HASHES; i++)
+    {
+        FillRandom(key, sizeof(key));
+        challengeLength = 1 + NextRandom() % MAX_CHALLENGE_SIZE;
+        FillRandom(challenge, challengeLength);
+        iterations = 1 + NextRandom() % MAX_ITERATIONS;
+
+        HmacSha256_SetImplementation(Sha256Implementation_Portable);
+        HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+        CalculateLicenseeHash(expected, challenge, challengeLength, iterations, &hmacKey);
+
+        HmacSha256_SetImplementation(implementation);
+        HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+        CalculateLicenseeHash(hash, challenge, challengeLength, iterations, &hmacKey);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+    }
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    Sha256Implementation defaultImplementation = HmacSha256_GetImplementation();
+
+    for (int i = 0; i < Sha256Implementation_Max; i++)
+    {
+        if (!HmacSha256_IsImplementationSupported(i))
+        {
+            continue;
+        }
+        printf("Implementation %d\n", i);
+        TestSha256(i);
+        TestLicenseeHash(i);
+    }
+
+    HmacSha256_SetImplementation(defaultImplementation);
+    return TEST_RESULT();
+}
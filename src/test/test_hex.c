@@ -0,0 +1,200 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_hex.c
+ * @brief Unit tests of the hex codec.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "fdm_hex.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define DEVICE_ID_SIZE (16)
+//! \}
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static void TestEncode(void)
+{
+    const uint8_t data[] = {0x08, 0x5A, 0x24, 0xFF, 0x00, 0xc3};
+    char text[HEX_ENCODED_LENGTH(sizeof(data), ' ') + 1];
+    size_t length;
+
+    length = Hex_Encode(text, data, sizeof(data), ' ');
+    text[length] = '\0';
+    CHECK(length == HEX_ENCODED_LENGTH(sizeof(data), ' '));
+    CHECK(strcmp(text, "08 5A 24 FF 00 C3 ") == 0);
+
+    length = Hex_Encode(text, data, sizeof(data), '\0');
+    text[length] = '\0';
+    CHECK(length == HEX_ENCODED_LENGTH(sizeof(data), '\0'));
+    CHECK(strcmp(text, "085A24FF00C3") == 0);
+
+    CHECK(Hex_Encode(text, data, 0, ' ') == 0);
+}
+
+static void TestDecodeSeparators(void)
+{
+    const uint8_t expected[] = {0x08, 0x5A, 0x24};
+    const char *texts[] = {"085A24", "08 5A 24 ", "08:5A:24", "08\t5A\t24", " 08 :5a\t24  ", "085a24"};
+    uint8_t data[DEVICE_ID_SIZE];
+
+    for (size_t i = 0; i < ARRAY_SIZE(texts); i++)
+    {
+        memset(data, 0, sizeof(data));
+        CHECK(Hex_Decode(data, sizeof(data), texts[i]) == sizeof(expected));
+        CHECK(memcmp(data, expected, sizeof(expected)) == 0);
+    }
+
+    CHECK(Hex_Decode(data, sizeof(data), "") == 0);
+    CHECK(Hex_Decode(data, sizeof(data), " : ") == 0);
+}
+
+static void TestDecodeInvalid(void)
+{
+    uint8_t data[DEVICE_ID_SIZE];
+
+    // Odd number of digits, also when the lone digit is between separators.
+    CHECK(Hex_Decode(data, sizeof(data), "085A2") == -1);
+    CHECK(Hex_Decode(data, sizeof(data), "08 5 A2") == -1);
+    CHECK(Hex_Decode(data, sizeof(data), "8") == -1);
+
+    CHECK(Hex_Decode(data, sizeof(data), "0G") == -1);
+    CHECK(Hex_Decode(data, sizeof(data), "08-5A") == -1);
+    CHECK(Hex_Decode(data, sizeof(data), "0x08") == -1);
+    CHECK(Hex_Decode(NULL, sizeof(data), "08") == -1);
+    CHECK(Hex_Decode(data, sizeof(data), NULL) == -1);
+}
+
+static void TestDecodeOverflow(void)
+{
+    uint8_t data[DEVICE_ID_SIZE + 1];
+
+    memset(data, 0xEE, sizeof(data));
+    CHECK(Hex_Decode(data, DEVICE_ID_SIZE, "000102030405060708090A0B0C0D0E0F") == DEVICE_ID_SIZE);
+    CHECK(data[DEVICE_ID_SIZE - 1] == 0x0F);
+
+    // One byte more than maxLength fails without writing past it.
+    memset(data, 0xEE, sizeof(data));
+    CHECK(Hex_Decode(data, DEVICE_ID_SIZE, "000102030405060708090A0B0C0D0E0F10") == -1);
+    CHECK(data[DEVICE_ID_SIZE] == 0xEE);
+
+    CHECK(Hex_Decode(data, 0, "00") == -1);
+    CHECK(Hex_Decode(data, 0, "") == 0);
+}
+
+static void TestRoundTrip(void)
+{
+    uint8_t data[256], decoded[256];
+    char text[HEX_ENCODED_LENGTH(sizeof(data), ':') + 1];
+    size_t length;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = i;
+    }
+
+    length = Hex_Encode(text, data, sizeof(data), ':');
+    text[length] = '\0';
+    CHECK(Hex_Decode(decoded, sizeof(decoded), text) == sizeof(data));
+    CHECK(memcmp(data, decoded, sizeof(data)) == 0);
+
+    length = Hex_Encode(text, data, sizeof(data), '\0');
+    text[length] = '\0';
+    CHECK(Hex_Decode(decoded, sizeof(decoded), text) == sizeof(data));
+    CHECK(memcmp(data, decoded, sizeof(data)) == 0);
+}
+
+static void TestDecodeParentID(void)
+{
+    const uint8_t expected[DEVICE_ID_SIZE] =
+    {
+        0x08, 0x5A, 0x24, 0xDE, 0xA8, 0xC2, 0x0A, 0x4B, 0xAB, 0x24, 0x4C, 0xF6, 0xED, 0x5D, 0x5F, 0x62
+    };
+    // A parent_id as given to provision_constrained_device(s), or copied from flow_access.cfg.
+    const char *texts[] =
+    {
+        "085A24DEA8C20A4BAB244CF6ED5D5F62",
+        "085a24dea8c20a4bab244cf6ed5d5f62",
+        "08 5A 24 DE A8 C2 0A 4B AB 24 4C F6 ED 5D 5F 62 ",
+        "08:5A:24:DE:A8:C2:0A:4B:AB:24:4C:F6:ED:5D:5F:62",
+    };
+    char text[HEX_ENCODED_LENGTH(DEVICE_ID_SIZE, '\0') + 1];
+    uint8_t parentID[DEVICE_ID_SIZE];
+
+    for (size_t i = 0; i < ARRAY_SIZE(texts); i++)
+    {
+        memset(parentID, 0, sizeof(parentID));
+        CHECK(Hex_Decode(parentID, sizeof(parentID), texts[i]) == DEVICE_ID_SIZE);
+        CHECK(memcmp(parentID, expected, sizeof(expected)) == 0);
+    }
+
+    // Only a whole device ID is a parent, one byte short or over is rejected.
+    CHECK(Hex_Decode(parentID, sizeof(parentID), "085A24DEA8C20A4BAB244CF6ED5D5F") == DEVICE_ID_SIZE - 1);
+    CHECK(Hex_Decode(parentID, sizeof(parentID), "085A24DEA8C20A4BAB244CF6ED5D5F6200") == -1);
+    CHECK(Hex_Decode(parentID, sizeof(parentID), "085A24DEA8C20A4BAB244CF6ED5D5F6") == -1);
+
+    // The journal keeps a resolved parent as compact hex, which decodes back to the same bytes.
+    text[Hex_Encode(text, expected, DEVICE_ID_SIZE, '\0')] = '\0';
+    CHECK(strcmp(text, texts[0]) == 0);
+    memset(parentID, 0, sizeof(parentID));
+    CHECK(Hex_Decode(parentID, sizeof(parentID), text) == DEVICE_ID_SIZE);
+    CHECK(memcmp(parentID, expected, sizeof(expected)) == 0);
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    TestEncode();
+    TestDecodeSeparators();
+    TestDecodeInvalid();
+    TestDecodeOverflow();
+    TestRoundTrip();
+    TestDecodeParentID();
+    return TEST_RESULT();
+}
@@ -0,0 +1,302 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_hmac.c
+ * @brief Known answer tests of SHA256, HMAC-SHA256 and the licensee hash, run against every SHA256
+ *        implementation supported by the CPU. Built once with the rolled reference transform and
+ *        once with SHA256_UNROLLED, so that both have to give identical output.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "fdm_hmac.h"
+#include "fdm_licensee_hash.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define LICENSEE_KEY_SIZE   (64)
+#define MAX_CHALLENGE_SIZE  (512)
+#define NUM_CHAINS          (12)
+//! \}
+
+/***************************************************************************************************
+ * Typedefs
+ **************************************************************************************************/
+
+/**
+ * SHA256 known answer, from FIPS 180-2.
+ */
+typedef struct
+{
+    //! \{
+    const char *message;
+    unsigned int repeat;
+    const char *hash;
+    //! \}
+} Sha256Vector;
+
+/**
+ * HMAC-SHA256 known answer, from RFC 4231. Key and data are given in hex.
+ */
+typedef struct
+{
+    //! \{
+    const char *key;
+    const char *data;
+    const char *hash;
+    //! \}
+} HmacVector;
+
+/**
+ * HMAC pad midstates, the SHA256 state after compressing the key XOR ipad and the key XOR opad
+ * blocks. Key is given in hex.
+ */
+typedef struct
+{
+    //! \{
+    const char *key;
+    uint32_t innerState[8];
+    uint32_t outerState[8];
+    //! \}
+} MidstateVector;
+
+/**
+ * Licensee hash known answer, for a key of 64 0x5a bytes and a challenge counting up from 0.
+ */
+typedef struct
+{
+    //! \{
+    int challengeLength;
+    int iterations;
+    const char *hash;
+    //! \}
+} LicenseeHashVector;
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static const Sha256Vector sha256Vectors[] =
+{
+    {"abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+};
+
+static const HmacVector hmacVectors[] =
+{
+    {"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", "4869205468657265",
+        "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"},
+    {"4a656665", "7768617420646f2079612077616e7420666f72206e6f7468696e673f",
+        "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd",
+        "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"},
+    {"0102030405060708090a0b0c0d0e0f10111213141516171819",
+        "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+        "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "54657374205573696e67204c6172676572205468616e20426c6f636b2d53697a65204b6579202d2048617368204b6579204669727374",
+        "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "5468697320697320612074657374207573696e672061206c6172676572207468616e20626c6f636b2d73697a65206b657920616e642061206c6172676572207468616e20626c6f636b2d73697a6520646174612e20546865206b6579206e6565647320746f20626520686173686564206265666f7265206265696e6720757365642062792074686520484d414320616c676f726974686d2e",
+        "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"},
+};
+
+static const MidstateVector midstateVectors[] =
+{
+    {"4a656665",
+        {0x655da7fa, 0xcc434b37, 0x5a1cd5cb, 0x0692ee0e, 0xa47a23d3, 0x4c3af449, 0xdba21ae2, 0x78c7500c},
+        {0x0eafe3d5, 0x13412e6c, 0x6a6a2feb, 0x2d375acc, 0x51a4fd47, 0x6db095e8, 0x23bfa18a, 0x52f141d5}},
+    {"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+        {0x2bb21804, 0x23b95bf9, 0xb4e8258c, 0xfab5e654, 0x11f2921e, 0x4feb78ee, 0x9890e5fe, 0x64b78036},
+        {0x27e7739f, 0xd9562583, 0x56d666e2, 0x5f810de8, 0xec5e4f8a, 0x553d4fb8, 0x3cff20ba, 0x10234b40}},
+    {"5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a"
+        "5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a5a",
+        {0xb91be1e1, 0xc22adea2, 0x4821c74f, 0xec558b75, 0x08b95a59, 0xfa1eff72, 0xd3399140, 0x718e1bdd},
+        {0xe0830cfc, 0x427b6430, 0x496b666b, 0xd6a66952, 0x43d386cd, 0xfebac16c, 0xcd07b701, 0x2ab1d299}},
+};
+
+static const unsigned int chainCounts[] = {1, 3, 8, NUM_CHAINS};
+
+static const LicenseeHashVector licenseeHashVectors[] =
+{
+    {16, 1, "f9de2a869988f9c31ee486f875b10e4901e68f05c510ee53df86538f3713073b"},
+    {64, 1000, "ff1b8fb90b96149027d2ad7dc0daebb2d36a1f95a675197b7ed0f1870f5b9494"},
+    {512, 100, "13b567d3ee2044b2a9b1b4cbee66e7c3a92e4ee885ff21f145520b9da6aeb0e6"},
+};
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static void TestSha256(void)
+{
+    static uint8_t data[1000000];
+    uint8_t hash[SHA256_HASH_LENGTH];
+    size_t length;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sha256Vectors); i++)
+    {
+        length = strlen(sha256Vectors[i].message);
+        for (size_t j = 0; j < sha256Vectors[i].repeat; j++)
+        {
+            memcpy(&data[j * length], sha256Vectors[i].message, length);
+        }
+        Sha256_ComputeHash(hash, data, length * sha256Vectors[i].repeat);
+        CHECK(Test_IsHexEqual(hash, sha256Vectors[i].hash));
+    }
+}
+
+static void TestHmac(void)
+{
+    uint8_t key[256], message[256], hash[SHA256_HASH_LENGTH];
+    HmacSha256Key hmacKey;
+    HmacSha256Context context;
+    size_t keyLength, messageLength;
+
+    for (size_t i = 0; i < ARRAY_SIZE(hmacVectors); i++)
+    {
+        keyLength = Test_DecodeHex(key, hmacVectors[i].key);
+        messageLength = Test_DecodeHex(message, hmacVectors[i].data);
+        HmacSha256_ComputeHash(hash, message, messageLength, key, keyLength);
+        CHECK(Test_IsHexEqual(hash, hmacVectors[i].hash));
+
+        HmacSha256_SetKey(&hmacKey, key, keyLength);
+        HmacSha256_ComputeHashWithKey(hash, message, messageLength, &hmacKey);
+        CHECK(Test_IsHexEqual(hash, hmacVectors[i].hash));
+
+        HmacSha256_Init(&context, &hmacKey);
+        HmacSha256_Update(&context, message, messageLength);
+        HmacSha256_Final(&context, hash);
+        CHECK(Test_IsHexEqual(hash, hmacVectors[i].hash));
+    }
+}
+
+static void TestMidstate(void)
+{
+    uint8_t key[SHA256_BLOCK_SIZE];
+    HmacSha256Key hmacKey;
+    size_t keyLength;
+
+    for (size_t i = 0; i < ARRAY_SIZE(midstateVectors); i++)
+    {
+        keyLength = Test_DecodeHex(key, midstateVectors[i].key);
+        HmacSha256_SetKey(&hmacKey, key, keyLength);
+        CHECK(memcmp(hmacKey.InnerState, midstateVectors[i].innerState, sizeof(hmacKey.InnerState)) == 0);
+        CHECK(memcmp(hmacKey.OuterState, midstateVectors[i].outerState, sizeof(hmacKey.OuterState)) == 0);
+    }
+}
+
+static void TestLicenseeHash(void)
+{
+    static uint8_t challenges[NUM_CHAINS][MAX_CHALLENGE_SIZE];
+    uint8_t key[LICENSEE_KEY_SIZE], hash[SHA256_HASH_LENGTH];
+    HmacSha256Key hmacKey;
+    HmacSha256Chain chains[NUM_CHAINS];
+    size_t i;
+
+    memset(key, 0x5a, sizeof(key));
+    HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+    for (i = 0; i < MAX_CHALLENGE_SIZE; i++)
+    {
+        challenges[0][i] = i;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(licenseeHashVectors); i++)
+    {
+        CalculateLicenseeHash(hash, challenges[0], licenseeHashVectors[i].challengeLength,
+            licenseeHashVectors[i].iterations, &hmacKey);
+        CHECK(Test_IsHexEqual(hash, licenseeHashVectors[i].hash));
+    }
+
+    // Chains run in SIMD lanes have to match the licensee hash computed one chain at a time, for
+    // a single chain, a partial group of lanes, a full one and a full one followed by a partial one.
+    for (size_t j = 0; j < ARRAY_SIZE(chainCounts); j++)
+    {
+        size_t count = chainCounts[j];
+
+        for (i = 0; i < count; i++)
+        {
+            memset(challenges[i], i, MAX_CHALLENGE_SIZE);
+            chains[i].Key = &hmacKey;
+            chains[i].Data = challenges[i];
+            chains[i].DataLen = 16 << (i % 4);
+            chains[i].Iterations = 1 + i * 37;
+        }
+        HmacSha256_ComputeHashChains(chains, count);
+        for (i = 0; i < count; i++)
+        {
+            CalculateLicenseeHash(hash, chains[i].Data, chains[i].DataLen, chains[i].Iterations, &hmacKey);
+            CHECK(memcmp(hash, chains[i].Hash, SHA256_HASH_LENGTH) == 0);
+        }
+    }
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    Sha256Implementation defaultImplementation = HmacSha256_GetImplementation();
+
+    for (int i = 0; i < Sha256Implementation_Max; i++)
+    {
+        if (!HmacSha256_IsImplementationSupported(i))
+        {
+            continue;
+        }
+        printf("Implementation %d\n", i);
+        HmacSha256_SetImplementation(i);
+        TestSha256();
+        TestHmac();
+        TestMidstate();
+        TestLicenseeHash();
+    }
+
+    HmacSha256_SetImplementation(defaultImplementation);
+    return TEST_RESULT();
+}
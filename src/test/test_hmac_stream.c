@@ -0,0 +1,236 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_hmac_stream.c
+ * @brief Fuzz test of the streaming HMAC-SHA256 interface, for message and key lengths across the
+ *        block boundaries and data split into updates at random points.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "fdm_hmac.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_MESSAGE_LENGTH  (2200)
+#define MAX_KEY_LENGTH      (150)
+#define SPLITS_PER_LENGTH   (8)
+#define IPAD                (0x36)
+#define OPAD                (0x5c)
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+static uint32_t randomState = 0x12345678;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static uint32_t NextRandom(void)
+{
+    // xorshift32, the same sequence on every run so that a failure can be reproduced
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void FillRandom(uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = NextRandom();
+    }
+}
+
+/**
+ * @brief HMAC straight from its definition in RFC 2104, on top of the one shot SHA256 only.
+ */
+static void ComputeReferenceHmac(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *message,
+    size_t messageLength, const uint8_t *key, size_t keyLength)
+{
+    static uint8_t buffer[SHA256_BLOCK_SIZE + MAX_MESSAGE_LENGTH];
+    uint8_t paddedKey[SHA256_BLOCK_SIZE] = {0};
+    size_t i;
+
+    if (keyLength > SHA256_BLOCK_SIZE)
+    {
+        Sha256_ComputeHash(paddedKey, key, keyLength);
+    }
+    else
+    {
+        memcpy(paddedKey, key, keyLength);
+    }
+
+    for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        buffer[i] = paddedKey[i] ^ IPAD;
+    }
+    memcpy(&buffer[SHA256_BLOCK_SIZE], message, messageLength);
+    Sha256_ComputeHash(hash, buffer, SHA256_BLOCK_SIZE + messageLength);
+
+    memmove(&buffer[SHA256_BLOCK_SIZE], hash, SHA256_HASH_LENGTH);
+    for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        buffer[i] = paddedKey[i] ^ OPAD;
+    }
+    Sha256_ComputeHash(hash, buffer, SHA256_BLOCK_SIZE + SHA256_HASH_LENGTH);
+}
+
+static void ComputeStreamedHmac(uint8_t hash[SHA256_HASH_LENGTH], const uint8_t *message,
+    size_t messageLength, const HmacSha256Key *hmacKey)
+{
+    HmacSha256Context context;
+    size_t offset = 0, length;
+
+    HmacSha256_Init(&context, hmacKey);
+    while (offset < messageLength)
+    {
+        // Mostly short updates that straddle block boundaries, sometimes empty or long ones.
+        switch (NextRandom() % 4)
+        {
+            case 0:
+                length = 0;
+                break;
+            case 1:
+                length = NextRandom() % (4 * SHA256_BLOCK_SIZE);
+                break;
+            default:
+                length = NextRandom() % SHA256_BLOCK_SIZE;
+                break;
+        }
+        if (length > messageLength - offset)
+        {
+            length = messageLength - offset;
+        }
+        HmacSha256_Update(&context, &message[offset], length);
+        offset += length;
+    }
+    HmacSha256_Final(&context, hash);
+}
+
+static void TestLengths(void)
+{
+    static uint8_t message[MAX_MESSAGE_LENGTH];
+    uint8_t key[MAX_KEY_LENGTH], expected[SHA256_HASH_LENGTH], hash[SHA256_HASH_LENGTH];
+    HmacSha256Key hmacKey;
+    size_t messageLength, keyLength;
+
+    FillRandom(message, sizeof(message));
+    FillRandom(key, sizeof(key));
+
+    // Every length up to a few blocks, then random ones past the 1024 byte buffer of the old code.
+    for (messageLength = 0; messageLength < MAX_MESSAGE_LENGTH;
+        messageLength += messageLength < 4 * SHA256_BLOCK_SIZE ? 1 : 1 + NextRandom() % 97)
+    {
+        keyLength = NextRandom() % (MAX_KEY_LENGTH + 1);
+        ComputeReferenceHmac(expected, message, messageLength, key, keyLength);
+
+        HmacSha256_ComputeHash(hash, message, messageLength, key, keyLength);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+
+        HmacSha256_SetKey(&hmacKey, key, keyLength);
+        HmacSha256_ComputeHashWithKey(hash, message, messageLength, &hmacKey);
+        CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+
+        for (int split = 0; split < SPLITS_PER_LENGTH; split++)
+        {
+            ComputeStreamedHmac(hash, message, messageLength, &hmacKey);
+            CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+        }
+    }
+}
+
+static void TestContextReuse(void)
+{
+    uint8_t message[3 * SHA256_BLOCK_SIZE], key[SHA256_BLOCK_SIZE];
+    uint8_t expected[SHA256_HASH_LENGTH], hash[SHA256_HASH_LENGTH];
+    HmacSha256Key hmacKey;
+    HmacSha256Context context;
+
+    FillRandom(message, sizeof(message));
+    FillRandom(key, sizeof(key));
+    HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+    ComputeReferenceHmac(expected, message, sizeof(message), key, sizeof(key));
+
+    // The key is only needed by Init, and a finished context can be initialised again.
+    HmacSha256_Init(&context, &hmacKey);
+    memset(&hmacKey, 0, sizeof(hmacKey));
+    HmacSha256_Update(&context, message, sizeof(message));
+    HmacSha256_Final(&context, hash);
+    CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+
+    HmacSha256_SetKey(&hmacKey, key, sizeof(key));
+    HmacSha256_Init(&context, &hmacKey);
+    HmacSha256_Update(&context, message, 1);
+    HmacSha256_Update(&context, &message[1], sizeof(message) - 1);
+    HmacSha256_Final(&context, hash);
+    CHECK(memcmp(hash, expected, SHA256_HASH_LENGTH) == 0);
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    Sha256Implementation defaultImplementation = HmacSha256_GetImplementation();
+
+    for (int i = 0; i < Sha256Implementation_Max; i++)
+    {
+        if (!HmacSha256_IsImplementationSupported(i))
+        {
+            continue;
+        }
+        printf("Implementation %d\n", i);
+        HmacSha256_SetImplementation(i);
+        TestLengths();
+        TestContextReuse();
+    }
+
+    HmacSha256_SetImplementation(defaultImplementation);
+    return TEST_RESULT();
+}
@@ -0,0 +1,275 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file test_provision_journal.c
+ * @brief Unit tests of replaying the provisioning journal, checked through the journal file that
+ *        is left after it is loaded and updated.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "device_manager.h"
+#include "fdm_provision_journal.h"
+#include "fdm_log.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define MAX_JOURNAL_SIZE (4096)
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+int debugLevel = LOG_FATAL;
+FILE *debugStream = NULL;
+
+static char journalPath[64];
+static unsigned int numProvisionings;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+/**
+ * @brief Stands in for the provisioning of the retry thread. Retries are due a minute after a
+ *        failure at the earliest, so no test should get here.
+ */
+bool ProvisionConstrainedDevices(ConstrainedDevice devices[], unsigned int numDevices, const char *deviceType,
+    int licenseeID, const char *parentID, int timeout, unsigned int window)
+{
+    numProvisionings++;
+    return false;
+}
+
+//! \{
+static void WriteJournal(const char *content)
+{
+    FILE *file = fopen(journalPath, "w");
+
+    if (file == NULL || fputs(content, file) == EOF)
+    {
+        printf("Failed to write %s\n", journalPath);
+        testFailures++;
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+static void ReadJournal(char content[MAX_JOURNAL_SIZE])
+{
+    FILE *file = fopen(journalPath, "r");
+    size_t length = 0;
+
+    if (file != NULL)
+    {
+        length = fread(content, 1, MAX_JOURNAL_SIZE - 1, file);
+        fclose(file);
+    }
+    content[length] = '\0';
+}
+
+/**
+ * @brief Check that the journal file holds exactly the given records, in any order.
+ * @param[in] records Records, each with its newline, ended by NULL.
+ * @return true if it does otherwise false.
+ */
+static bool HasRecords(const char *records[])
+{
+    char content[MAX_JOURNAL_SIZE];
+    size_t length = 0;
+    unsigned int i;
+
+    ReadJournal(content);
+    for (i = 0; records[i] != NULL; i++)
+    {
+        if (strstr(content, records[i]) == NULL)
+        {
+            printf("Journal lacks %s", records[i]);
+            return false;
+        }
+        length += strlen(records[i]);
+    }
+    if (strlen(content) != length)
+    {
+        printf("Journal holds more than expected:\n%s", content);
+        return false;
+    }
+    return true;
+}
+
+static bool Replay(const char *content)
+{
+    WriteJournal(content);
+    return ProvisionJournal_Start(journalPath);
+}
+
+static void TestReplayMissing(void)
+{
+    const char *afterFailure[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", NULL};
+
+    unlink(journalPath);
+    CHECK(ProvisionJournal_Start(journalPath));
+    CHECK(access(journalPath, F_OK) != 0);
+
+    ProvisionJournal_RecordFailure("Led1", "FCAP", "Led", 7, "085A24");
+    CHECK(HasRecords(afterFailure));
+    ProvisionJournal_Stop();
+
+    // Kept for the next run.
+    CHECK(ProvisionJournal_Start(journalPath));
+    CHECK(HasRecords(afterFailure));
+    ProvisionJournal_Stop();
+}
+
+static void TestReplayTruncated(void)
+{
+    const char *replayed[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", NULL};
+    const char *afterFailure[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", "1\t7\tLed2\tFCAP\tLed\t085A24\n", NULL};
+
+    // The last record lost its newline in a crash, it is dropped when the journal is compacted.
+    CHECK(Replay("1\t7\tLed1\tFCAP\tLed\t085A24\n3\t7\tLed2\tFCAP\tLed\t085A24"));
+    CHECK(HasRecords(replayed));
+
+    // So Led2 starts over.
+    ProvisionJournal_RecordFailure("Led2", "FCAP", "Led", 7, "085A24");
+    CHECK(HasRecords(afterFailure));
+    ProvisionJournal_Stop();
+}
+
+static void TestReplaySuperseded(void)
+{
+    const char *replayed[] = {"2\t7\tLed1\tFCAP2\tLed\t085A24\n", "1\t7\tLed2\tFCAP\tLed\t085A24\n", NULL};
+    const char *afterFailure[] = {"2\t7\tLed1\tFCAP2\tLed\t085A24\n", "1\t7\tLed2\tFCAP\tLed\t085A24\n",
+        "3\t7\tLed1\tFCAP2\tLed\t085A24\n", NULL};
+
+    // The last record of a client wins, the earlier ones are compacted away.
+    CHECK(Replay("1\t7\tLed1\tFCAP1\tLed\t085A24\n1\t7\tLed2\tFCAP\tLed\t085A24\n"
+        "2\t7\tLed1\tFCAP2\tLed\t085A24\n"));
+    CHECK(HasRecords(replayed));
+
+    // Failing again counts on from the replayed attempts.
+    ProvisionJournal_RecordFailure("Led1", "FCAP2", "Led", 7, "085A24");
+    CHECK(HasRecords(afterFailure));
+    ProvisionJournal_Stop();
+}
+
+static void TestReplaySpentBudget(void)
+{
+    const char *replayed[] = {"9\t7\tLed2\tFCAP\tLed\t085A24\n", NULL};
+    const char *afterFailures[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", NULL};
+
+    // Led1 was given up by its last record, Led2 has one attempt left.
+    CHECK(Replay("9\t7\tLed1\tFCAP\tLed\t085A24\n10\t7\tLed1\tFCAP\tLed\t085A24\n9\t7\tLed2\tFCAP\tLed\t085A24\n"));
+    CHECK(HasRecords(replayed));
+
+    ProvisionJournal_RecordFailure("Led2", "FCAP", "Led", 7, "085A24");
+    ProvisionJournal_RecordFailure("Led1", "FCAP", "Led", 7, "085A24");
+    CHECK(HasRecords(afterFailures));
+    ProvisionJournal_Stop();
+}
+
+static void TestReplayInvalid(void)
+{
+    const char *replayed[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", "2\t-3\tLed2\tFCAP\tLed\t085A24\n", NULL};
+
+    CHECK(Replay("1\t7\tLed1\tFCAP\tLed\t085A24\n"
+        "\n"
+        "1\t7\tLed3\tFCAP\tLed\n"
+        "1\t7\tLed3\tFCAP\tLed\t085A24\textra\n"
+        "1\t7\tLed3\t\tLed\t085A24\n"
+        "0\t7\tLed3\tFCAP\tLed\t085A24\n"
+        "-1\t7\tLed3\tFCAP\tLed\t085A24\n"
+        "x\t7\tLed3\tFCAP\tLed\t085A24\n"
+        "1\t7x\tLed3\tFCAP\tLed\t085A24\n"
+        "2\t-3\tLed2\tFCAP\tLed\t085A24\n"));
+    CHECK(HasRecords(replayed));
+    ProvisionJournal_Stop();
+}
+
+static void TestRecordSuccess(void)
+{
+    const char *replayed[] = {"1\t7\tLed1\tFCAP\tLed\t085A24\n", "4\t7\tLed2\tFCAP\tLed\t085A24\n", NULL};
+    const char *afterSuccess[] = {"4\t7\tLed2\tFCAP\tLed\t085A24\n", NULL};
+
+    // Nothing to compact, the journal is left as it is.
+    CHECK(Replay("1\t7\tLed1\tFCAP\tLed\t085A24\n4\t7\tLed2\tFCAP\tLed\t085A24\n"));
+    CHECK(HasRecords(replayed));
+
+    ProvisionJournal_RecordSuccess("Led1");
+    ProvisionJournal_RecordSuccess("Led3");
+    CHECK(HasRecords(afterSuccess));
+    ProvisionJournal_Stop();
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    char directory[] = "/tmp/test_provision_journal_XXXXXX";
+
+    if (mkdtemp(directory) == NULL)
+    {
+        printf("Failed to create a directory for the journal\n");
+        return 1;
+    }
+    snprintf(journalPath, sizeof(journalPath), "%s/journal", directory);
+
+    TestReplayMissing();
+    TestReplayTruncated();
+    TestReplaySuperseded();
+    TestReplaySpentBudget();
+    TestReplayInvalid();
+    TestRecordSuccess();
+    CHECK(numProvisionings == 0);
+
+    unlink(journalPath);
+    rmdir(directory);
+    return TEST_RESULT();
+}
@@ -0,0 +1,314 @@
+/***************************************************************************************************
+ * Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies
+ * and/or licensors
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to
+ *    endorse or promote products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * @file test_rate_limit.c
+ * @brief Unit tests of the token buckets pacing writes and polls: refill up to the burst, the wait
+ *        for the next token, unlimited buckets and the least recently used parent buckets.
+ */
+
+/***************************************************************************************************
+ * Includes
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fdm_rate_limit.h"
+#include "fdm_log.h"
+#include "fdm_test.h"
+
+/***************************************************************************************************
+ * Macros
+ **************************************************************************************************/
+
+//! \{
+#define PARENT_ID_SIZE      (16)
+#define MAX_PARENT_BUCKETS  (16)
+// Long enough for buckets touched one after the other to have different last use times
+#define TICK_US             (3000)
+//! \}
+
+/***************************************************************************************************
+ * Globals
+ **************************************************************************************************/
+
+//! @cond Doxygen_Suppress
+int debugLevel = LOG_FATAL;
+FILE *debugStream = NULL;
+//! @endcond
+
+/***************************************************************************************************
+ * Methods
+ **************************************************************************************************/
+
+//! \{
+static int64_t GetMonotonicTimeMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Set the rates, starting with full write and poll buckets whatever earlier tests left in
+ *        them. Buckets are kept full while unlimited.
+ */
+static void Configure(unsigned int writesPerMinute, unsigned int writeBurst, unsigned int parentWritesPerMinute,
+    unsigned int parentWriteBurst, unsigned int pollsPerMinute, unsigned int pollBurst)
+{
+    RateLimitConfig config =
+    {
+        .writeBurst = writeBurst,
+        .parentWriteBurst = parentWriteBurst,
+        .pollBurst = pollBurst,
+    };
+
+    RateLimit_Configure(&config);
+    RateLimit_AcquireWrite(NULL, 0, 0);
+    RateLimit_AcquirePoll(0);
+
+    config.writesPerMinute = writesPerMinute;
+    config.parentWritesPerMinute = parentWritesPerMinute;
+    config.pollsPerMinute = pollsPerMinute;
+    RateLimit_Configure(&config);
+}
+
+/**
+ * @brief Make the parent ID of a test, different for every test and parent.
+ */
+static const uint8_t *MakeParentID(uint8_t parentID[PARENT_ID_SIZE], uint8_t test, uint8_t parent)
+{
+    memset(parentID, 0, PARENT_ID_SIZE);
+    parentID[0] = test;
+    parentID[PARENT_ID_SIZE - 1] = parent;
+    return parentID;
+}
+
+static unsigned int CountPolls(void)
+{
+    unsigned int count = 0;
+
+    while (count < 1000 && RateLimit_AcquirePoll(0))
+    {
+        count++;
+    }
+    return count;
+}
+
+static void TestBurst(void)
+{
+    RateLimitStats before, after;
+
+    // A burst of 0 still lets one operation through.
+    Configure(0, 0, 0, 0, 60, 3);
+    CHECK(CountPolls() == 3);
+    Configure(0, 0, 0, 0, 60, 0);
+    CHECK(CountPolls() == 1);
+
+    RateLimit_GetStats(NULL, &before);
+    CHECK(!RateLimit_AcquirePoll(0));
+    RateLimit_GetStats(NULL, &after);
+    CHECK(after.numTimedOut == before.numTimedOut + 1);
+    CHECK(after.numAcquired == before.numAcquired);
+    CHECK(after.queueDepth == 0);
+}
+
+static void TestRefill(void)
+{
+    // 6000 per minute earns a token every 10 ms, but no more than the burst however long it's idle.
+    Configure(0, 0, 0, 0, 6000, 2);
+    usleep(100 * 1000);
+    CHECK(CountPolls() == 2);
+    usleep(100 * 1000);
+    CHECK(CountPolls() == 2);
+
+    usleep(15 * 1000);
+    CHECK(CountPolls() == 1);
+}
+
+static void TestWait(void)
+{
+    RateLimitStats before, after;
+    int64_t start, waited;
+
+    // Drained at 60 per minute, the next token comes a second later.
+    Configure(0, 0, 0, 0, 60, 1);
+    CHECK(CountPolls() == 1);
+
+    // A token that can't come in time fails at once, without waiting for the timeout.
+    RateLimit_GetStats(NULL, &before);
+    start = GetMonotonicTimeMs();
+    CHECK(!RateLimit_AcquirePoll(600));
+    CHECK(GetMonotonicTimeMs() - start < 100);
+
+    start = GetMonotonicTimeMs();
+    CHECK(RateLimit_AcquirePoll(1500));
+    waited = GetMonotonicTimeMs() - start;
+    CHECK(waited >= 900 && waited <= 1200);
+    RateLimit_GetStats(NULL, &after);
+    CHECK(after.numTimedOut == before.numTimedOut + 1);
+    CHECK(after.numAcquired == before.numAcquired + 1);
+    CHECK(after.maxWaitMs >= 900);
+}
+
+static void TestUnlimited(void)
+{
+    uint8_t parentID[PARENT_ID_SIZE];
+
+    RateLimitConfig config = {.pollBurst = 4};
+
+    Configure(0, 1, 0, 1, 0, 4);
+    CHECK(CountPolls() == 1000);
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 1, 0), PARENT_ID_SIZE, 0));
+    }
+
+    // Setting a rate starts with a whole burst, whatever was taken while unlimited.
+    config.pollsPerMinute = 60;
+    RateLimit_Configure(&config);
+    CHECK(CountPolls() == 4);
+}
+
+static void TestWriteBuckets(void)
+{
+    uint8_t parentID[PARENT_ID_SIZE];
+
+    // Writes take a token from the global bucket and from the bucket of their parent.
+    Configure(60, 3, 60, 2, 0, 1);
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 2, 0), PARENT_ID_SIZE, 0));
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 2, 0), PARENT_ID_SIZE, 0));
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 2, 0), PARENT_ID_SIZE, 0));
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 2, 1), PARENT_ID_SIZE, 0));
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 2, 2), PARENT_ID_SIZE, 0));
+
+    // Only parent buckets limit writes without a global rate.
+    Configure(0, 1, 60, 1, 0, 1);
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 2, 2), PARENT_ID_SIZE, 0));
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 2, 2), PARENT_ID_SIZE, 0));
+
+    // IDs are told apart by their size too, and cut to the size of a device ID.
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 2, 2), PARENT_ID_SIZE - 1, 0));
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 2, 2), PARENT_ID_SIZE + 4, 0));
+}
+
+static void TestParentEviction(void)
+{
+    uint8_t parentID[PARENT_ID_SIZE];
+    unsigned int i;
+
+    // Drain a bucket per parent, filling every parent bucket.
+    Configure(0, 1, 1, 1, 0, 1);
+    for (i = 0; i < MAX_PARENT_BUCKETS; i++)
+    {
+        usleep(TICK_US);
+        CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 3, i), PARENT_ID_SIZE, 0));
+    }
+
+    // Parent 0 is used again, so parent 1 is now the least recently used.
+    usleep(TICK_US);
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 3, 0), PARENT_ID_SIZE, 0));
+
+    // A 17th parent takes the bucket of parent 1, starting full.
+    usleep(TICK_US);
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 3, MAX_PARENT_BUCKETS), PARENT_ID_SIZE, 0));
+    usleep(TICK_US);
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 3, MAX_PARENT_BUCKETS), PARENT_ID_SIZE, 0));
+
+    // Parent 0 keeps its drained bucket, parent 1 starts over in the bucket of parent 2.
+    usleep(TICK_US);
+    CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 3, 0), PARENT_ID_SIZE, 0));
+    usleep(TICK_US);
+    CHECK(RateLimit_AcquireWrite(MakeParentID(parentID, 3, 1), PARENT_ID_SIZE, 0));
+    for (i = 3; i < MAX_PARENT_BUCKETS; i++)
+    {
+        usleep(TICK_US);
+        CHECK(!RateLimit_AcquireWrite(MakeParentID(parentID, 3, i), PARENT_ID_SIZE, 0));
+    }
+}
+
+static void *PollForever(void *arg)
+{
+    *(bool *)arg = RateLimit_AcquirePoll(RATE_LIMIT_WAIT_FOREVER);
+    return NULL;
+}
+
+static void TestReconfigureWakesWaiters(void)
+{
+    RateLimitStats stats;
+    pthread_t thread;
+    bool isAcquired = false;
+    int64_t start;
+
+    RateLimitConfig config = {.pollBurst = 1};
+
+    // At one per minute the waiter would wait a minute, lifting the limit lets it go at once.
+    Configure(0, 1, 0, 1, 1, 1);
+    CHECK(CountPolls() == 1);
+    if (pthread_create(&thread, NULL, PollForever, &isAcquired) != 0)
+    {
+        CHECK(!"pthread_create failed");
+        return;
+    }
+    usleep(100 * 1000);
+    RateLimit_GetStats(NULL, &stats);
+    CHECK(stats.queueDepth == 1);
+
+    start = GetMonotonicTimeMs();
+    RateLimit_Configure(&config);
+    pthread_join(thread, NULL);
+    CHECK(isAcquired);
+    CHECK(GetMonotonicTimeMs() - start < 500);
+    RateLimit_GetStats(NULL, &stats);
+    CHECK(stats.queueDepth == 0);
+}
+//! \}
+
+/**
+* @brief Entry point of the test.
+*/
+int main(void)
+{
+    TestBurst();
+    TestRefill();
+    TestWait();
+    TestUnlimited();
+    TestWriteBuckets();
+    TestParentEviction();
+    TestReconfigureWakesWaiters();
+    return TEST_RESULT();
+}